@@ -50,41 +50,213 @@
 #include "Defs.h"
 #include "Private.h"
 
+// set to 1 (e.g. -DCHECK_MATRIX_PRODUCTS=1) to check each product of MultiplyMatrices() against MultiplyMatricesReference(), e.g. to validate a kernel (this makes the products much slower)
+#ifndef CHECK_MATRIX_PRODUCTS
+#define CHECK_MATRIX_PRODUCTS 0
+#endif
+
+// relative to the magnitude of the terms of each entry (see MultiplyMatrices())
+#define GEMM_CHECK_TOLERANCE 1e-9
+
+#define SS_TOLERANCE 1e-12
+#define SS_MAX_ITERATIONS 10000
+
+#define BLOCK_SPARSE_NO_BLOCK ((ull)-1)
+
+// the sparse kernels are used for the sub-chain transition matrices whose density is below this threshold (see SparseTransitionMatrix)
+#define SPARSE_TRANSITION_DENSITY 0.25
+
 namespace lpm {
 
+//!
+//! \brief Square cost matrix in compressed sparse row format (used by Algorithms::MinimumCostAssignment())
+//!
+//! The entries of row \a i are stored at the positions \[\a rowStart\[i\]; \a rowStart\[i+1\] - 1\] of \a columns and \a costs. 
+//! The pairs (row, column) which are not stored cannot be assigned.
+//!
+struct SparseCostMatrix 
+{
+    ull numItems;
+
+    //! numItems + 1 entries
+    const ull* rowStart;
+
+    const ull* columns;
+
+    const double* costs;
+
+};
+
+//!
+//! \brief Square (transition) matrix stored in both compressed sparse row and compressed sparse column formats (see Algorithms::GetSparseTransitionMatrix())
+//!
+//! The non-zero entries of row \a i are stored at the positions \[\a rowStart\[i\]; \a rowStart\[i+1\] - 1\] of \a rowColumns and \a rowValues, 
+//! and those of column \a j at the positions \[\a columnStart\[j\]; \a columnStart\[j+1\] - 1\] of \a columnRows and \a columnValues (in increasing order of column, resp. row).
+//! The entries are only stored if \a density is below SPARSE_TRANSITION_DENSITY (the arrays are NULL otherwise, the dense matrix being used instead).
+//!
+struct SparseTransitionMatrix 
+{
+    ull dimension;
+
+    ull numNonZeros;
+
+    //! numNonZeros / (dimension * dimension)
+    double density;
+
+    //! dimension + 1 entries
+    uint32* rowStart;
+
+    uint32* rowColumns;
+
+    double* rowValues;
+
+    //! dimension + 1 entries
+    uint32* columnStart;
+
+    uint32* columnRows;
+
+    double* columnValues;
+
+};
+
+//!
+//! \brief Square matrix made of (blockDimension x blockDimension) blocks, only some of which are stored (see Algorithms::GetBlockSparseMatrix())
+//!
+//! The stored blocks of block row \a i are the blocks \[\a blockRowStart\[i\]; \a blockRowStart\[i+1\] - 1\] (in increasing order of block column, given by \a blockColumns). 
+//! Block \a b is stored row by row at \a values + \a b * \a blockDimension^2, and \a blockIndex maps (block row, block column) to \a b, or to BLOCK_SPARSE_NO_BLOCK if the block is not stored (i.e. zero).
+//!
+struct BlockSparseMatrix 
+{
+    ull numBlockRows;
+
+    ull blockDimension;
+
+    ull numBlocks;
+
+    //! numBlockRows + 1 entries
+    ull* blockRowStart;
+
+    ull* blockColumns;
+
+    //! numBlockRows * numBlockRows entries
+    ull* blockIndex;
+
+    double* values;
+
+};
+
 //!
 //! \brief Implements useful algorithms used by the library
 //!
-//! Static class which provides methods for some common useful algorithms such as MaximumWeightAssignment() and MultiplySquareMatrices().
+//! Static class which provides methods for some common useful algorithms such as MinimumCostAssignment() and MultiplySquareMatrices().
 //!
 class Algorithms 
 {
   private:
-    //[MinimumCostAssignment]: Step 1: Reduce the cost matrix by subtracting the row min from every row, and the column min from every column.
-    //This works because the resulting assignment (on the reduce matrix) corresponds to the same assignment on the non-reduced matrix
-    static void ReduceCostMatrix(ll* M, ll n);
+    //[MinimumCostAssignment]: the shortest augmenting path solver itself, the rows of the cost matrix being read through CostRows
+    template<class CostRows> static bool ShortestAugmentingPathAssignment(const CostRows& rows, ull numItems, ll* assignment);
+
+
+  public:
+    //Computes the assignment (row i -> column assignment[i]) of minimum total cost of the (numItems x numItems) cost matrix (stored row by row).
+    //This is the shortest augmenting path algorithm of Jonker and Volgenant, which runs in O(numItems^3) and works on doubles directly,
+    //so that (negated) log-likelihoods can be used as costs without any quantization. The costs must be finite.
+    static bool MinimumCostAssignment(const double* costMatrix, ull numItems, ll* assignment);
+
+    //Same as above, but only the pairs stored in the sparse cost matrix may be assigned (the other pairs have an infinite cost).
+    //Returns false if there is no complete assignment using the stored pairs only (without setting an error code, since this is expected by callers which retry with more pairs).
+    static bool MinimumCostAssignment(const SparseCostMatrix* costMatrix, ll* assignment);
+
+
+  private:
+    //[MultiplyMatrices]: the kernels; each one adds the product to resultMatrix, working on blocks which fit in the cache and on register tiles of 4 rows
+    static void MultiplyMatricesReference(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix);
+
+    static void MultiplyMatricesScalar(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix);
+
+    static void MultiplyMatricesAVX2(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix);
+
+    static void MultiplyMatricesAVX512(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix);
+
+    static bool IsMatrixKernelSupported(MatrixKernel kernel);
 
-    //[MinimumCostAssignment]: Step 2: Star some arbitrary zeros (making sure that no two zeros in the same row or column are starred).
-    static ll StarArbitraryZeros(ll* M, ll* starred, ll n);
+    //read and written atomically: MultiplyMatrices() is called concurrently by the worker threads
+    static volatile MatrixKernel matrixKernel;
 
-    //[MinimumCostAssignment]: Find any uncovered zeros
-    static bool FindAnyUncoveredZero(ll* M, ll n, ll& row, ll& col);
+    //[ComputeSteadyStateVector]: the L1 norm of (vector * matrix - vector)
+    static double SteadyStateResidual(const double* transitionMatrix, ull dimension, const double* vector, double* temp);
 
-    //[MinimumCostAssignment]: Cover all zeros by changing the adding/removing cover lines.
-    static ll CoverAllZeros(ll* M, ll* starred, ll* primed, ll n, ll& covers);
+    //[ComputeSteadyStateVector]: the methods themselves
+    static bool SteadyStateByMatrixSquaring(const double* transitionMatrix, ull dimension, double* steadyStateVector, ull* iterations);
+
+    static bool SteadyStateByPowerIteration(const double* transitionMatrix, ull dimension, double* steadyStateVector, ull* iterations);
+
+    static bool SteadyStateByGaussSeidel(const double* transitionMatrix, ull dimension, double* steadyStateVector, ull* iterations);
+
+    //solves (I - P)^T x = 0 (with sum_i x[i] = 1) by Gaussian elimination with partial pivoting on the dense matrix: O(dimension^3) time, O(dimension^2) memory
+    static bool SteadyStateByDenseLinearSolve(const double* transitionMatrix, ull dimension, double* steadyStateVector);
+
+    //[ComputeSteadyStateVector]: same as SteadyStateResidual() for a block-sparse matrix
+    static double SteadyStateResidual(const BlockSparseMatrix* transitionMatrix, const double* vector, double* temp);
 
 
   public:
-    //This implementation is heavily inspired from the code of Dariush Lotfi (June 2008).
-    //See http://csclab.murraystate.edu/bob.pilgrim/445/munkres.html for the algorithm itself.
-    static void MinimumCostAssignment(ll* costMatrix, ll numItems, ll* assignment);
 
     static void MultiplySquareMatrices(const double* leftMatrix, const double* rightMatrix, ull dimension, double* resultMatrix);
 
+    //Computes resultMatrix (numRows x numCols) = leftMatrix (numRows x numInner) * rightMatrix (numInner x numCols), all matrices being stored row by row.
+    //The result must not overlap the operands. If CHECK_MATRIX_PRODUCTS is set, the result is checked against MultiplyMatricesReference(): the error of each entry
+    //must be at most GEMM_CHECK_TOLERANCE times the corresponding entry of |leftMatrix| * |rightMatrix|.
+    static void MultiplyMatrices(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix);
+
+    //Selects the kernel used by MultiplyMatrices() (and MultiplySquareMatrices()). Returns false if the CPU does not support it.
+    //Both may be called concurrently with MultiplyMatrices(); AutoKernel is resolved on the first product.
+    static bool SetMatrixKernel(MatrixKernel kernel = AutoKernel);
+
+    static MatrixKernel GetMatrixKernel();
+
+    //Computes the steady-state (stationary) vector of the given (row-stochastic) transition matrix using the given method.
+    //The number of iterations (sweeps) and the L1 norm of (steadyStateVector * transitionMatrix - steadyStateVector) are returned in iterations and residual (if not NULL).
+    //Returns false if the method failed, i.e. the linear system is singular, or the iterative method did not converge within SS_MAX_ITERATIONS
+    //(in which case steadyStateVector contains the last iterate).
+    static bool ComputeSteadyStateVector(const double* transitionMatrix, ull dimension, double* steadyStateVector, SteadyStateMethod method = PowerIteration, ull* iterations = NULL, double* residual = NULL);
+
     static bool GetSteadyStateVectorOfSubChain(double* fullChainSS, ull timePeriodId, double** subChainSS, bool inclDummyTPs = false);
 
+    //Same as above, but writes the (numLoc) sub-chain steady-state vector to the given buffer instead of allocating it.
+    static bool GetSteadyStateVectorOfSubChain(const double* fullChainSS, ull timePeriodId, double* subChainSS, bool inclDummyTPs = false);
+
     static bool GetTransitionVectorOfSubChain(double* fullChainTransitionMatrix, ull tp1, ull loc1, ull tp2, double** transitionVector, bool inclDummyTPs = false);
 
+    //Computes the row-normalized transition matrices (numLoc x numLoc) of the sub-chains of all pairs of time periods (tp1, tp2), stored one after the other:
+    //the transition vector GetTransitionVectorOfSubChain(fullChainTransitionMatrix, tp1, loc1, tp2) starts at GET_INDEX_4D(tp1 - minPeriod, tp2 - minPeriod, loc1 - minLoc, 0, numPeriods, numLoc, numLoc).
+    //The rows which have no mass in the full chain are left to zero. The output is allocated here, but freed by the caller.
+    static bool GetTransitionMatricesOfSubChains(const double* fullChainTransitionMatrix, double** transitionMatrices, bool inclDummyTPs = false);
+
+    //Builds the sparse (row and column) representation of the given (dimension x dimension) matrix: the entries are only stored if its density is below SPARSE_TRANSITION_DENSITY.
+    //The arrays are allocated here, and freed by FreeSparseTransitionMatrix().
+    static bool GetSparseTransitionMatrix(const double* matrix, ull dimension, SparseTransitionMatrix* sparseMatrix);
+
+    static void FreeSparseTransitionMatrix(SparseTransitionMatrix* sparseMatrix);
+
+    //Allocates a block-sparse matrix of numBlockRows x numBlockRows blocks (of size blockDimension x blockDimension), storing (zeroed) the blocks whose entry in 
+    //blockPattern (numBlockRows x numBlockRows) is non-zero, e.g. the time period transitions matrix (TPInfo::propTransMatrix). Freed by FreeBlockSparseMatrix().
+    static bool GetBlockSparseMatrix(const double* blockPattern, ull numBlockRows, ull blockDimension, BlockSparseMatrix* matrix);
+
+    static void FreeBlockSparseMatrix(BlockSparseMatrix* matrix);
+
+    //Returns the (row by row) values of the given block, or NULL if it is not stored.
+    static double* GetBlock(const BlockSparseMatrix* matrix, ull blockRow, ull blockColumn);
+
+    //Writes the block-sparse matrix into the given dense matrix (of dimension numBlockRows * blockDimension).
+    static void ExpandBlockSparseMatrix(const BlockSparseMatrix* matrix, double* denseMatrix);
+
+    //Copies the entries of the given dense matrix into the stored blocks. Returns false if a non-zero entry lies outside of them.
+    static bool CompressToBlockSparseMatrix(const double* denseMatrix, BlockSparseMatrix* matrix);
+
+    //Same as ComputeSteadyStateVector() (with PowerIteration), but working on the stored blocks only.
+    static bool ComputeSteadyStateVector(const BlockSparseMatrix* transitionMatrix, double* steadyStateVector, ull* iterations = NULL, double* residual = NULL);
+
 };
 
 } // namespace lpm
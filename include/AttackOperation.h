@@ -55,6 +55,9 @@ using namespace std;
 
 #include "Defs.h"
 #include "Algorithms.h"
+#include "ThreadPool.h"
+
+#define LIKELIHOOD_USER_BLOCK 64
 
 namespace lpm { class MetricOperation; } 
 namespace lpm { class FilterFunction; } 
@@ -62,6 +65,38 @@ namespace lpm { class Context; }
 
 namespace lpm {
 
+//!
+//! \brief Emission probabilities of the observed events, precomputed once per attack
+//!
+//! The LPPM probabilities only depend on the observed event (i.e. the pseudonym and the time) and on the actual location and exposure,
+//! whereas the application probabilities only depend on the user, the time and the actual location and exposure.
+//! Both are stored as flat arrays indexed by GET_INDEX_4D(index, timeIdx, locIdx, exposure, numTimes, numLoc, 2), where \a exposure is 
+//! 0 for an actual (non-exposed) event and 1 for an exposed event.
+//!
+struct EmissionTable 
+{
+    ull numUsers;
+
+    ull numPseudonyms;
+
+    ull numTimes;
+
+    ull numLoc;
+
+    double* lppmProbabilities;
+
+    double* applicationProbabilities;
+
+    //! \brief Returns the probability of the observed event of the pseudonym at the given time, conditional on the user being at the given location
+    inline double GetProbability(ull userIdx, ull pseudonymIdx, ull timeIdx, ull locIdx) const
+    {
+    	const double* lppm = &lppmProbabilities[GET_INDEX_4D(pseudonymIdx, timeIdx, locIdx, 0, numTimes, numLoc, 2)];
+    	const double* app = &applicationProbabilities[GET_INDEX_4D(userIdx, timeIdx, locIdx, 0, numTimes, numLoc, 2)];
+
+    	return (lppm[0] * app[0]) + (lppm[1] * app[1]);
+    }
+
+};
 //! 
 //! \brief Base class for all attack operations.
 //! 
@@ -119,6 +154,36 @@ class AttackOperation : public Operation<TraceSet, AttackOutput>
   protected:
     Context* context;
 
+    ull numThreads;
+
+    //! 
+    //! \brief Computes the emission probabilities of the observed traces (the users and pseudonyms are indexed in the order of the context profiles and of the trace set mapping)
+    //!
+    //! \param[in] trace 	TraceSet*, containing observed events.
+    //! \param[out] table 	EmissionTable*, the output table (to be freed with FreeEmissionTable()).
+    //!
+    //! \note The LPPM pdf is assumed not to depend on the user of the actual event, which is the case for all the LPPMs of the library.
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool ComputeEmissionTable(const TraceSet* trace, EmissionTable* table) const;
+
+    void FreeEmissionTable(EmissionTable* table) const;
+
+    //! 
+    //! \brief Computes the log-likelihood matrix of the observed traces, under the (sub-chain) steady-state vectors of the users only
+    //!
+    //! This is the likelihood used by the weak adversary, and a cheap pre-filter for the strong adversary. The probabilities of the observed events 
+    //! at each timestamp are computed for all the (user, pseudonym) pairs at once, as a matrix product.
+    //!
+    //! \param[in] trace 	TraceSet*, containing observed events.
+    //! \param[in] emissions 	EmissionTable*, the emission probabilities of the observed events.
+    //! \param[out] matrix 	double**, the output (Nusers x Nusers) matrix (allocated here, but freed by the caller).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool ComputeSteadyStateLikelihood(const TraceSet* trace, const EmissionTable* emissions, double** matrix) const;
+
 
   public:
     //! 
@@ -130,6 +195,17 @@ class AttackOperation : public Operation<TraceSet, AttackOutput>
     //!
     void SetContext(const Context* newContext);
 
+    //! 
+    //! \brief Sets the number of threads used by the attack.
+    //!
+    //! \param[in] numThreads 	ull, the number of worker threads (THREADS_ALL_PROCESSORS for one thread per processor).
+    //!
+    //! \note The default is 1. The results do not depend on the number of threads.
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetNumThreads(ull numThreads = 1);
+
 };
 
 } // namespace lpm
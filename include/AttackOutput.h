@@ -54,6 +54,8 @@ using namespace std;
 #include "Defs.h"
 #include "Memory.h"
 
+#define NO_ALTERNATIVE_PSEUDONYM ((ull)-1)
+
 namespace lpm {
 
 //!
@@ -100,6 +102,23 @@ class AttackOutput : public Reference<AttackOutput>
 
     void SetMostLikelyTrace(const ull* trace);
 
+
+  private:
+    ull numAlternatives;
+
+    ull* alternativePseudonyms;
+
+    double* alternativeDistributions;
+
+
+  public:
+    //gets the alternative pseudonyms of each user (Nusers x numAlternatives, most likely first) and their location distributions (Nusers x numAlternatives x numTimes x numLoc)
+    //numAlternatives is 0 (and the pointers NULL) if the attack did not compute any alternative
+    //a user with fewer alternatives has NO_ALTERNATIVE_PSEUDONYM and a zero distribution in its remaining slots
+    bool GetAlternatives(ull* numAlternatives, ull** pseudonyms, double** distributions) const;
+
+    void SetAlternatives(ull numAlternatives, const ull* pseudonyms, double* distributions);
+
 };
 
 } // namespace lpm
@@ -58,13 +58,32 @@ using namespace std;
 
 #include "Defs.h"
 #include "Private.h"
+#include "ThreadPool.h"
 
 #define KC_DEFAULT_GS_ITERATIONS 10
 #define KC_NO_LIMITS 0
+#define KC_RANDOM_SEED 0
+
+#define KC_DEFAULT_GS_CHAINS 1
+#define KC_NO_CONVERGENCE_TARGET 0.0
+#define KC_CONVERGENCE_MIN_ITERATIONS 10
+#define KC_DEFAULT_BURN_IN ((ull)-1) // half of the iterations after the initial step (see SetConvergenceCriterion())
+#define KC_TIME_LIMITED_BURN_IN 100 // the default burn-in if only the time is limited
+
+// the entries whose (within and between chains) variances are below this are considered constant by the convergence diagnostics
+#define RHAT_MIN_VARIANCE 1e-24
+
+#define KC_NO_CHECKPOINT ""
+#define KC_DEFAULT_CHECKPOINT_INTERVAL 100
+#define KC_JOURNAL_FILE_SUFFIX ".journal"
+#define KC_SAMPLER_STATE_FILE_SUFFIX ".state"
+#define KC_SAMPLER_STATE_HEADER_SIZE 9 // user, seed, numChains, burnIn, step, rngState, numEntries, numTraces, totalLength
 
 namespace lpm { class File; } 
 namespace lpm { struct TraceVector; } 
 namespace lpm { class UserProfile; } 
+namespace lpm { class GibbsSamplingTask; } 
+namespace lpm { struct BlockSparseMatrix; } 
 
 namespace lpm {
 
@@ -91,6 +110,7 @@ struct KnowledgeInput
 //!
 class CreateContextOperation : public Operation<KnowledgeInput, Context> 
 {
+friend class GibbsSamplingTask;
   public:
     CreateContextOperation(string name = "DefaultCreateContextOperation");
 
@@ -102,6 +122,32 @@ class CreateContextOperation : public Operation<KnowledgeInput, Context>
 
     ull maxSecondsPerUser;
 
+    ull numThreads;
+
+    ull seed;
+
+    SteadyStateMethod steadyStateMethod;
+
+    ull numChains;
+
+    double targetRHat;
+
+    ull burnIn;
+
+    const Context* previousContext;
+
+    File* transitionsCountOutputFile;
+
+    string checkpointPrefix;
+
+    ull checkpointInterval;
+
+    File* journalFile;
+
+    ull checkpointSeed;
+
+    mutable pthread_mutex_t journalLock;
+
 
   public:
     //! \brief Executes the knowledge construction
@@ -111,6 +157,7 @@ class CreateContextOperation : public Operation<KnowledgeInput, Context>
     //!
     //! \note The procedure used to construct the knowledge is Gibbs sampling. 
     //! The number of iterations can be specified by calling \a SetLimits() before this.
+    //! Users are sampled concurrently if more than one thread is set with \a SetNumThreads().
     //!
     //! \return true or false, depending on whether the call is successful
     virtual bool Execute(const KnowledgeInput* input, Context* output);
@@ -130,15 +177,151 @@ class CreateContextOperation : public Operation<KnowledgeInput, Context>
     //!
     bool SetLimits(ull maxSamples = KC_DEFAULT_GS_ITERATIONS, ull maxSeconds = KC_NO_LIMITS);
 
+    //! 
+    //! \brief Sets the number of threads used to sample users concurrently.
+    //!
+    //! \param[in] numThreads 	ull, the number of worker threads (THREADS_ALL_PROCESSORS for one thread per processor).
+    //!
+    //! \note The default is 1 (i.e. users are sampled one after the other).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetNumThreads(ull numThreads = 1);
+
+    //! 
+    //! \brief Sets the seed of the Gibbs sampling procedure.
+    //!
+    //! \param[in] seed 	ull, the seed (KC_RANDOM_SEED to draw a new seed for each execution).
+    //!
+    //! \note Each user is sampled from its own random stream derived from the seed and the user id. Hence, 
+    //! for a fixed seed, the constructed knowledge does not depend on the number of threads 
+    //! (as long as the iterations are not limited by time, see \a SetLimits()).
+    //!
+    //! \return nothing
+    //!
+    void SetSeed(ull seed = KC_RANDOM_SEED);
+
+    //! 
+    //! \brief Sets the method used to compute the steady-state vectors.
+    //!
+    //! \param[in] method 	SteadyStateMethod, the method (PowerIteration by default).
+    //!
+    //! \note If the method fails for the steady-state vector of a profile (e.g. an iterative method does not converge within 
+    //! SS_MAX_ITERATIONS iterations), the error is reported (the error details give the number of iterations and the residual), 
+    //! and the vector is computed again by DenseLinearSolve, with a warning; the knowledge construction only fails if this fails too. 
+    //! For the samples of the Gibbs sampling procedure, the last iterate of an iterative method which did not converge is used instead, 
+    //! and the number of such samples is logged.
+    //!
+    //! \return nothing
+    //!
+    void SetSteadyStateMethod(SteadyStateMethod method = PowerIteration);
+
+    //! 
+    //! \brief Sets the number of chains of the Gibbs sampling procedure, and the convergence target at which it stops.
+    //!
+    //! \param[in] numChains 	ull, the number of independent chains sampled (in lockstep) for each user.
+    //! \param[in] targetRHat 	double, the target potential scale reduction factor (Gelman-Rubin R-hat), or KC_NO_CONVERGENCE_TARGET.
+    //! \param[in] burnIn 	ull, the number of iterations (after the initial step) discarded by the convergence diagnostics.
+    //!
+    //! \note With several chains, the R-hat of each entry of the transition matrix is computed after each iteration 
+    //! (and logged, along with the largest one at the end of the procedure), over the samples of each chain drawn after 
+    //! the initial step and the \a burnIn iterations which follow it. If a target is set, the procedure stops for a user 
+    //! as soon as the largest R-hat is at most \a targetRHat (computed over at least KC_CONVERGENCE_MIN_ITERATIONS iterations), 
+    //! the limits set with \a SetLimits() still applying. The constructed knowledge averages the samples of all chains.
+    //! \note The default burn-in (KC_DEFAULT_BURN_IN) is half of the iterations after the initial step allowed by \a SetLimits() 
+    //! (KC_TIME_LIMITED_BURN_IN if the number of iterations is not limited). \a Execute() fails if a target is set which 
+    //! cannot be reached within the limits, i.e. if \a burnIn + KC_CONVERGENCE_MIN_ITERATIONS iterations do not follow the initial step.
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetConvergenceCriterion(ull numChains = KC_DEFAULT_GS_CHAINS, double targetRHat = KC_NO_CONVERGENCE_TARGET, ull burnIn = KC_DEFAULT_BURN_IN);
+
+    //! 
+    //! \brief Sets the previously constructed context to update incrementally.
+    //!
+    //! \param[in] previousContext 	Context*, the previous context (NULL to construct the knowledge from scratch).
+    //!
+    //! \note In an incremental update, the learning traces only contain the new events, and the transitions count file 
+    //! holds the counts persisted by the previous construction (see \a SetTransitionsCountOutput()), so that the Gibbs sampling 
+    //! procedure is warm-started from them. The users whose new learning traces contain no event (and the users for which there is no 
+    //! information) keep the profile of the previous context, if they have one, without being sampled again.
+    //! The previous context must remain valid until \a Execute() returns.
+    //!
+    //! \return nothing
+    //!
+    void SetPreviousContext(const Context* previousContext = NULL);
+
+    //! 
+    //! \brief Sets the file to which the transitions count of each user is persisted by \a Execute().
+    //!
+    //! \param[in] outputFile 	File*, the output file (NULL to persist nothing).
+    //!
+    //! \note The counts are written in the format of the transitions count file of the KnowledgeInput. They are the prior counts of the user 
+    //! plus the transitions observed in its learning traces (i.e. between two known locations), so that the file can be used as the 
+    //! transitions count file of a later incremental update (see \a SetPreviousContext()). The transitions sampled to fill the gaps 
+    //! are not persisted: they would otherwise be counted again as evidence by each update.
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetTransitionsCountOutput(File* outputFile = NULL);
+
+    //! 
+    //! \brief Sets the checkpoints from which an interrupted knowledge construction can be resumed.
+    //!
+    //! \param[in] checkpointPrefix 	string, the path prefix of the checkpoint files (KC_NO_CHECKPOINT to disable the checkpoints).
+    //! \param[in] checkpointInterval 	ull, the number of Gibbs sampling iterations between two checkpoints of a user being sampled.
+    //!
+    //! \note Each completed profile is appended to the journal (\a checkpointPrefix followed by KC_JOURNAL_FILE_SUFFIX), and 
+    //! the state of the sampling of each user in progress (the estimated traces of each chain, the sums of the samples, and the 
+    //! random stream) is saved every \a checkpointInterval iterations (to \a checkpointPrefix-user followed by KC_SAMPLER_STATE_FILE_SUFFIX, 
+    //! which is removed when the user is completed). Executing again with the same inputs and settings restores the journaled profiles 
+    //! and resumes the other users from their last checkpoint, so that the knowledge constructed is the same as the one of an uninterrupted 
+    //! execution (as long as the iterations are not limited by time, see \a SetLimits()). The seed of the execution is saved in the journal 
+    //! and reused when resuming (in particular if the seed is KC_RANDOM_SEED, see \a SetSeed()); if a different seed is set, the journal 
+    //! and the saved states are discarded. The journal is kept when the execution completes: remove it to construct the knowledge from scratch.
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetCheckpoint(string checkpointPrefix = KC_NO_CHECKPOINT, ull checkpointInterval = KC_DEFAULT_CHECKPOINT_INTERVAL);
+
 
   private:
-    inline bool TransitionMatrixFromCountMatrix(const double* count, double* alpha, double* theta, double* transitionMatrix, bool sample = true) const;
+    inline bool TransitionMatrixFromCountMatrix(const BlockSparseMatrix* count, double* alpha, double* theta, BlockSparseMatrix* transitionMatrix, bool sample = true) const;
 
     inline void GetIntermediaryTransitionVector(map<ull, double*>& cache, const double* transitionMatrix, ull loc1, ull loc3, ull tp1, ull tp2, ull tp3, double** vector) const;
 
-    inline void ComputeSteadyStateVector(const double* transitionMatrix, double* steadyStateVector) const;
+    //Returns false (and sets the error code, with the iterations and the residual) if the method failed, or if the steady-state vector leaves a time period without mass.
+    //If converged is not NULL, the last iterate of an iterative method which did not converge is accepted instead, and *converged tells whether it converged.
+    inline bool ComputeSteadyStateVector(const double* transitionMatrix, SteadyStateMethod method, double* steadyStateVector, bool* converged = NULL, ull* iterations = NULL, double* residual = NULL) const;
+
+    //Same as above, for a block-sparse transition matrix. Only PowerIteration works on the stored blocks directly: the other methods work on 
+    //the expanded (dense) matrix, so that the memory savings of the blocks are lost for them.
+    bool ComputeSteadyStateVector(const BlockSparseMatrix* transitionMatrix, SteadyStateMethod method, double* steadyStateVector, bool* converged = NULL, ull* iterations = NULL, double* residual = NULL) const;
+
+    //If transitionsCount is not NULL, the transitions observed in the learning traces are added to it (numStates x numStates, non-dummy tps only).
+    bool DoGibbsSampling(vector<TraceVector>& learningTraces, double* priorTransitionsCount, UserProfile* profile, double* transitionsCount = NULL) const;
+
+    //[DoGibbsSampling]: fills each gap (maximal run of missing events) of the learning traces into the estimated traces, using SampleGap().
+    //The buffers have (at least) as many entries as the longest trace (times numLoc for forwardProbMatrix), and numLoc entries for samplingProbVector.
+    bool SampleMissingEvents(const vector<TraceVector>& learningTraces, vector<TraceVector>& estimatedTraces, const BlockSparseMatrix* transitionMatrix, const double* steadyStateVector, ull* gapTPs, double* forwardProbMatrix, double* samplingProbVector) const;
+
+    //[DoGibbsSampling]: samples the locations of a whole gap at once, given the transition matrix and the known locations surrounding it (0 if none),
+    //by forward filtering then backward sampling, in O(gapSize * numLoc^2).
+    bool SampleGap(const BlockSparseMatrix* transitionMatrix, const double* steadyStateVector, ull prevLoc, ull prevTp, const ull* gapTPs, ull gapSize, ull nextLoc, ull nextTp, double* forwardProbMatrix, double* samplingProbVector, ull* gapLocs) const;
 
-    bool DoGibbsSampling(vector<TraceVector>& learningTraces, double* priorTransitionsCount, UserProfile* profile) const;
+    //[DoGibbsSampling]: adds a sample of the transition matrix to PSUM, to the sum of squares (variance matrix), and to the sums of its chain (if not NULL).
+    void AddSample(const BlockSparseMatrix* transitionMatrix, BlockSparseMatrix* transitionMatrixSum, BlockSparseMatrix* squaredSum, double* chainSum, double* chainSquaredSum) const;
+
+    //[DoGibbsSampling]: adds the transitions between the known locations of the traces (with wrap-around) to count.
+    //Returns false if one of them is between time periods whose transition is not possible.
+    bool AddTransitionsCount(const vector<TraceVector>& traces, BlockSparseMatrix* count) const;
+
+    //[DoGibbsSampling]: returns the largest Gelman-Rubin potential scale reduction factor (R-hat) over the entries, given the sums and sums of squares
+    //of the numSamples samples of each chain (DBL_MAX if some entry does not vary within the chains but differs between them).
+    double ComputePotentialScaleReduction(const vector<double*>& chainSums, const vector<double*>& chainSquaredSums, ull numSamples, ull numEntries) const;
+
+    //the burn-in of the convergence diagnostics, the default one being derived from the limits (see SetConvergenceCriterion())
+    ull GetBurnIn() const;
 
     bool ReadKnowledgeFiles(const KnowledgeInput* input, map<ull, vector<TraceVector> >& learningTraces, map<ull, double*>& priorTransitionsCount, bool** transitionsFeasibilityMatrix = NULL);
 
@@ -148,6 +331,25 @@ class CreateContextOperation : public Operation<KnowledgeInput, Context>
 
     bool ReadLearningTraces(const vector<File*>& learningTracesFileVector, map<ull, vector<TraceVector> >& learningTraces);
 
+    //[Execute]: writes the transitions count of each user (numStates x numStates) in the format read by ReadTransitionsCount().
+    bool WriteTransitionsCount(const File* transitionsCountFile, const map<ull, double*>& transitionsCount) const;
+
+    //[Execute]: reads the seed of the journal and its profiles (and their transitions count, if it was journaled), up to the first incomplete entry.
+    //Returns false if there is no (readable) journal.
+    bool ReadJournal(ull* journalSeed, map<ull, UserProfile*>& profiles, map<ull, double*>& transitionsCount) const;
+
+    //[Execute, GibbsSamplingTask]: appends the profile (and its transitions count, if not NULL) to the journal, if any.
+    bool AppendToJournal(const UserProfile* profile, const double* transitionsCount) const;
+
+    //[DoGibbsSampling]: saves the state of the sampling of user after step iterations in binary form (through a temporary file, replacing the previous state at once).
+    bool WriteSamplerState(ull user, ull step, const BlockSparseMatrix* transitionMatrixSum, const BlockSparseMatrix* squaredSum, const vector<double*>& chainSums, const vector<double*>& chainSquaredSums, const vector<vector<TraceVector> >& estimatedTraces) const;
+
+    //[DoGibbsSampling]: restores the state of the sampling of user (including the random stream of the calling thread), if it was saved with the same settings and seed.
+    //Returns false (and modifies nothing) otherwise.
+    bool ReadSamplerState(ull user, ull* step, BlockSparseMatrix* transitionMatrixSum, BlockSparseMatrix* squaredSum, vector<double*>& chainSums, vector<double*>& chainSquaredSums, vector<vector<TraceVector> >& estimatedTraces) const;
+
+    inline string GetSamplerStateFileName(ull user) const;
+
 };
 
 } // namespace lpm
@@ -86,14 +86,18 @@ using namespace std;
 
 #define CODING_ERROR ASSERT(0 == 1)
 
-#ifdef FORCE_RELEASE
-	#ifdef DEBUG
-		#define Allocate(_s) Memory::GetInstance()->AllocateChunk((_s), __FILE__, __LINE__)
-		#define Free Memory::GetInstance()->FreeChunk
+// memory tracking compiled in (see MemoryTrackingMode): 0 = off (plain malloc/free), 1 = counting, 2 = full (default, unless FORCE_RELEASE)
+#ifndef MEMORY_TRACKING
+	#if defined(FORCE_RELEASE) && !defined(DEBUG)
+		#define MEMORY_TRACKING 0
 	#else
-		#define Allocate malloc
-		#define Free free
+		#define MEMORY_TRACKING 2
 	#endif
+#endif
+
+#if MEMORY_TRACKING == 0
+	#define Allocate malloc
+	#define Free free
 #else
 	#define Allocate(_s) Memory::GetInstance()->AllocateChunk((_s), __FILE__, __LINE__)
 	#define Free Memory::GetInstance()->FreeChunk
@@ -213,6 +217,44 @@ enum AttackType
   Weak = 0, 
   Strong = Weak + 1 
 
+};
+//!
+//! \brief Defines the methods used to compute the steady-state vector of a Markov chain
+//!
+//! \note \a DenseLinearSolve solves the linear system by Gaussian elimination on the dense matrix (in cubic time, 
+//! like \a MatrixSquaring), whereas \a PowerIteration and \a GaussSeidel are iterative methods.
+//!
+
+enum SteadyStateMethod 
+{
+  MatrixSquaring = 0, 
+  PowerIteration = MatrixSquaring + 1, 
+  GaussSeidel = PowerIteration + 1, 
+  DenseLinearSolve = GaussSeidel + 1 
+
+};
+//!
+//! \brief Defines the kernels used for the dense matrix products (\a AutoKernel selects the best kernel supported by the CPU)
+//!
+
+enum MatrixKernel 
+{
+  AutoKernel = 0, 
+  ScalarKernel = AutoKernel + 1, 
+  AVX2Kernel = ScalarKernel + 1, 
+  AVX512Kernel = AVX2Kernel + 1 
+
+};
+//!
+//! \brief Defines how much bookkeeping the Memory singleton does (\a MemoryTrackingOff: none, \a MemoryTrackingCounting: per call site counters, \a MemoryTrackingFull: every chunk and reference)
+//!
+
+enum MemoryTrackingMode 
+{
+  MemoryTrackingOff = 0, 
+  MemoryTrackingCounting = MemoryTrackingOff + 1, 
+  MemoryTrackingFull = MemoryTrackingCounting + 1 
+
 };
 
 } // namespace lpm
@@ -50,6 +50,7 @@
 #include "Singleton.h"
 #include <string>
 using namespace std;
+#include <pthread.h>
 
 #include "Defs.h"
 #include "Log.h"
@@ -80,6 +81,8 @@ using namespace std;
 #define ERROR_CODE_INVALID_TIME_PARTITIONING MAKE_ERROR_CODE(0x00000050UL)
 #define ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE MAKE_ERROR_CODE(0x00000051UL)
 
+#define ERROR_CODE_STEADY_STATE_FAILURE MAKE_ERROR_CODE(0x00000060UL)
+
 #define ERROR_CODE_SIZE_T_OVERFLOW MAKE_ERROR_CODE(0x00000102UL)
 #define ERROR_CODE_MEMORY_ALLOCATION_FAILURE MAKE_ERROR_CODE(0x00000201UL)
 
@@ -111,6 +114,8 @@ class Errors : public Singleton<Errors>
 
     string lastErrorDetails;
 
+    pthread_mutex_t lock;
+
 
   public:
     //! 
@@ -79,6 +79,8 @@ class DefaultApplicationOperation : public ApplicationOperation
 
     virtual double PDF(const Context* context, const ActualEvent* inEvent, const ActualEvent* outEvent) const;
 
+    virtual bool PDFVector(const Context* context, ull user, ull timestamp, const Event* outEvent, double* probabilities) const;
+
 
   private:
     double mu;
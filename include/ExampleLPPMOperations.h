@@ -90,6 +90,8 @@ class DefaultLPPMOperation : public LPPMOperation
 
     virtual double PDF(const Context* context, const ActualEvent* inEvent, const ObservedEvent* outEvent) const;
 
+    virtual bool PDFVector(const Context* context, ull user, ull timestamp, const Event* outEvent, double* probabilities) const;
+
 
   private:
     ushort obfuscationLevel;
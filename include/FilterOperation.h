@@ -68,6 +68,26 @@ class FilterFunction
   public:
     virtual double PDF(const Context* context, const Event* inEvent, const Event* outEvent) const = 0;
 
+    //! 
+    //! \brief Computes the pdf of the filter operation for all the locations at once
+    //!
+    //! For every location \a loc, the pdf for the actual event (\a user, \a timestamp, \a loc) and for its exposed counterpart are stored
+    //! in \a probabilities[GET_INDEX(loc - minLoc, 0, 2)] and \a probabilities[GET_INDEX(loc - minLoc, 1, 2)] respectively:
+    //! - if \a outEvent is not \a NULL, these events are the input events and \a outEvent is the output event (e.g. for a LPPM),
+    //! - if \a outEvent is \a NULL, the actual event is the input event and these events are the output events (e.g. for an application).
+    //!
+    //! \param[in] context 	Context*, the context.
+    //! \param[in] user 	ull, the user of the input events.
+    //! \param[in] timestamp 	ull, the timestamp of the input events.
+    //! \param[in] outEvent	Event*, the filtered output event (or \a NULL).
+    //! \param[out] probabilities 	double*, the output array (of size 2 x \a numLoc).
+    //!
+    //! \note The default implementation calls PDF() for every location, filter operations may override it with a faster implementation.
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    virtual bool PDFVector(const Context* context, ull user, ull timestamp, const Event* outEvent, double* probabilities) const;
+
 };
 //!
 //! \brief Represents a filter operation
@@ -145,10 +145,31 @@ class LPM : public Singleton<LPM>
     //! \param[in] outputFile 	File*, the output file.
     //! \param[in] maxGSIterationsPerUser [optional] ull, the maximum number of Gibbs sampling iterations, for each user.
     //! \param[in] maxSecondsPerUser [optional] ull, the maximum number of seconds to spend in the Gibbs sampling procedure, for each user.
+    //! \param[in] numThreads [optional] ull, the number of threads used to sample users concurrently (THREADS_ALL_PROCESSORS for one thread per processor).
+    //! \param[in] checkpointPrefix [optional] string, the path prefix of the checkpoint files from which an interrupted construction is resumed (see CreateContextOperation::SetCheckpoint()).
     //!
     //! \return true or false, depending on whether the call is successful (i.e. whether the knowledge is constructed successfully)
     //!
-    bool RunKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, File* outputFile, ull maxGSIterationsPerUser = KC_DEFAULT_GS_ITERATIONS, ull maxSecondsPerUser = KC_NO_LIMITS) const;
+    bool RunKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, File* outputFile, ull maxGSIterationsPerUser = KC_DEFAULT_GS_ITERATIONS, ull maxSecondsPerUser = KC_NO_LIMITS, ull numThreads = 1, string checkpointPrefix = KC_NO_CHECKPOINT) const;
+
+    //! 
+    //! \brief Updates previously constructed knowledge incrementally with new learning traces
+    //!
+    //! \param[in] knowledgeFiles 	KnowledgeInput*, the files to use for the update: the new learning traces, and the transitions count file persisted by the previous construction.
+    //! \param[in] previousContextFile 	File*, the previously constructed knowledge (NULL to construct the knowledge from scratch).
+    //! \param[in] outputFile 	File*, the output file.
+    //! \param[in] transitionsCountOutputFile 	File*, the file to which the transitions counts are persisted for the next update (NULL to persist nothing).
+    //! \param[in] maxGSIterationsPerUser [optional] ull, the maximum number of Gibbs sampling iterations, for each user.
+    //! \param[in] maxSecondsPerUser [optional] ull, the maximum number of seconds to spend in the Gibbs sampling procedure, for each user.
+    //! \param[in] numThreads [optional] ull, the number of threads used to sample users concurrently (THREADS_ALL_PROCESSORS for one thread per processor).
+    //! \param[in] checkpointPrefix [optional] string, the path prefix of the checkpoint files from which an interrupted construction is resumed (see CreateContextOperation::SetCheckpoint()).
+    //!
+    //! \note Only the users whose new learning traces contain events are sampled (warm-started from their persisted counts), 
+    //! the profiles of the other users are copied from the previous knowledge (see CreateContextOperation::SetPreviousContext()).
+    //!
+    //! \return true or false, depending on whether the call is successful (i.e. whether the knowledge is updated successfully)
+    //!
+    bool RunIncrementalKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, const File* previousContextFile, File* outputFile, File* transitionsCountOutputFile, ull maxGSIterationsPerUser = KC_DEFAULT_GS_ITERATIONS, ull maxSecondsPerUser = KC_NO_LIMITS, ull numThreads = 1, string checkpointPrefix = KC_NO_CHECKPOINT) const;
 
     bool RunContextAnalysisSchedule(ContextAnalysisSchedule* schedule, const File* contextFile, string outputFileName) const;
 
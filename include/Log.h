@@ -50,15 +50,38 @@
 #include "Singleton.h"
 #include <string>
 using namespace std;
+#include <pthread.h>
+#include <sstream>
 
 #include "Defs.h"
 
+// the messages whose level is above LOG_MAX_LEVEL are compiled out of the LOG_MESSAGE() and LOG_ENABLED() macros (e.g. -DLOG_MAX_LEVEL=2 removes the debug messages)
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL 3
+#endif
+
+// true if the messages of the given level are logged; the test against LOG_MAX_LEVEL is resolved at compile time
+#define LOG_ENABLED(_level) (((_level) <= LOG_MAX_LEVEL) && (lpm::Log::GetInstance()->IsEnabled(_level) == true))
+
+// default interval (in milliseconds) between two writes of the pending messages by the background writer thread (see Log::SetFlushInterval())
+#define LOG_DEFAULT_FLUSH_INTERVAL 100
+
+// number of pending messages above which the background writer thread is woken up before the end of the interval
+#define LOG_MAX_PENDING_MESSAGES 4096
+
+// appends a message given as a stream expression, e.g. LOG_MESSAGE(Log::debugLevel, "user " << user << " time " << tm), which is only formatted if the level is logged
+#define LOG_MESSAGE(_level, _stream) do { if(LOG_ENABLED(_level)) { stringstream _logStream(""); _logStream << _stream; lpm::Log::GetInstance()->Append(_logStream.str(), (_level)); } } while(0)
+
 namespace lpm {
 
 //!
 //! \brief Provides the logging facilities
 //!
 //! Singleton class which provides convenient methods to log information, warnings and errors to file.
+//! Messages can be appended from several threads: each message is written as a whole.
+//! The messages whose level is above the current level (see SetLevel()) are dropped: the LOG_MESSAGE() macro only formats them if they are logged.
+//! The messages are queued by Append() and written in batches by a background writer thread (see SetFlushInterval()), in the order in which they were appended.
+//! Errors and crashes are written synchronously, after the pending messages.
 //!
 
 class Log : public Singleton<Log> 
@@ -76,7 +99,7 @@ class Log : public Singleton<Log>
     //
     //! \param[in] message 	string to append to the log file.
     //! \param[in] level 	[optional] ushort specifying the seriousness of the message.
-    //!	This can be one of Log::infoLevel (default), Log::warningLevel, or, Log::errorLevel.
+    //!	This can be one of Log::infoLevel (default), Log::warningLevel, Log::errorLevel, or, Log::debugLevel.
     //
     //! \return nothing
     //!
@@ -92,13 +115,39 @@ class Log : public Singleton<Log>
 
     bool enabled;
 
+    ushort maxLevel;
+
+    //protects the pending messages and the state of the writer thread
+    pthread_mutex_t lock;
+
+    //held while writing to the log file, so that the batches are written in the order in which they were taken
+    pthread_mutex_t fileLock;
+
+    pthread_cond_t writerCondition;
+
+    pthread_t writerThread;
+
+    bool writerStarted;
+
+    bool stopWriter;
+
+    //in milliseconds (0: each message is written synchronously)
+    ull flushInterval;
+
+    //(time, message) of the messages appended but not yet written
+    vector<pair<time_t, string> > pendingMessages;
+
 
   public:
-    static const ushort warningLevel;
+    //! the levels are ordered by decreasing seriousness, so that the errors are logged at any level (see SetLevel())
+    static const ushort errorLevel = 0;
 
-    static const ushort errorLevel;
+    static const ushort warningLevel = 1;
 
-    static const ushort infoLevel;
+    static const ushort infoLevel = 2;
+
+    //! verbose (e.g. per element) messages, which are not logged by default
+    static const ushort debugLevel = 3;
 
     //!
     //! \brief Sets the output file name
@@ -118,6 +167,20 @@ class Log : public Singleton<Log>
     //! \return nothing
     void SetEnabled(bool state);
 
+    //!
+    //! \brief Sets the highest level of the logged messages
+    //
+    //! \param[in] level 	ushort, the messages whose level is above \a level are dropped (the default is Log::infoLevel, Log::errorLevel only logs the errors, and Log::debugLevel logs everything).
+    //!
+    //! \return nothing
+    void SetLevel(ushort level);
+
+    //! \brief Returns whether the messages of the given level are logged
+    inline bool IsEnabled(ushort level = Log::infoLevel) const
+    {
+    	return (enabled == true && level <= maxLevel);
+    }
+
     //!
     //! \brief Registers an error
     //
@@ -136,9 +199,32 @@ class Log : public Singleton<Log>
     //! \return nothing
     void RegisterCrash(string message);
 
+    //!
+    //! \brief Writes the pending messages to the log file
+    //!
+    //! \return nothing
+    void Flush();
+
+    //!
+    //! \brief Sets the interval between two writes of the pending messages
+    //!
+    //! \param[in] milliseconds 	ull, the interval (the default is LOG_DEFAULT_FLUSH_INTERVAL). If 0, the messages are written (and flushed) synchronously by Append().
+    //!
+    //! \return nothing
+    void SetFlushInterval(ull milliseconds = LOG_DEFAULT_FLUSH_INTERVAL);
+
 
   private:
-    bool GetTimeString(string& timeString) const;
+    bool GetTimeString(string& timeString, time_t t) const;
+
+    //writes the pending messages every flushInterval milliseconds (or when there are too many of them), until stopWriter is set
+    static void* WriterThread(void* arg);
+
+    //stops the writer thread (if started) and writes the pending messages
+    void StopWriter();
+
+    //registered with atexit() when the writer thread is started, so that the pending messages are written when the program exits
+    static void StopWriterAtExit();
 
 };
 
@@ -52,6 +52,7 @@
 using namespace std;
 #include <string>
 using namespace std;
+#include <pthread.h>
 
 #include "Defs.h"
 #include "NoDepend.h"
@@ -59,15 +60,29 @@ using namespace std;
 
 namespace lpm {
 
+// capacity of the call site table of the counting mode (the call sites which do not fit are accounted for in the first entry)
+#define MEMORY_MAX_CALL_SITES 4096
+
 //!
 //! \brief Provides debug-level memory management functionality
 //!
 //! Singleton class which allows to allocate/free memory chunks and monitor the reference counting process. 
 //! The Report() method can be used to find memory leaks.
 //!
-//! \note The methods of the class, except the Report() method should never be called directly.
+//! The amount of bookkeeping depends on the tracking mode (see MemoryTrackingMode):
+//! - \a MemoryTrackingOff: chunks are allocated/freed with malloc/free, nothing is tracked.
+//! - \a MemoryTrackingCounting: each chunk is prefixed by a small header holding its call site; 
+//!   the number of live chunks and bytes of each call site (file:line), and the number of live references, are kept in atomic counters.
+//! - \a MemoryTrackingFull: every chunk and every reference is recorded (under a mutex), so that leaks can be reported individually.
+//!
+//! The default mode is the one compiled in (MEMORY_TRACKING, see \a Defs.h), unless it is overridden by the environment variable 
+//! LPM_MEMORY_TRACKING (\a off, \a counting or \a full). If MEMORY_TRACKING is 0, the \a Allocate and \a Free macros call malloc/free directly.
+//!
+//! \note The methods of the class, except the Report(), SetTrackingMode() and GetTrackingMode() methods should never be called directly.
 //! The \a Allocate and \a Free macros defined in \a Defs.h should be used instead !
 //! 
+//! \note The bookkeeping is thread-safe, so that chunks can be allocated/freed and references updated from several threads.
+//!
 //! \see Reference, AllocateChunk(), FreeChunk(), UpdateReference(), Report()
 //!
 
@@ -80,20 +95,64 @@ class Memory : public Singleton<Memory>
 
 
   private:
+    // counters of one call site (counting mode)
+    struct CallSite 
+    {
+        const char* file;
+
+        int line;
+
+        volatile ull state; // 0: free, 1: being claimed, 2: ready
+
+        volatile ull liveChunks;
+
+        volatile ull liveBytes;
+
+    };
+
+    MemoryTrackingMode mode;
+
+    volatile bool started; // set once a chunk or a reference has been tracked
+
     map<void*, ull> references;
 
     map<void*, string> chunks;
 
+    pthread_mutex_t lock;
+
+    CallSite* callSites;
+
+    volatile ull liveReferences;
+
+    ull GetCallSite(const char* file, int line);
+
 
   public:
     void* AllocateChunk(ull bytes, const char* file, int line);
 
     void FreeChunk(void* chunk);
 
+    void RegisterReference(void* object);
+
+    void UnregisterReference(void* object);
+
     void UpdateReference(void* object, ull newCount);
 
     void Report();
 
+    //! 
+    //! \brief Sets the tracking mode
+    //!
+    //! \param[in] newMode 	MemoryTrackingMode, the new mode.
+    //!
+    //! \note The mode can only be changed before the first chunk is allocated (chunks must be freed in the mode they were allocated in).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetTrackingMode(MemoryTrackingMode newMode);
+
+    MemoryTrackingMode GetTrackingMode() const;
+
 };
 
 } // namespace lpm
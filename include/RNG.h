@@ -60,6 +60,9 @@ namespace lpm {
 //! Singleton class which provides convenient methods to generate random numbers (integers and real numbers) uniformly or
 //! according to a distribution (e..g Normal, Gamma), and, to sample from a distribution (e.g. Dirichlet).
 //!
+//! By default, numbers are drawn from the (shared) C library generator. A thread can instead bind its own stream by calling 
+//! \a SeedThreadStream(): the sequence generated then only depends on the seed, and not on the other threads.
+//!
 class RNG : public Singleton<RNG> 
 {
 friend class Singleton<RNG>;
@@ -111,12 +114,12 @@ friend class Singleton<RNG>;
     //!
     //! \note Naturally, this only make sense if the elements of \a probVector sum up to 1.
     //!
-    //! \param[in] probVector 	ull*, the probability vector (an array of \a length \a doubles).
+    //! \param[in] probVector 	const double*, the probability vector (an array of \a length \a doubles).
     //! \param[in] length 	ull, the number of elements in the probability vector
     //!
     //! \return ull, the sampled index
     //!
-    ull SampleIndexFromVector(double* probVector, ull length) const;
+    ull SampleIndexFromVector(const double* probVector, ull length) const;
 
 
   private:
@@ -132,6 +135,50 @@ friend class Singleton<RNG>;
 
     void GetDirichletExpectedValue(double* alpha, ull K, double* theta) const;
 
+    //! 
+    //! \brief Returns a random seed (drawn from the current generator)
+    //!
+    //! \return ull, the seed
+    //!
+    ull GenerateSeed() const;
+
+    //! 
+    //! \brief Binds a random stream seeded with \a seed to the calling thread
+    //!
+    //! Until \a ReleaseThreadStream() is called, all numbers generated by the calling thread are drawn from this stream.
+    //!
+    //! \param[in] seed 	ull, the seed of the stream.
+    //!
+    //! \return nothing
+    //!
+    void SeedThreadStream(ull seed) const;
+
+    //! 
+    //! \brief Releases the stream bound to the calling thread (if any)
+    //!
+    //! \return nothing
+    //!
+    void ReleaseThreadStream() const;
+
+    //! 
+    //! \brief Returns the state of the stream bound to the calling thread
+    //!
+    //! \note Binding a stream seeded with this state (see \a SeedThreadStream()) resumes the stream exactly where it was, e.g. from a checkpoint.
+    //!
+    //! \return ull, the state of the stream (0 if no stream is bound to the calling thread)
+    //!
+    ull GetThreadStreamState() const;
+
+    //! 
+    //! \brief Derives the seed of a sub-stream from a base seed and a key (e.g. a user id)
+    //!
+    //! \param[in] seed 	ull, the base seed.
+    //! \param[in] key 	ull, the key identifying the sub-stream.
+    //!
+    //! \return ull, the derived seed
+    //!
+    static ull DeriveSeed(ull seed, ull key);
+
 };
 
 } // namespace lpm
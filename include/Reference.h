@@ -118,7 +118,9 @@ Reference<T>::Reference()
 
 	refCount = 1;
 
-	Memory::GetInstance()->UpdateReference(static_cast<void*>(referencedObject), refCount);
+#if MEMORY_TRACKING != 0
+	Memory::GetInstance()->RegisterReference(static_cast<void*>(referencedObject));
+#endif
 
   // Bouml preserved body end 0001F591
 }
@@ -129,7 +131,9 @@ Reference<T>::~Reference()
   // Bouml preserved body begin 0006BE11
 
 	DEBUG_VERIFY(refCount == 0);
-	Memory::GetInstance()->UpdateReference(static_cast<void*>(referencedObject), refCount);
+#if MEMORY_TRACKING != 0
+	Memory::GetInstance()->UnregisterReference(static_cast<void*>(referencedObject));
+#endif
 
   // Bouml preserved body end 0006BE11
 }
@@ -147,7 +151,9 @@ void Reference<T>::AddRef()
 	DEBUG_VERIFY(refCount > 0);
 	refCount++;
 
+#if MEMORY_TRACKING != 0
 	Memory::GetInstance()->UpdateReference(static_cast<void*>(referencedObject), refCount);
+#endif
 
   // Bouml preserved body end 0001F611
 }
@@ -168,7 +174,9 @@ void Reference<T>::Release()
 
 	DEBUG_VERIFY(refCount > 0);
 
+#if MEMORY_TRACKING != 0
 	Memory::GetInstance()->UpdateReference(static_cast<void*>(referencedObject), refCount);
+#endif
 
 	refCount--;
 	if(refCount == 0)
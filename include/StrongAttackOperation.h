@@ -50,15 +50,27 @@
 #include "AttackOperation.h"
 #include <map>
 using namespace std;
+#include <set>
+#include <vector>
 
 #include "Defs.h"
 #include "Private.h"
 #include "Metrics.h"
+#include "ThreadPool.h"
 
+// the Viterbi predecessors are stored as 16-bit location indices up to this number of locations (32-bit beyond)
+#define VITERBI_SHORT_PREDECESSOR_MAX_LOC 65536
 
 namespace lpm { class MetricOperation; } 
 namespace lpm { class TraceSet; } 
 namespace lpm { class AttackOutput; } 
+namespace lpm { class UserProfile; } 
+namespace lpm { class Trace; } 
+namespace lpm { class AlphaTask; } 
+namespace lpm { class BetaTask; } 
+namespace lpm { class MostLikelyTraceTask; } 
+namespace lpm { class OnlineAlphaTask; } 
+namespace lpm { class ObservedEvent; } 
 
 namespace lpm {
 
@@ -68,6 +80,10 @@ namespace lpm {
 //!
 class StrongAttackOperation : public AttackOperation 
 {
+friend class AlphaTask;
+friend class BetaTask;
+friend class MostLikelyTraceTask;
+friend class OnlineAlphaTask;
   public:
     StrongAttackOperation();
 
@@ -78,10 +94,147 @@ class StrongAttackOperation : public AttackOperation
     virtual bool Execute(const TraceSet* input, AttackOutput* output);
 
 
+    //! 
+    //! \brief Enables/Disables the streaming mode
+    //!
+    //! In the streaming mode, the likelihood of each (user, pseudonym) pair is computed by a forward pass which only keeps two time slices of alpha, 
+    //! and alpha and beta are then only computed for the pairs of the resulting assignment (see also SetNumAlternatives()). The memory needed is then O(\a Nusers^2 + \a Nusers * \a numTimes * \a numLoc) 
+    //! instead of O(\a Nusers^2 * \a numTimes * \a numLoc). The results are the same in both modes.
+    //!
+    //! \param[in] streaming 	bool, whether to enable the streaming mode (the default is false).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetStreaming(bool streaming = true);
+
+    //! 
+    //! \brief Sets the number of alternative pseudonyms whose posterior is computed for each user
+    //!
+    //! The backward pass is only run for the pair (user, assigned pseudonym) of each user, and for the \a numAlternatives other pseudonyms 
+    //! of highest likelihood for this user. The location distributions of these alternative pairs are stored in the output (see AttackOutput::GetAlternatives()) 
+    //! and can be used to assess the uncertainty of the assignment. Only the pseudonyms whose observed trace is possible for the user are alternatives,
+    //! and the number of alternatives is capped at the largest number of such pseudonyms of a user.
+    //!
+    //! \param[in] numAlternatives 	ull, the number of alternative pseudonyms per user (the default is 0, i.e. only the assigned pairs).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetNumAlternatives(ull numAlternatives = 0);
+
+    //! 
+    //! \brief Enables/Disables the pruning of the (user, pseudonym) pairs
+    //!
+    //! With pruning, all the pairs are first scored by their likelihood under the steady-state vectors of the users (i.e. the likelihood of the weak adversary), 
+    //! and the forward pass is only run for the \a numCandidates best pseudonyms of each user (and the \a numCandidates best users of each pseudonym). 
+    //! The assignment is then restricted to these candidate pairs, the pruned pairs having an infinite cost. If there is no complete assignment among the candidates, 
+    //! \a numCandidates is doubled until there is one. The pruning ratio is reported in the log.
+    //!
+    //! \param[in] numCandidates 	ull, the number of candidates per user (the default is 0, i.e. no pruning).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool SetNumCandidates(ull numCandidates = 0);
+
+    //! 
+    //! \brief Starts an online attack on the observed traces of the given pseudonyms
+    //!
+    //! In the online mode, the observed events are added one timestamp at a time (see AddObservedEvents()), starting at the first timestamp. 
+    //! The filtered alpha slice (i.e. the distribution of the location of the user given the observed events so far) and the log-likelihood of each 
+    //! (user, pseudonym) pair are kept and advanced by each new timestamp, in O(\a numLoc^2) per pair, and the assignment and the location 
+    //! distributions at the last timestamp can be obtained at any time (see GetOnlineOutput()). Any previous online attack is discarded.
+    //!
+    //! \param[in] pseudonyms 	set<ull>, the pseudonyms of the observed traces (there must be as many as profiles in the context).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool StartOnlineAttack(const set<ull>& pseudonyms);
+
+    //! 
+    //! \brief Adds the observed events of the next timestamp to the online attack
+    //!
+    //! \param[in] events 	vector<ObservedEvent*>, the observed event of each pseudonym at the timestamp following the last added one.
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool AddObservedEvents(const vector<ObservedEvent*>& events);
+
+    //! 
+    //! \brief Returns the current output of the online attack
+    //!
+    //! The assignment maximizes the likelihood of the observed events added so far, exactly as Execute() would on the observed traces truncated at the 
+    //! last timestamp. The location distribution of each user is its filtered distribution at the last timestamp under its assigned pseudonym.
+    //!
+    //! \param[out] userToPseudonymMap 	map<ull, ull>, the assignment (user -> pseudonym).
+    //! \param[out] locationDistribution 	double**, the output (Nusers x numLoc) matrix, users being in increasing order (allocated here, but freed by the caller).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    bool GetOnlineOutput(map<ull, ull>& userToPseudonymMap, double** locationDistribution) const;
+
+
   private:
-    bool ComputeAlphaBeta(const TraceSet* traces, double** alpha, double** beta, double** lrnrm) const;
+    bool streaming;
+
+    ull numAlternatives;
+
+    ull numCandidates;
+
+    //online attack (see StartOnlineAttack()): the number of timestamps added so far, the profiles and pseudonyms (in increasing order of user, resp. pseudonym)
+    ull onlineNumTimes;
+
+    vector<const UserProfile*> onlineProfiles;
+
+    vector<ull> onlinePseudonyms;
+
+    //the (Nusers x Nusers x numLoc) filtered alpha slices, each scaled to sum to one (or zero if the observed events are impossible for the pair)
+    double* onlineAlpha;
+
+    //the (Nusers x Nusers) log-likelihoods of the observed events added so far
+    double* onlineLogLikelihoods;
+
+    //the emission probabilities of the last added timestamp (numTimes = 1)
+    EmissionTable onlineEmissions;
+
+    //computes the log-likelihood matrix (Nusers x Nusers) of the candidate pairs (-DBL_MAX for the pruned pairs), and the assignment among them
+    //zeroLikelihoods (Nusers x Nusers) flags the impossible candidate pairs and the pruned pairs
+    //numCandidatesPerUser is the number of candidates per user which was eventually needed to find a complete assignment
+    bool ComputePrunedAssignment(const TraceSet* traces, const EmissionTable* emissions, double* likelihood, bool* zeroLikelihoods, ll* assignment, ull* numCandidatesPerUser) const;
+
+    //computes alpha and/or beta (numTimes x numLoc each) of the given (user index, pseudonym index) pairs, stored one pair after the other (in the order of pairs)
+    //alpha or beta can be NULL, in which case the corresponding pass is skipped; the log-likelihood of each pair is written to logLikelihoods (if not NULL),
+    //and whether its observed trace is impossible to zeroLikelihoods (if not NULL); the forward pass runs the pairs of each user together (see ComputeAlphaOfUser())
+    bool ComputeAlphaBeta(const TraceSet* traces, const EmissionTable* emissions, const vector<pair<ull, ull> >& pairs, double** alpha, double** beta, double* logLikelihoods, bool* zeroLikelihoods) const;
+
+    //computes the log-likelihood matrix (Nusers x Nusers) keeping only two time slices of alpha per pair (ComputeAlphaBeta() without alpha and beta)
+    bool ComputeLikelihood(const TraceSet* traces, const EmissionTable* emissions, double* likelihood, bool* zeroLikelihoods) const;
+
+    bool GetProfilesAndObservedTraces(const TraceSet* traces, vector<const UserProfile*>& userProfiles, vector<const Trace*>& observedTraces) const;
+
+    //computes alpha of the pairs of the batch (indices in pairs, all of the same user): the alpha slices of the batch form a (batch size x numLoc) matrix
+    //which is multiplied by the sub-chain transition matrix at each time step. Each slice is scaled to sum to one, and the log-likelihood of a pair is the sum
+    //of the logs of its scaling coefficients. The alpha and log-likelihood of pair k are written at alpha[k * numTimes * numLoc] and logLikelihoods[k] (if not NULL),
+    //and zeroLikelihoods[k] (if not NULL) is set if the observed trace of the pair is impossible. scratch holds ((2 * batch size + 1) x numLoc) doubles.
+    bool ComputeAlphaOfUser(const UserProfile* profile, const vector<const Trace*>& observedTraces, const vector<pair<ull, ull> >& pairs, const vector<ull>& batch, const EmissionTable* emissions, double* alpha, double* logLikelihoods, bool* zeroLikelihoods, double* scratch) const;
+
+    //computes currentAlpha = previousAlpha * (sub-chain transition matrix from prevtp to tp), both being (numRows x numLoc), using the sparse kernel for sparse matrices
+    bool PropagateAlpha(const UserProfile* profile, ull prevtp, ull tp, ull numRows, const double* previousAlpha, double* currentAlpha) const;
+
+    //advances the online alpha slices and log-likelihoods of the pairs of the user by the last added timestamp; scratch holds ((Nusers + 1) x numLoc) doubles
+    bool AdvanceOnlineAlphaOfUser(ull userIndex, double* scratch);
+
+    void FreeOnlineAttack();
+
+    //each slice of beta is scaled to sum to one; weightedNextBeta is a (numLoc) scratch buffer
+    bool ComputeBetaOfPair(const UserProfile* profile, const Trace* observedTrace, ull userIndex, ull pseudonymIndex, const EmissionTable* emissions, double* mybeta, double* weightedNextBeta) const;
+
+    //computes the (numTimes x numLoc) location distribution of a pair from its alpha and beta, normalized at each time
+    void ComputeLocationDistribution(const double* pairAlpha, const double* pairBeta, ull userIndex, bool logProducts, double* distribution) const;
+
+    bool ComputeMostLikelyTrace(const TraceSet* traces, const EmissionTable* emissions, const map<ull, ull>& userToPseudonymMap, ull* mostLikelyTrace);
 
-    bool ComputeMostLikelyTrace(const TraceSet* traces, const map<ull, ull>& userToPseudonymMap, ull* mostLikelyTrace);
+    //decodes the user with only two slices of delta; predecessor holds the (numTimes x numLoc) predecessor location indices (Index is ushort or uint32),
+    //and scratch holds ((3 + numLoc) x numLoc) doubles (the slices of delta, the sub-chain steady-state vector and the log of the sub-chain transition matrix)
+    template<class Index> bool ComputeMostLikelyTraceOfUser(const UserProfile* profile, const Trace* observedTrace, ull userIndex, ull pseudonymIndex, const EmissionTable* emissions, Index* predecessor, ull* mostLikelyTrace, double* scratch) const;
 
 };
 
@@ -0,0 +1,129 @@
+/* -------------------------------------------------------------------------------------
+ * Copyright 2012 EPFL-I&C-LCA
+ *
+ * Designed and Developed by: Vincent Bindschaedler and Reza Shokri
+ *
+ * Authors: Reza Shokri, George Theodorakopoulos, Vincent Bindschaedler, George Danezis, 
+ *          Jean-Pierre Hubaux, Jean-Yves Le Boudec
+ * 
+ * Contact: reza.shokri@epfl.ch
+ *
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this 
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the authors/developers may not be used to endorse or promote 
+ *    products derived from this software without specific prior written permission.
+ * 4. All advertising materials and/or any publications mentioning features or use of 
+ *    this software must acknowledge it by citing the followings:
+ *    [a] Location-Privacy Meter: A Tool to Quantify Location Privacy. 
+ *        Available at http://lca.epfl.ch/projects/quantifyingprivacy/
+ *    [b] Reza Shokri, George Theodorakopoulos, Jean-Yves Le Boudec, and Jean-Pierre 
+ *        Hubaux. Quantifying Location Privacy. In IEEE Symposium on Security and 
+ *        Privacy (S&P), Oakland, CA, USA, May 22-25, 2011.
+ *    [c] Reza Shokri, George Theodorakopoulos, George Danezis, Jean-Pierre Hubaux, 
+ *        and Jean-Yves Le Boudec. Quantifying Location Privacy: The Case of Sporadic
+ *        Location Exposure. In The 11th Privacy Enhancing Technologies Symposium 
+ *        (PETS), Waterloo, Canada, July 27-29, 2011.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * -------------------------------------------------------------------------------------
+ */
+#ifndef LPM_THREADPOOL_H
+#define LPM_THREADPOOL_H
+
+//!
+//! \file
+//!
+#include <pthread.h>
+
+#include "Defs.h"
+#include "NoDepend.h"
+#include "Memory.h"
+
+#define THREADS_ALL_PROCESSORS 0
+
+namespace lpm {
+
+//!
+//! \brief Base class for work which can be split into independent tasks
+//!
+//! Derived classes implement \a Run() which executes a single task. Tasks may be executed concurrently 
+//! by different worker threads and in any order, so that \a Run() must only write to data owned by the given task 
+//! (or to data owned by the given worker).
+//!
+//! \see ThreadPool
+//!
+class ParallelTask 
+{
+  public:
+    virtual ~ParallelTask();
+
+    //! 
+    //! \brief Runs one task
+    //!
+    //! \param[in] taskIdx 	ull, the index of the task to run (in \[\a 0; \a numTasks - 1\]).
+    //! \param[in] workerIdx 	ull, the index of the worker thread running the task (in \[\a 0; \a numThreads - 1\]).
+    //!
+    //! \return true or false, depending on whether the call is successful
+    //!
+    virtual bool Run(ull taskIdx, ull workerIdx) = 0;
+
+};
+//!
+//! \brief Provides a simple pool of worker threads
+//!
+//! The workers repeatedly claim the next pending task (dynamic scheduling), until all tasks have been run or one of them fails.
+//!
+//! \note The singletons used by the library (e.g. Memory, Log, Errors, RNG) are not lazily created from the worker threads:
+//! they are instantiated by \a Execute() before the workers are started.
+//!
+class ThreadPool 
+{
+  public:
+    //! 
+    //! \brief Returns the number of processors available
+    //!
+    //! \return ull, the number of online processors (at least 1)
+    //!
+    static ull GetNumProcessors();
+
+    //! 
+    //! \brief Returns the number of worker threads which would be used to run \a numTasks tasks
+    //!
+    //! \param[in] numThreads 	ull, the requested number of threads (THREADS_ALL_PROCESSORS for one thread per processor).
+    //! \param[in] numTasks 	ull, the number of tasks.
+    //!
+    //! \return ull, the number of worker threads
+    //!
+    static ull GetNumWorkers(ull numThreads, ull numTasks);
+
+    //! 
+    //! \brief Runs the tasks \a 0, \a 1, ..., \a numTasks - 1 of the given \a task using \a numThreads worker threads
+    //!
+    //! \param[in] task 	ParallelTask*, the work to execute.
+    //! \param[in] numTasks 	ull, the number of tasks.
+    //! \param[in] numThreads 	ull, the number of worker threads (THREADS_ALL_PROCESSORS for one thread per processor).
+    //!
+    //! \note If a single worker is used, the tasks are run in order by the calling thread.
+    //!
+    //! \return true if all tasks were run successfully, false otherwise
+    //!
+    static bool Execute(ParallelTask* task, ull numTasks, ull numThreads = THREADS_ALL_PROCESSORS);
+
+};
+
+} // namespace lpm
+#endif
@@ -51,6 +51,10 @@
 
 #include "Defs.h"
 
+#include <pthread.h>
+
+namespace lpm { struct SparseTransitionMatrix; } 
+
 namespace lpm {
 
 //!
@@ -73,6 +77,24 @@ class UserProfile : public Reference<UserProfile>
 
     double* varianceMatrix;
 
+    mutable double* subChainTransitionMatrices;
+
+    mutable SparseTransitionMatrix* subChainSparseMatrices;
+
+    mutable ull numSubChainSparseMatrices;
+
+    //the parameters of the sub-chain matrices, cached when they are built
+    mutable ull subChainMinPeriod;
+
+    mutable ull subChainNumPeriods;
+
+    mutable ull subChainNumLoc;
+
+    //set once the sub-chain matrices are built: they are then read without locking
+    mutable volatile bool subChainsBuilt;
+
+    mutable pthread_mutex_t lock;
+
 
   public:
     explicit UserProfile(ull u);
@@ -112,10 +134,49 @@ class UserProfile : public Reference<UserProfile>
     //!
     bool GetSteadyStateVector(double** vector) const;
 
+    //! 
+    //! \brief Returns the (row-normalized) transition matrix of the sub-chain from time period \a tp1 to time period \a tp2
+    //!
+    //! \param[in] tp1 	ull, the time period of the current state.
+    //! \param[in] tp2 	ull, the time period of the next state.
+    //! \param[out] matrix 	const double**, a pointer which will point to the output transition matrix (if the call is successful).
+    //!
+    //! \note The output matrix is a two dimensional array of doubles (of size \a numLoc x \a numLoc), whose row \a loc1 - \a minLoc is 
+    //! the vector returned by \a Algorithms::GetTransitionVectorOfSubChain() for (\a tp1, \a loc1, \a tp2). 
+    //! \note The matrices of all pairs of time periods are computed on the first call, and owned by the profile.
+    //!
+    //! \return true or false, depending on whether the call is successful.
+    //!
+    bool GetSubChainTransitionMatrix(ull tp1, ull tp2, const double** matrix) const;
+
+    //! 
+    //! \brief Returns the sparse representation of the transition matrix of the sub-chain from time period \a tp1 to time period \a tp2
+    //!
+    //! \param[in] tp1 	ull, the time period of the current state.
+    //! \param[in] tp2 	ull, the time period of the next state.
+    //! \param[out] matrix 	const SparseTransitionMatrix**, a pointer which will point to the output matrix (if the call is successful).
+    //!
+    //! \note The output matrix has the same entries as the one returned by \a GetSubChainTransitionMatrix(), stored by row and by column 
+    //! if its density is below SPARSE_TRANSITION_DENSITY (only its density is kept otherwise). It is computed along with the dense matrices, and owned by the profile.
+    //! \note The call fails if the time period \a tp2 cannot follow \a tp1 (see \a TPInfo::propTransMatrix), no sparse matrix being built for such pairs.
+    //!
+    //! \return true or false, depending on whether the call is successful.
+    //!
+    bool GetSparseSubChainTransitionMatrix(ull tp1, ull tp2, const SparseTransitionMatrix** matrix) const;
+
 
   private:
     bool GetAccuracyInfo(ull* samples, double** variance);
 
+    //computes the (dense and sparse) sub-chain transition matrices, unless they are built; the caller holds the lock
+    //the sparse matrices of the pairs of time periods which cannot follow each other are left empty (dimension 0)
+    bool ComputeSubChainTransitionMatrices() const;
+
+    //[GetSubChainTransitionMatrix, GetSparseSubChainTransitionMatrix]: builds the sub-chain matrices on the first call (under the lock)
+    inline bool BuildSubChainTransitionMatrices() const;
+
+    void FreeSubChainTransitionMatrices() const;
+
 };
 
 } // namespace lpm
@@ -78,9 +78,10 @@ class WeakAttackOperation : public AttackOperation
 
 
   private:
-    bool ComputeLikelihood(const TraceSet* trace, double** matrix) const;
+    //computes the log-likelihood matrix (Nusers x Nusers), see AttackOperation::ComputeSteadyStateLikelihood()
+    bool ComputeLikelihood(const TraceSet* trace, const EmissionTable* emissions, double** matrix) const;
 
-    bool ComputeLocationDistribution(const TraceSet* trace, const map<ull, ull>* mapping, double* locationDistribution) const;
+    bool ComputeLocationDistribution(const TraceSet* trace, const EmissionTable* emissions, const map<ull, ull>* mapping, double* locationDistribution) const;
 
 };
 
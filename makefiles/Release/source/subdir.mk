@@ -42,6 +42,7 @@ CPP_SRCS += \
 ../source/Schedules.cpp \
 ../source/StoreContextOperation.cpp \
 ../source/StrongAttackOperation.cpp \
+../source/ThreadPool.cpp \
 ../source/TimePartitioning.cpp \
 ../source/Trace.cpp \
 ../source/TraceGeneratorOperation.cpp \
@@ -89,6 +90,7 @@ OBJS += \
 ./source/Schedules.o \
 ./source/StoreContextOperation.o \
 ./source/StrongAttackOperation.o \
+./source/ThreadPool.o \
 ./source/TimePartitioning.o \
 ./source/Trace.o \
 ./source/TraceGeneratorOperation.o \
@@ -136,6 +138,7 @@ CPP_DEPS += \
 ./source/Schedules.d \
 ./source/StoreContextOperation.d \
 ./source/StrongAttackOperation.d \
+./source/ThreadPool.d \
 ./source/TimePartitioning.d \
 ./source/Trace.d \
 ./source/TraceGeneratorOperation.d \
@@ -149,7 +152,7 @@ CPP_DEPS += \
 source/%.o: ../source/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	g++ -O3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o"$@" "$<"
+	g++ -O3 -Wall -c -fmessage-length=0 -pthread -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o"$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
@@ -46,252 +46,832 @@
 //!
 #include "../include/Algorithms.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+	#define GEMM_X86
+	#include <immintrin.h>
+#endif
+
+// block sizes of MultiplyMatrices(): a (GEMM_BLOCK_INNER x GEMM_BLOCK_COLS) block of the right matrix stays in the L2 cache
+// while GEMM_BLOCK_ROWS rows of the left matrix are multiplied with it
+#define GEMM_BLOCK_ROWS 64
+#define GEMM_BLOCK_INNER 256
+#define GEMM_BLOCK_COLS 256
+
 namespace lpm {
 
-//[MinimumCostAssignment]: Step 1: Reduce the cost matrix by subtracting the row min from every row, and the column min from every column.
-//This works because the resulting assignment (on the reduce matrix) corresponds to the same assignment on the non-reduced matrix
-void Algorithms::ReduceCostMatrix(ll* M, ll n)
-{
-  // Bouml preserved body begin 000C5091
+volatile MatrixKernel Algorithms::matrixKernel = AutoKernel;
 
-	for(ll i=0;i<n;i++)
-	{
-		ll min = LONG_LONG_MAX;
-		for(ll j=0;j<n;j++) {  if (M[GET_INDEX(i, j, n+1)] < min) { min = M[GET_INDEX(i, j, n+1)]; } }
-		for(ll j=0;j<n;j++) {  M[GET_INDEX(i, j, n+1)] -= min; }
-	}
-	for(ll j=0;j<n;j++)
+// adds the product of rows [rowStart, rowEnd) x inner [innerStart, innerEnd) of the left matrix with
+// the columns [colStart, colEnd) of the right matrix to the result (used for the edges of the register tiles)
+static inline void MultiplyMatricesEdge(const double* leftMatrix, const double* rightMatrix, ull numInner, ull numCols, double* resultMatrix,
+		ull rowStart, ull rowEnd, ull innerStart, ull innerEnd, ull colStart, ull colEnd)
+{
+	for(ull i = rowStart; i < rowEnd; i++)
 	{
-		ll min = LONG_LONG_MAX;
-		for(ll i=0;i<n;i++) {  if (M[GET_INDEX(i, j, n+1)] < min) { min = M[GET_INDEX(i, j, n+1)]; } }
-		for(ll i=0;i<n;i++) {  M[GET_INDEX(i, j, n+1)] -=  min; }
+		const double* leftRow = &leftMatrix[GET_INDEX(i, 0, numInner)];
+		double* resultRow = &resultMatrix[GET_INDEX(i, 0, numCols)];
+		for(ull k = innerStart; k < innerEnd; k++)
+		{
+			const double left = leftRow[k];
+			const double* rightRow = &rightMatrix[GET_INDEX(k, 0, numCols)];
+			for(ull j = colStart; j < colEnd; j++) { resultRow[j] += left * rightRow[j]; }
+		}
 	}
-
-  // Bouml preserved body end 000C5091
 }
 
-//[MinimumCostAssignment]: Step 2: Star some arbitrary zeros (making sure that no two zeros in the same row or column are starred).
-ll Algorithms::StarArbitraryZeros(ll* M, ll* starred, ll n)
+// [MinimumCostAssignment]: reads the rows of a dense cost matrix
+struct DenseCostRows 
+{
+    const double* costMatrix;
+
+    ull numItems;
+
+    ull GetNumEntries(ull row) const { return numItems; }
+
+    ull GetColumn(ull row, ull entry) const { return entry; }
+
+    double GetCost(ull row, ull entry) const { return costMatrix[GET_INDEX(row, entry, numItems)]; }
+
+};
+
+// [MinimumCostAssignment]: reads the rows of a sparse (CSR) cost matrix
+struct SparseCostRows 
+{
+    const SparseCostMatrix* costMatrix;
+
+    ull GetNumEntries(ull row) const { return costMatrix->rowStart[row + 1] - costMatrix->rowStart[row]; }
+
+    ull GetColumn(ull row, ull entry) const { return costMatrix->columns[costMatrix->rowStart[row] + entry]; }
+
+    double GetCost(ull row, ull entry) const { return costMatrix->costs[costMatrix->rowStart[row] + entry]; }
+
+};
+
+//[MinimumCostAssignment]: the rows are inserted one by one; each insertion runs Dijkstra on the reduced costs (cost - rowPotential - columnPotential)
+//from the new row until a free column is reached, updates the potentials, and flips the assignment along the shortest path.
+//Each insertion costs O(numItems^2), hence O(numItems^3) overall.
+template<class CostRows> bool Algorithms::ShortestAugmentingPathAssignment(const CostRows& rows, ull numItems, ll* assignment)
 {
-  // Bouml preserved body begin 000C5111
+  // Bouml preserved body begin 000C5291
 
-	ll starredCount = 0;
+	ull n = numItems;
+	const double infinity = HUGE_VAL;
 
-	for(ll i=0;i<n;i++)
+	// the column n is a virtual column from which the path to a new row starts
+	vector<double> rowPotential = vector<double>(n, 0.0);
+	vector<double> columnPotential = vector<double>(n + 1, 0.0);
+	vector<ll> rowOfColumn = vector<ll>(n + 1, -1); // the row assigned to each column (-1 if none)
+	vector<ull> previousColumn = vector<ull>(n + 1, 0); // the previous column on the shortest path
+	vector<double> minReducedCost = vector<double>(n + 1, infinity);
+	vector<bool> visited = vector<bool>(n + 1, false);
+
+	for(ull row = 0; row < n; row++)
 	{
-		for(ll j=0;j<n;j++)
+		rowOfColumn[n] = row;
+		ull currentColumn = n;
+
+		fill(minReducedCost.begin(), minReducedCost.end(), infinity);
+		fill(visited.begin(), visited.end(), false);
+
+		// grow the shortest path tree until a free column is reached
+		do
 		{
-			if(starred[i] == -1 && M[GET_INDEX(n, j, n+1)] == 0 && M[GET_INDEX(i, j, n+1)] == 0)
+			visited[currentColumn] = true;
+			ull currentRow = rowOfColumn[currentColumn];
+
+			ull numEntries = rows.GetNumEntries(currentRow);
+			for(ull entry = 0; entry < numEntries; entry++)
+			{
+				ull col = rows.GetColumn(currentRow, entry);
+				if(visited[col] == true) { continue; }
+
+				double reducedCost = rows.GetCost(currentRow, entry) - rowPotential[currentRow] - columnPotential[col];
+				if(reducedCost < minReducedCost[col])
+				{
+					minReducedCost[col] = reducedCost;
+					previousColumn[col] = currentColumn;
+				}
+			}
+
+			double delta = infinity; ull nextColumn = n;
+			for(ull col = 0; col < n; col++)
 			{
-				M[GET_INDEX(n, j, n+1)] = 1;
-				starred[i] = j;
-				starredCount++;
+				if(visited[col] == false && minReducedCost[col] < delta)
+				{
+					delta = minReducedCost[col];
+					nextColumn = col;
+				}
 			}
+
+			if(nextColumn == n) { return false; } // no path to a free column: there is no complete assignment
+
+			// update the potentials so that the reduced costs along the tree stay zero
+			for(ull col = 0; col <= n; col++)
+			{
+				if(visited[col] == true)
+				{
+					rowPotential[rowOfColumn[col]] += delta;
+					columnPotential[col] -= delta;
+				}
+				else { minReducedCost[col] -= delta; }
+			}
+
+			currentColumn = nextColumn;
 		}
+		while(rowOfColumn[currentColumn] != -1);
+
+		// augment along the shortest path
+		do
+		{
+			ull prevColumn = previousColumn[currentColumn];
+			rowOfColumn[currentColumn] = rowOfColumn[prevColumn];
+			currentColumn = prevColumn;
+		}
+		while(currentColumn != n);
 	}
 
-	return starredCount;
+	for(ull col = 0; col < n; col++) { assignment[rowOfColumn[col]] = col; }
 
-  // Bouml preserved body end 000C5111
+	return true;
+
+  // Bouml preserved body end 000C5291
 }
 
-//[MinimumCostAssignment]: Find any uncovered zeros
-bool Algorithms::FindAnyUncoveredZero(ll* M, ll n, ll& row, ll& col)
+bool Algorithms::MinimumCostAssignment(const double* costMatrix, ull numItems, ll* assignment)
 {
-  // Bouml preserved body begin 000C5191
+  // Bouml preserved body begin 000C1311
+
+	if(costMatrix == NULL || assignment == NULL || (ull)((ll)numItems) != numItems)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
 
-	for(ll i=0;i<n;i++)
+	for(ull index = 0; index < numItems * numItems; index++)
 	{
-		for(ll j=0;j<n;j++)
+		if(!(fabs(costMatrix[index]) <= DBL_MAX)) // infinite or nan
 		{
-			if(M[GET_INDEX(i, n, n+1)] == 0 && M[GET_INDEX(n, j, n+1)] == 0 && M[GET_INDEX(i, j, n+1)] == 0)
-			{
-				row = i;
-				col = j;
-				return true; // found
-			}
+			SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+			return false;
 		}
 	}
 
-	return false;
+	DenseCostRows rows;
+	rows.costMatrix = costMatrix;
+	rows.numItems = numItems;
+
+	// a dense matrix always has a complete assignment
+	VERIFY(ShortestAugmentingPathAssignment(rows, numItems, assignment) == true);
+
+	return true;
 
-  // Bouml preserved body end 000C5191
+  // Bouml preserved body end 000C1311
 }
 
-//[MinimumCostAssignment]: Cover all zeros by changing the adding/removing cover lines.
-ll Algorithms::CoverAllZeros(ll* M, ll* starred, ll* primed, ll n, ll& covers)
+bool Algorithms::MinimumCostAssignment(const SparseCostMatrix* costMatrix, ll* assignment)
 {
-  // Bouml preserved body begin 000C5211
+  // Bouml preserved body begin 000C1391
 
-	ll row = 0;
-	ll col = 0;
+	if(costMatrix == NULL || assignment == NULL || costMatrix->rowStart == NULL || (ull)((ll)costMatrix->numItems) != costMatrix->numItems)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
 
-	//Repeat until there are no uncovered zeros left
-	while(FindAnyUncoveredZero(M, n, row, col) == true)
+	ull n = costMatrix->numItems;
+	ull numEntries = costMatrix->rowStart[n];
+	if(numEntries != 0 && (costMatrix->columns == NULL || costMatrix->costs == NULL))
 	{
-		if(starred[row] != -1) // If there is a starred zero in the same row of uncovered zero
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
+
+	for(ull row = 0; row < n; row++)
+	{
+		if(costMatrix->rowStart[row] > costMatrix->rowStart[row + 1])
 		{
-			primed[row] = col; // Priming the uncovered zero
-			M[GET_INDEX(row, n, n+1)] = 1; // Covering the row of uncovered zero
-			M[GET_INDEX(n, starred[row], n+1)] = 0; // Uncovering the column containing the starred zero
+			SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+			return false;
 		}
-		else // If there is no starred zero in the same row of uncovered zero
+	}
+
+	for(ull entry = 0; entry < numEntries; entry++)
+	{
+		if(costMatrix->columns[entry] >= n || !(fabs(costMatrix->costs[entry]) <= DBL_MAX))
 		{
-			// According to the algorithm uncovered zero should be primed first, but
-			// because it will be starred later, I don't prime it.
+			SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+			return false;
+		}
+	}
 
-			ll i = 0;
-			// Looking for a starred zero in the same column of uncovered (primed) zero
-			for(i=0;i<n;i++) { if(starred[i] == col) { break; } }
+	SparseCostRows rows;
+	rows.costMatrix = costMatrix;
 
-			// Repeat until there is no starred zero in the same column as primed zero
-			while(i != n)
-			{
-				starred[row] = col; // Starring the primed zero
-				starred[i] = -1; // Un-starring the starred zero in the same column of primed zero
+	// the stored pairs may not admit a complete assignment: this is not an error (callers such as the pruned attacks widen the pairs and retry)
+	return ShortestAugmentingPathAssignment(rows, n, assignment);
 
-				//Finding the primed zero in the same row of that starred zero
-				//(there will always be one)
-				col = primed[i];
-				row = i;
+  // Bouml preserved body end 000C1391
+}
 
-				//Looking for a starred zero in the same column of the found primed zero
-				for(i=0;i<n;i++) { if(starred[i] == col) { break; } }
-			}
 
-			//Starring the last primed zero that has no starred zero in its column
-			starred[row] = col;
+void Algorithms::MultiplySquareMatrices(const double* leftMatrix, const double* rightMatrix, ull dimension, double* resultMatrix)
+
+{
+  // Bouml preserved body begin 00081A91
 
-			//Erasing all primes and uncover every rows in the matrix while covering
-			//all columns containing a starred zero
-			for(ll j=0;j<n;j++)
-			{
-				primed[j] = -1;
-				M[GET_INDEX(j, n, n+1)] = 0;
-				if(starred[j] != -1) { M[GET_INDEX(n, starred[j], n+1)] = 1; }
-			}
-			covers++;
-			if(covers == n) { return n; }
-		}
+	VERIFY(leftMatrix != NULL && rightMatrix != NULL && resultMatrix != NULL && dimension != 0);
+
+	MultiplyMatrices(leftMatrix, rightMatrix, dimension, dimension, dimension, resultMatrix);
+
+  // Bouml preserved body end 00081A91
+}
+
+void Algorithms::MultiplyMatrices(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix)
+{
+  // Bouml preserved body begin 000C0891
+
+	VERIFY(leftMatrix != NULL && rightMatrix != NULL && resultMatrix != NULL && numRows != 0 && numInner != 0 && numCols != 0);
+	VERIFY(resultMatrix + numRows * numCols <= leftMatrix || leftMatrix + numRows * numInner <= resultMatrix);
+	VERIFY(resultMatrix + numRows * numCols <= rightMatrix || rightMatrix + numInner * numCols <= resultMatrix);
+
+	memset(resultMatrix, 0, numRows * numCols * sizeof(double));
+
+	switch(GetMatrixKernel())
+	{
+		case AVX512Kernel:
+			MultiplyMatricesAVX512(leftMatrix, rightMatrix, numRows, numInner, numCols, resultMatrix);
+			break;
+		case AVX2Kernel:
+			MultiplyMatricesAVX2(leftMatrix, rightMatrix, numRows, numInner, numCols, resultMatrix);
+			break;
+		default:
+			MultiplyMatricesScalar(leftMatrix, rightMatrix, numRows, numInner, numCols, resultMatrix);
+			break;
 	}
 
-	return covers;
+#if CHECK_MATRIX_PRODUCTS
+	// sanity check: compare with the straightforward implementation, relatively to the magnitude of the terms of each entry 
+	// (i.e. the entry of |leftMatrix| * |rightMatrix|), which bounds the round-off errors whatever the order of the sums
+	double* check = (double*)Allocate(numRows * numCols * sizeof(double));
+	double* magnitude = (double*)Allocate(numRows * numCols * sizeof(double));
+	double* absLeft = (double*)Allocate(numRows * numInner * sizeof(double));
+	double* absRight = (double*)Allocate(numInner * numCols * sizeof(double));
+	VERIFY(check != NULL && magnitude != NULL && absLeft != NULL && absRight != NULL);
+	memset(check, 0, numRows * numCols * sizeof(double));
+	memset(magnitude, 0, numRows * numCols * sizeof(double));
+
+	for(ull index = 0; index < numRows * numInner; index++) { absLeft[index] = ABS(leftMatrix[index]); }
+	for(ull index = 0; index < numInner * numCols; index++) { absRight[index] = ABS(rightMatrix[index]); }
 
-  // Bouml preserved body end 000C5211
+	MultiplyMatricesReference(leftMatrix, rightMatrix, numRows, numInner, numCols, check);
+	MultiplyMatricesReference(absLeft, absRight, numRows, numInner, numCols, magnitude);
+
+	for(ull index = 0; index < numRows * numCols; index++)
+	{
+		VERIFY(ABS(check[index] - resultMatrix[index]) <= GEMM_CHECK_TOLERANCE * magnitude[index]);
+	}
+
+	Free(absRight); Free(absLeft);
+	Free(magnitude); Free(check);
+#endif
+
+  // Bouml preserved body end 000C0891
 }
 
-//This implementation is heavily inspired from the code of Dariush Lotfi (June 2008).
-//See http://csclab.murraystate.edu/bob.pilgrim/445/munkres.html for the algorithm itself.
-void Algorithms::MinimumCostAssignment(ll* costMatrix, ll numItems, ll* assignment)
+bool Algorithms::SetMatrixKernel(MatrixKernel kernel)
 {
-  // Bouml preserved body begin 000C5291
+  // Bouml preserved body begin 000C0911
+
+	if(IsMatrixKernelSupported(kernel) == false)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
+
+	__sync_lock_test_and_set(&matrixKernel, kernel);
 
-	ll n = numItems;
+	return true;
+
+  // Bouml preserved body end 000C0911
+}
 
-	// Starred zeros indicates assignment pairs when the algorithm
-	// is finished; so there is no need to define a new vector.
-	ll* starred = assignment;
+MatrixKernel Algorithms::GetMatrixKernel()
+{
+  // Bouml preserved body begin 000C0991
 
-	// Allocate memory for primed
-	ull primedByteSize = n * sizeof(ll);
-	ll* primed = (ll*)Allocate(primedByteSize);
-	VERIFY(primed != NULL); memset(primed, 0, primedByteSize);
+	MatrixKernel kernel = matrixKernel;
+	if(kernel != AutoKernel) { return kernel; }
 
-	// Allocate M, same as weight matrix but with an extra line and column
-	ull matrixByteSize = (n+1) * (n+1) * sizeof(ll);
-	ll* M = (ll*)Allocate(matrixByteSize);
-	VERIFY(M != NULL); memset(M, 0, matrixByteSize);
+	// resolve the automatic selection (concurrent callers resolve it to the same kernel), and publish it unless a kernel has been set meanwhile
+	if(IsMatrixKernelSupported(AVX512Kernel) == true) { kernel = AVX512Kernel; }
+	else if(IsMatrixKernelSupported(AVX2Kernel) == true) { kernel = AVX2Kernel; }
+	else { kernel = ScalarKernel; }
 
-	// Initialize M
-	for(ll i = 0; i < n; i++)
+	__sync_bool_compare_and_swap(&matrixKernel, AutoKernel, kernel);
+
+	return kernel;
+
+  // Bouml preserved body end 000C0991
+}
+
+bool Algorithms::IsMatrixKernelSupported(MatrixKernel kernel)
+{
+  // Bouml preserved body begin 000C0A11
+
+	switch(kernel)
 	{
-		for(ll j = 0; j < n; j++)
-		{
-			M[GET_INDEX(i, j, n+1)] = costMatrix[GET_INDEX(i, j, n)]; // notice: n+1 vs. n
-		}
+		case AutoKernel:
+		case ScalarKernel:
+			return true;
+#ifdef GEMM_X86
+		case AVX2Kernel:
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		case AVX512Kernel:
+			return __builtin_cpu_supports("avx512f");
+#endif
+		default:
+			return false;
 	}
 
-	// Note: covered-flag row & column of M (i.e. row & column having index n) indicate which rows or columns are covered.
-	for(ll i=0;i<n;i++) { M[GET_INDEX(i, n, n+1)] = 0; }
-	for(ll j=0;j<n;j++) { M[GET_INDEX(n, j, n+1)] = 0; }
+  // Bouml preserved body end 000C0A11
+}
 
-	// Initialize starred and primed arrays.
-	// If M[GET_INDEX(i, j, n+1)] is a starred zero, starred[i] has the value of j and if
-	// there is no starred zero at the row i, starred[i] has the value of -1.
-	// The same is true for primed zeros and primed vector values.
-	for(ll i=0;i<n;i++)
+void Algorithms::MultiplyMatricesReference(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix)
+{
+  // Bouml preserved body begin 000C0A91
+
+	for(ull i = 0; i < numRows; i++)
 	{
-		starred[i] = -1;
-		primed[i] = -1;
+		for(ull j = 0; j < numCols; j++)
+		{
+			double sum = 0.0;
+			for(ull k = 0; k < numInner; k++)
+			{
+				ull leftIndex = GET_INDEX(i, k, numInner);
+				ull rightIndex = GET_INDEX(k, j, numCols);
+				sum += leftMatrix[leftIndex] * rightMatrix[rightIndex];
+			}
+
+			ull resIndex = GET_INDEX(i, j, numCols);
+			resultMatrix[resIndex] += sum;
+		}
 	}
 
-	//Step 0: Making reduced cost matrix
-	ReduceCostMatrix(M, n);
+  // Bouml preserved body end 000C0A91
+}
 
-	//Step 1: Marking some zeros with star for beginning
-	ll covers = StarArbitraryZeros(M, starred, n);
+void Algorithms::MultiplyMatricesScalar(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix)
+{
+  // Bouml preserved body begin 000C0B11
 
-	while(covers != n)
+	for(ull kk = 0; kk < numInner; kk += GEMM_BLOCK_INNER)
 	{
-		//Steps 2 and 3: Changing or adding the cover lines until all zeros are covered
-		covers = CoverAllZeros(M, starred, primed, n, covers);
-		if(covers == n) { break; }
+		ull kEnd = MIN(kk + GEMM_BLOCK_INNER, numInner);
+		for(ull jj = 0; jj < numCols; jj += GEMM_BLOCK_COLS)
+		{
+			ull jEnd = MIN(jj + GEMM_BLOCK_COLS, numCols);
+			ull jTiles = jj + ((jEnd - jj) / 4) * 4;
+			for(ull ii = 0; ii < numRows; ii += GEMM_BLOCK_ROWS)
+			{
+				ull iEnd = MIN(ii + GEMM_BLOCK_ROWS, numRows);
+				ull iTiles = ii + ((iEnd - ii) / 4) * 4;
+
+				// 4 x 4 register tiles
+				for(ull i = ii; i < iTiles; i += 4)
+				{
+					const double* a0 = &leftMatrix[GET_INDEX(i, 0, numInner)];
+					const double* a1 = a0 + numInner; const double* a2 = a1 + numInner; const double* a3 = a2 + numInner;
+					for(ull j = jj; j < jTiles; j += 4)
+					{
+						double* c0 = &resultMatrix[GET_INDEX(i, j, numCols)];
+						double* c1 = c0 + numCols; double* c2 = c1 + numCols; double* c3 = c2 + numCols;
+
+						double c00 = c0[0], c01 = c0[1], c02 = c0[2], c03 = c0[3];
+						double c10 = c1[0], c11 = c1[1], c12 = c1[2], c13 = c1[3];
+						double c20 = c2[0], c21 = c2[1], c22 = c2[2], c23 = c2[3];
+						double c30 = c3[0], c31 = c3[1], c32 = c3[2], c33 = c3[3];
+
+						for(ull k = kk; k < kEnd; k++)
+						{
+							const double* b = &rightMatrix[GET_INDEX(k, j, numCols)];
+							const double b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3];
+							double a = a0[k]; c00 += a * b0; c01 += a * b1; c02 += a * b2; c03 += a * b3;
+							a = a1[k]; c10 += a * b0; c11 += a * b1; c12 += a * b2; c13 += a * b3;
+							a = a2[k]; c20 += a * b0; c21 += a * b1; c22 += a * b2; c23 += a * b3;
+							a = a3[k]; c30 += a * b0; c31 += a * b1; c32 += a * b2; c33 += a * b3;
+						}
+
+						c0[0] = c00; c0[1] = c01; c0[2] = c02; c0[3] = c03;
+						c1[0] = c10; c1[1] = c11; c1[2] = c12; c1[3] = c13;
+						c2[0] = c20; c2[1] = c21; c2[2] = c22; c2[3] = c23;
+						c3[0] = c30; c3[1] = c31; c3[2] = c32; c3[3] = c33;
+					}
+				}
+
+				// edges: remaining columns of the tiled rows, then the remaining rows
+				MultiplyMatricesEdge(leftMatrix, rightMatrix, numInner, numCols, resultMatrix, ii, iTiles, kk, kEnd, jTiles, jEnd);
+				MultiplyMatricesEdge(leftMatrix, rightMatrix, numInner, numCols, resultMatrix, iTiles, iEnd, kk, kEnd, jj, jEnd);
+			}
+		}
+	}
 
-		//Step 4: Finding smallest uncovered value and add it to every element of each covered row,
-		// subtract it from every element of each uncovered column)
-		ll min = LONG_LONG_MAX;
-		for(ll i=0;i<n;i++) { for(ll j=0;j<n;j++) { if(M[GET_INDEX(i, n, n+1)] != 1 && M[GET_INDEX(n, j, n+1)] != 1 && M[GET_INDEX(i, j, n+1)] < min) { min = M[GET_INDEX(i, j, n+1)]; } } }
+  // Bouml preserved body end 000C0B11
+}
 
-		for(ll i=0;i<n;i++)
+#ifdef GEMM_X86
+__attribute__((target("avx2,fma")))
+#endif
+void Algorithms::MultiplyMatricesAVX2(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix)
+{
+  // Bouml preserved body begin 000C0B91
+
+#ifdef GEMM_X86
+	for(ull kk = 0; kk < numInner; kk += GEMM_BLOCK_INNER)
+	{
+		ull kEnd = MIN(kk + GEMM_BLOCK_INNER, numInner);
+		for(ull jj = 0; jj < numCols; jj += GEMM_BLOCK_COLS)
 		{
-			if(M[GET_INDEX(i, n, n+1)] == 1)
+			ull jEnd = MIN(jj + GEMM_BLOCK_COLS, numCols);
+			ull jTiles = jj + ((jEnd - jj) / 8) * 8;
+			for(ull ii = 0; ii < numRows; ii += GEMM_BLOCK_ROWS)
 			{
-				for(ll j=0;j<n;j++) { M[GET_INDEX(i, j, n+1)] += min; }
+				ull iEnd = MIN(ii + GEMM_BLOCK_ROWS, numRows);
+				ull iTiles = ii + ((iEnd - ii) / 4) * 4;
+
+				// 4 x 8 register tiles
+				for(ull i = ii; i < iTiles; i += 4)
+				{
+					const double* a0 = &leftMatrix[GET_INDEX(i, 0, numInner)];
+					const double* a1 = a0 + numInner; const double* a2 = a1 + numInner; const double* a3 = a2 + numInner;
+					for(ull j = jj; j < jTiles; j += 8)
+					{
+						double* c0 = &resultMatrix[GET_INDEX(i, j, numCols)];
+						double* c1 = c0 + numCols; double* c2 = c1 + numCols; double* c3 = c2 + numCols;
+
+						__m256d c00 = _mm256_loadu_pd(c0), c01 = _mm256_loadu_pd(c0 + 4);
+						__m256d c10 = _mm256_loadu_pd(c1), c11 = _mm256_loadu_pd(c1 + 4);
+						__m256d c20 = _mm256_loadu_pd(c2), c21 = _mm256_loadu_pd(c2 + 4);
+						__m256d c30 = _mm256_loadu_pd(c3), c31 = _mm256_loadu_pd(c3 + 4);
+
+						for(ull k = kk; k < kEnd; k++)
+						{
+							const double* b = &rightMatrix[GET_INDEX(k, j, numCols)];
+							const __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+							__m256d a = _mm256_broadcast_sd(&a0[k]); c00 = _mm256_fmadd_pd(a, b0, c00); c01 = _mm256_fmadd_pd(a, b1, c01);
+							a = _mm256_broadcast_sd(&a1[k]); c10 = _mm256_fmadd_pd(a, b0, c10); c11 = _mm256_fmadd_pd(a, b1, c11);
+							a = _mm256_broadcast_sd(&a2[k]); c20 = _mm256_fmadd_pd(a, b0, c20); c21 = _mm256_fmadd_pd(a, b1, c21);
+							a = _mm256_broadcast_sd(&a3[k]); c30 = _mm256_fmadd_pd(a, b0, c30); c31 = _mm256_fmadd_pd(a, b1, c31);
+						}
+
+						_mm256_storeu_pd(c0, c00); _mm256_storeu_pd(c0 + 4, c01);
+						_mm256_storeu_pd(c1, c10); _mm256_storeu_pd(c1 + 4, c11);
+						_mm256_storeu_pd(c2, c20); _mm256_storeu_pd(c2 + 4, c21);
+						_mm256_storeu_pd(c3, c30); _mm256_storeu_pd(c3 + 4, c31);
+					}
+				}
+
+				// edges: remaining columns of the tiled rows, then the remaining rows
+				MultiplyMatricesEdge(leftMatrix, rightMatrix, numInner, numCols, resultMatrix, ii, iTiles, kk, kEnd, jTiles, jEnd);
+				MultiplyMatricesEdge(leftMatrix, rightMatrix, numInner, numCols, resultMatrix, iTiles, iEnd, kk, kEnd, jj, jEnd);
 			}
 		}
+	}
+#else
+	MultiplyMatricesScalar(leftMatrix, rightMatrix, numRows, numInner, numCols, resultMatrix);
+#endif
 
-		for(ll j=0;j<n;j++)
+  // Bouml preserved body end 000C0B91
+}
+
+#ifdef GEMM_X86
+__attribute__((target("avx512f")))
+#endif
+void Algorithms::MultiplyMatricesAVX512(const double* leftMatrix, const double* rightMatrix, ull numRows, ull numInner, ull numCols, double* resultMatrix)
+{
+  // Bouml preserved body begin 000C0C11
+
+#ifdef GEMM_X86
+	for(ull kk = 0; kk < numInner; kk += GEMM_BLOCK_INNER)
+	{
+		ull kEnd = MIN(kk + GEMM_BLOCK_INNER, numInner);
+		for(ull jj = 0; jj < numCols; jj += GEMM_BLOCK_COLS)
 		{
-			if(M[GET_INDEX(n, j, n+1)] == 0)
+			ull jEnd = MIN(jj + GEMM_BLOCK_COLS, numCols);
+			ull jTiles = jj + ((jEnd - jj) / 16) * 16;
+			for(ull ii = 0; ii < numRows; ii += GEMM_BLOCK_ROWS)
 			{
-				for(ll i=0;i<n;i++) { M[GET_INDEX(i, j, n+1)] -= min; }
+				ull iEnd = MIN(ii + GEMM_BLOCK_ROWS, numRows);
+				ull iTiles = ii + ((iEnd - ii) / 4) * 4;
+
+				// 4 x 16 register tiles
+				for(ull i = ii; i < iTiles; i += 4)
+				{
+					const double* a0 = &leftMatrix[GET_INDEX(i, 0, numInner)];
+					const double* a1 = a0 + numInner; const double* a2 = a1 + numInner; const double* a3 = a2 + numInner;
+					for(ull j = jj; j < jTiles; j += 16)
+					{
+						double* c0 = &resultMatrix[GET_INDEX(i, j, numCols)];
+						double* c1 = c0 + numCols; double* c2 = c1 + numCols; double* c3 = c2 + numCols;
+
+						__m512d c00 = _mm512_loadu_pd(c0), c01 = _mm512_loadu_pd(c0 + 8);
+						__m512d c10 = _mm512_loadu_pd(c1), c11 = _mm512_loadu_pd(c1 + 8);
+						__m512d c20 = _mm512_loadu_pd(c2), c21 = _mm512_loadu_pd(c2 + 8);
+						__m512d c30 = _mm512_loadu_pd(c3), c31 = _mm512_loadu_pd(c3 + 8);
+
+						for(ull k = kk; k < kEnd; k++)
+						{
+							const double* b = &rightMatrix[GET_INDEX(k, j, numCols)];
+							const __m512d b0 = _mm512_loadu_pd(b), b1 = _mm512_loadu_pd(b + 8);
+							__m512d a = _mm512_set1_pd(a0[k]); c00 = _mm512_fmadd_pd(a, b0, c00); c01 = _mm512_fmadd_pd(a, b1, c01);
+							a = _mm512_set1_pd(a1[k]); c10 = _mm512_fmadd_pd(a, b0, c10); c11 = _mm512_fmadd_pd(a, b1, c11);
+							a = _mm512_set1_pd(a2[k]); c20 = _mm512_fmadd_pd(a, b0, c20); c21 = _mm512_fmadd_pd(a, b1, c21);
+							a = _mm512_set1_pd(a3[k]); c30 = _mm512_fmadd_pd(a, b0, c30); c31 = _mm512_fmadd_pd(a, b1, c31);
+						}
+
+						_mm512_storeu_pd(c0, c00); _mm512_storeu_pd(c0 + 8, c01);
+						_mm512_storeu_pd(c1, c10); _mm512_storeu_pd(c1 + 8, c11);
+						_mm512_storeu_pd(c2, c20); _mm512_storeu_pd(c2 + 8, c21);
+						_mm512_storeu_pd(c3, c30); _mm512_storeu_pd(c3 + 8, c31);
+					}
+				}
+
+				// edges: remaining columns of the tiled rows, then the remaining rows
+				MultiplyMatricesEdge(leftMatrix, rightMatrix, numInner, numCols, resultMatrix, ii, iTiles, kk, kEnd, jTiles, jEnd);
+				MultiplyMatricesEdge(leftMatrix, rightMatrix, numInner, numCols, resultMatrix, iTiles, iEnd, kk, kEnd, jj, jEnd);
 			}
 		}
 	}
+#else
+	MultiplyMatricesScalar(leftMatrix, rightMatrix, numRows, numInner, numCols, resultMatrix);
+#endif
 
-	// cleanup
-	Free(primed);
-	Free(M);
+  // Bouml preserved body end 000C0C11
+}
 
-  // Bouml preserved body end 000C5291
+bool Algorithms::ComputeSteadyStateVector(const double* transitionMatrix, ull dimension, double* steadyStateVector, SteadyStateMethod method, ull* iterations, double* residual)
+{
+  // Bouml preserved body begin 000C0511
+
+	VERIFY(transitionMatrix != NULL && steadyStateVector != NULL && dimension != 0);
+
+	ull iter = 1;
+	bool success = false;
+
+	switch(method)
+	{
+		case MatrixSquaring: success = SteadyStateByMatrixSquaring(transitionMatrix, dimension, steadyStateVector, &iter); break;
+		case PowerIteration: success = SteadyStateByPowerIteration(transitionMatrix, dimension, steadyStateVector, &iter); break;
+		case GaussSeidel: success = SteadyStateByGaussSeidel(transitionMatrix, dimension, steadyStateVector, &iter); break;
+		case DenseLinearSolve: success = SteadyStateByDenseLinearSolve(transitionMatrix, dimension, steadyStateVector); break;
+		default: CODING_ERROR; break;
+	}
+
+	if(iterations != NULL) { *iterations = iter; }
+
+	if(residual != NULL)
+	{
+		double* temp = (double*)Allocate(dimension * sizeof(double));
+		VERIFY(temp != NULL);
+
+		*residual = SteadyStateResidual(transitionMatrix, dimension, steadyStateVector, temp);
+
+		Free(temp);
+	}
+
+	return success;
+
+  // Bouml preserved body end 000C0511
 }
 
+double Algorithms::SteadyStateResidual(const double* transitionMatrix, ull dimension, const double* vector, double* temp)
+{
+  // Bouml preserved body begin 000C0591
 
-void Algorithms::MultiplySquareMatrices(const double* leftMatrix, const double* rightMatrix, ull dimension, double* resultMatrix)
+	memset(temp, 0, dimension * sizeof(double));
+
+	// temp = vector * transitionMatrix (row by row, so that the matrix is read sequentially)
+	for(ull i = 0; i < dimension; i++)
+	{
+		double vi = vector[i];
+		if(vi == 0.0) { continue; }
+
+		const double* row = &transitionMatrix[GET_INDEX(i, 0, dimension)];
+		for(ull j = 0; j < dimension; j++) { temp[j] += vi * row[j]; }
+	}
 
+	double residual = 0.0;
+	for(ull j = 0; j < dimension; j++) { residual += ABS(temp[j] - vector[j]); }
+
+	return residual;
+
+  // Bouml preserved body end 000C0591
+}
+
+bool Algorithms::SteadyStateByMatrixSquaring(const double* transitionMatrix, ull dimension, double* steadyStateVector, ull* iterations)
 {
-  // Bouml preserved body begin 00081A91
+  // Bouml preserved body begin 000C0611
 
-	VERIFY(leftMatrix != NULL && rightMatrix != NULL && resultMatrix != NULL && dimension != 0);
+	const double epsilon = EPSILON;
+	const ull maxIterations = 30;
+	const ull minIterations = 6;
+
+	ull matrixByteSize = dimension * dimension * sizeof(double);
+	double* res = (double*)Allocate(matrixByteSize);
+	VERIFY(res != NULL);
+	memcpy(res, transitionMatrix, matrixByteSize);
+
+	double* temp = (double*)Allocate(matrixByteSize);
+	VERIFY(temp != NULL);
+	memset(temp, 0, matrixByteSize);
+
+	const double normalizationFactor = dimension * dimension;
+	ull iter = 0;
+	for(iter = 1; iter < maxIterations; iter++)
+	{
+		double delta = 0.0;
+
+		MultiplySquareMatrices(res, res, dimension, temp);
+
+		for(ull index = 0; index < dimension * dimension; index++) { delta += ABS(temp[index] - res[index]); }
+
+		delta /= normalizationFactor;
+
+		if(iter >= minIterations && delta < epsilon){ break; }
+
+		memcpy(res, temp, matrixByteSize);
+	}
+
+	// all rows converge to the steady-state vector: keep the first one
+	memcpy(steadyStateVector, &res[GET_INDEX(0, 0, dimension)], dimension * sizeof(double));
+
+	Free(temp);
+	Free(res);
+
+	*iterations = iter;
+
+	return true;
+
+  // Bouml preserved body end 000C0611
+}
+
+bool Algorithms::SteadyStateByPowerIteration(const double* transitionMatrix, ull dimension, double* steadyStateVector, ull* iterations)
+{
+  // Bouml preserved body begin 000C0691
+
+	double* x = steadyStateVector;
+	for(ull i = 0; i < dimension; i++) { x[i] = 1.0 / dimension; }
+
+	double* next = (double*)Allocate(dimension * sizeof(double));
+	VERIFY(next != NULL);
+
+	bool converged = false;
+	ull iter = 0;
+	for(iter = 1; iter <= SS_MAX_ITERATIONS; iter++)
+	{
+		double delta = SteadyStateResidual(transitionMatrix, dimension, x, next); // next = x * P
+
+		if(delta < SS_TOLERANCE) { memcpy(x, next, dimension * sizeof(double)); converged = true; break; }
+
+		// lazy step: x = (x + x * P) / 2 has the same fixed point, but (unlike x = x * P) it also converges for periodic chains
+		double sum = 0.0;
+		for(ull j = 0; j < dimension; j++) { x[j] = 0.5 * (x[j] + next[j]); sum += x[j]; }
+		for(ull j = 0; j < dimension; j++) { x[j] /= sum; }
+	}
+
+	Free(next);
+
+	*iterations = MIN(iter, (ull)SS_MAX_ITERATIONS);
+
+	return converged;
+
+  // Bouml preserved body end 000C0691
+}
+
+bool Algorithms::SteadyStateByGaussSeidel(const double* transitionMatrix, ull dimension, double* steadyStateVector, ull* iterations)
+{
+  // Bouml preserved body begin 000C0711
+
+	// we solve x = x * P, i.e. x[j] = sum_i x[i] * P[i][j], so we need the columns of P: transpose it once
+	ull matrixByteSize = dimension * dimension * sizeof(double);
+	double* transposed = (double*)Allocate(matrixByteSize);
+	VERIFY(transposed != NULL);
 
 	for(ull i = 0; i < dimension; i++)
 	{
+		for(ull j = 0; j < dimension; j++) { transposed[GET_INDEX(j, i, dimension)] = transitionMatrix[GET_INDEX(i, j, dimension)]; }
+	}
+
+	double* temp = (double*)Allocate(dimension * sizeof(double));
+	VERIFY(temp != NULL);
+
+	double* x = steadyStateVector;
+	for(ull i = 0; i < dimension; i++) { x[i] = 1.0 / dimension; }
+
+	bool converged = false;
+	ull iter = 0;
+	for(iter = 1; iter <= SS_MAX_ITERATIONS; iter++)
+	{
+		// one sweep (using the values updated so far)
 		for(ull j = 0; j < dimension; j++)
 		{
+			const double* column = &transposed[GET_INDEX(j, 0, dimension)];
+
 			double sum = 0.0;
-			for(ull k = 0; k < dimension; k++)
-			{
-				ull leftIndex = GET_INDEX(i, k, dimension);
-				ull rightIndex = GET_INDEX(k, j, dimension);
-				sum += leftMatrix[leftIndex] * rightMatrix[rightIndex];
-			}
+			for(ull i = 0; i < dimension; i++) { sum += column[i] * x[i]; }
+
+			double stay = column[j];
+			sum -= stay * x[j];
 
-			ull resIndex = GET_INDEX(i, j, dimension);
-			resultMatrix[resIndex] = sum;
+			if(stay < 1.0) { x[j] = sum / (1.0 - stay); } // otherwise j is absorbing: leave it as is
 		}
+
+		NORMALIZE_VECTOR(x, dimension);
+
+		if(SteadyStateResidual(transitionMatrix, dimension, x, temp) < SS_TOLERANCE) { converged = true; break; }
 	}
 
-  // Bouml preserved body end 00081A91
+	Free(temp);
+	Free(transposed);
+
+	*iterations = MIN(iter, (ull)SS_MAX_ITERATIONS);
+
+	return converged;
+
+  // Bouml preserved body end 000C0711
+}
+
+bool Algorithms::SteadyStateByDenseLinearSolve(const double* transitionMatrix, ull dimension, double* steadyStateVector)
+{
+  // Bouml preserved body begin 000C0791
+
+	ull n = dimension;
+
+	// the system is (I - P)^T x = 0, where the last equation is replaced by sum_i x[i] = 1
+	double* A = (double*)Allocate(n * n * sizeof(double));
+	VERIFY(A != NULL);
+
+	double* b = steadyStateVector;
+	memset(b, 0, n * sizeof(double));
+	b[n - 1] = 1.0;
+
+	for(ull i = 0; i < n; i++)
+	{
+		for(ull j = 0; j < n; j++)
+		{
+			A[GET_INDEX(j, i, n)] = ((i == j) ? 1.0 : 0.0) - transitionMatrix[GET_INDEX(i, j, n)];
+		}
+	}
+	for(ull i = 0; i < n; i++) { A[GET_INDEX(n - 1, i, n)] = 1.0; }
+
+	// Gaussian elimination with partial pivoting
+	bool singular = false;
+	for(ull k = 0; k < n; k++)
+	{
+		ull pivotRow = k;
+		for(ull r = k + 1; r < n; r++) { if(ABS(A[GET_INDEX(r, k, n)]) > ABS(A[GET_INDEX(pivotRow, k, n)])) { pivotRow = r; } }
+
+		if(ABS(A[GET_INDEX(pivotRow, k, n)]) < DBL_EPSILON) { singular = true; break; }
+
+		if(pivotRow != k)
+		{
+			for(ull c = k; c < n; c++) { double tmp = A[GET_INDEX(k, c, n)]; A[GET_INDEX(k, c, n)] = A[GET_INDEX(pivotRow, c, n)]; A[GET_INDEX(pivotRow, c, n)] = tmp; }
+			double tmp = b[k]; b[k] = b[pivotRow]; b[pivotRow] = tmp;
+		}
+
+		double pivot = A[GET_INDEX(k, k, n)];
+		for(ull r = k + 1; r < n; r++)
+		{
+			double factor = A[GET_INDEX(r, k, n)] / pivot;
+			if(factor == 0.0) { continue; }
+
+			for(ull c = k; c < n; c++) { A[GET_INDEX(r, c, n)] -= factor * A[GET_INDEX(k, c, n)]; }
+			b[r] -= factor * b[k];
+		}
+	}
+
+	if(singular == false)
+	{
+		// back substitution
+		for(ull k = n; k-- > 0;)
+		{
+			double sum = b[k];
+			for(ull c = k + 1; c < n; c++) { sum -= A[GET_INDEX(k, c, n)] * b[c]; }
+			b[k] = sum / A[GET_INDEX(k, k, n)];
+		}
+
+		// remove round-off errors
+		for(ull i = 0; i < n; i++) { if(b[i] < 0.0) { b[i] = 0.0; } }
+		NORMALIZE_VECTOR(b, n);
+
+		// on (nearly) reducible chains the system is ill-conditioned: reject inaccurate solutions
+		if(SteadyStateResidual(transitionMatrix, n, b, A) > sqrt(SS_TOLERANCE)) { singular = true; }
+	}
+
+	Free(A);
+
+	return (singular == false);
+
+  // Bouml preserved body end 000C0791
 }
 
 bool Algorithms::GetSteadyStateVectorOfSubChain(double* fullChainSS, ull timePeriodId, double** subChainSS, bool inclDummyTPs)
@@ -300,6 +880,36 @@ bool Algorithms::GetSteadyStateVectorOfSubChain(double* fullChainSS, ull timePer
 
 	if(fullChainSS == NULL || subChainSS == NULL) { return false; }
 
+	// get location parameters
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	// allocated here, but freed by the caller
+	ull resVectorByteSize = numLoc * sizeof(double);
+	double* resVector = (double*)Allocate(resVectorByteSize);
+	memset(resVector, 0, resVectorByteSize);
+
+	if(GetSteadyStateVectorOfSubChain(fullChainSS, timePeriodId, resVector, inclDummyTPs) == false)
+	{
+		Free(resVector);
+		return false;
+	}
+
+	*subChainSS = resVector;
+
+
+	return true;
+
+  // Bouml preserved body end 000ADF91
+}
+
+bool Algorithms::GetSteadyStateVectorOfSubChain(const double* fullChainSS, ull timePeriodId, double* subChainSS, bool inclDummyTPs)
+{
+  // Bouml preserved body begin 000C1111
+
+	if(fullChainSS == NULL || subChainSS == NULL) { return false; }
+
 	// get time period parameters
 	ull numPeriods = 0; TPInfo tpInfo;
 	VERIFY(Parameters::GetInstance()->GetTimePeriodInfo(&numPeriods, &tpInfo) == true);
@@ -314,18 +924,13 @@ bool Algorithms::GetSteadyStateVectorOfSubChain(double* fullChainSS, ull timePer
 	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
 	ull numLoc = maxLoc - minLoc + 1;
 
-	// allocated here, but freed by the caller
-	ull resVectorByteSize = numLoc * sizeof(double);
-	double* resVector = (double*)Allocate(resVectorByteSize);
-	memset(resVector, 0, resVectorByteSize);
-
 	// extract the subvector
 	ull startState = (timePeriodId - minPeriod)*numLoc; double sum = 0.0;
 	for(ull loc = minLoc; loc <= maxLoc; loc++)
 	{
 		ull locIndex = (loc - minLoc);
-		resVector[locIndex] = fullChainSS[startState + locIndex];
-		sum += resVector[locIndex];
+		subChainSS[locIndex] = fullChainSS[startState + locIndex];
+		sum += subChainSS[locIndex];
 	}
 	VERIFY(sum != 0.0);
 
@@ -334,18 +939,15 @@ bool Algorithms::GetSteadyStateVectorOfSubChain(double* fullChainSS, ull timePer
 	for(ull loc = minLoc; loc <= maxLoc; loc++)
 	{
 		ull locIndex = (loc - minLoc);
-		resVector[locIndex] /= sum;
-		check += resVector[locIndex];
+		subChainSS[locIndex] /= sum;
+		check += subChainSS[locIndex];
 	}
 	VERIFY(abs(check-1) < EPSILON); // sanity check
 
 
-	*subChainSS = resVector;
-
-
 	return true;
 
-  // Bouml preserved body end 000ADF91
+  // Bouml preserved body end 000C1111
 }
 
 bool Algorithms::GetTransitionVectorOfSubChain(double* fullChainTransitionMatrix, ull tp1, ull loc1, ull tp2, double** transitionVector, bool inclDummyTPs)
@@ -409,4 +1011,358 @@ bool Algorithms::GetTransitionVectorOfSubChain(double* fullChainTransitionMatrix
 }
 
 
+bool Algorithms::GetTransitionMatricesOfSubChains(const double* fullChainTransitionMatrix, double** transitionMatrices, bool inclDummyTPs)
+{
+  // Bouml preserved body begin 000C0D91
+
+	if(fullChainTransitionMatrix == NULL || transitionMatrices == NULL) { return false; }
+
+	// get time period parameters
+	ull numPeriods = 0; TPInfo tpInfo;
+	VERIFY(Parameters::GetInstance()->GetTimePeriodInfo(&numPeriods, &tpInfo) == true);
+	if(inclDummyTPs == true) { numPeriods = tpInfo.numPeriodsInclDummies; }
+
+	// get location parameters
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	ull numStates = numPeriods * numLoc;
+
+	// allocated here, but freed by the caller
+	ull resByteSize = numStates * numStates * sizeof(double);
+	double* res = (double*)Allocate(resByteSize);
+	VERIFY(res != NULL);
+	memset(res, 0, resByteSize);
+
+	for(ull tp1Idx = 0; tp1Idx < numPeriods; tp1Idx++)
+	{
+		for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
+		{
+			const double* fullRow = &fullChainTransitionMatrix[GET_INDEX(tp1Idx * numLoc + loc1Idx, 0, numStates)];
+			for(ull tp2Idx = 0; tp2Idx < numPeriods; tp2Idx++)
+			{
+				const double* block = &fullRow[tp2Idx * numLoc];
+				double* resVector = &res[GET_INDEX_4D(tp1Idx, tp2Idx, loc1Idx, 0, numPeriods, numLoc, numLoc)];
+
+				double sum = 0.0;
+				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++) { sum += block[loc2Idx]; }
+
+				if(sum == 0.0) { continue; } // unreachable time period
+
+				// renormalize
+				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++) { resVector[loc2Idx] = block[loc2Idx] / sum; }
+			}
+		}
+	}
+
+	*transitionMatrices = res;
+
+	return true;
+
+  // Bouml preserved body end 000C0D91
+}
+
+bool Algorithms::GetSparseTransitionMatrix(const double* matrix, ull dimension, SparseTransitionMatrix* sparseMatrix)
+{
+  // Bouml preserved body begin 000C1D11
+
+	if(matrix == NULL || dimension == 0 || sparseMatrix == NULL) { return false; }
+
+	ull numNonZeros = 0;
+	for(ull index = 0; index < dimension * dimension; index++) { if(matrix[index] != 0.0) { numNonZeros++; } }
+
+	memset(sparseMatrix, 0, sizeof(SparseTransitionMatrix));
+
+	sparseMatrix->dimension = dimension;
+	sparseMatrix->numNonZeros = numNonZeros;
+	sparseMatrix->density = (double)numNonZeros / (double)(dimension * dimension);
+
+	// the dense matrix is used above the threshold: only its density is kept
+	if(sparseMatrix->density >= SPARSE_TRANSITION_DENSITY) { return true; }
+
+	VERIFY(dimension < (ull)((uint32)-1) && numNonZeros < (ull)((uint32)-1)); // the indices are stored on 32 bits
+
+	ull startByteSize = (dimension + 1) * sizeof(uint32);
+	ull indicesByteSize = MAX(numNonZeros, 1) * sizeof(uint32);
+	ull valuesByteSize = MAX(numNonZeros, 1) * sizeof(double);
+
+	sparseMatrix->rowStart = (uint32*)Allocate(startByteSize);
+	sparseMatrix->rowColumns = (uint32*)Allocate(indicesByteSize);
+	sparseMatrix->rowValues = (double*)Allocate(valuesByteSize);
+	sparseMatrix->columnStart = (uint32*)Allocate(startByteSize);
+	sparseMatrix->columnRows = (uint32*)Allocate(indicesByteSize);
+	sparseMatrix->columnValues = (double*)Allocate(valuesByteSize);
+
+	VERIFY(sparseMatrix->rowStart != NULL && sparseMatrix->rowColumns != NULL && sparseMatrix->rowValues != NULL);
+	VERIFY(sparseMatrix->columnStart != NULL && sparseMatrix->columnRows != NULL && sparseMatrix->columnValues != NULL);
+
+	// rows
+	ull position = 0;
+	for(ull row = 0; row < dimension; row++)
+	{
+		sparseMatrix->rowStart[row] = (uint32)position;
+		for(ull column = 0; column < dimension; column++)
+		{
+			double value = matrix[GET_INDEX(row, column, dimension)];
+			if(value == 0.0) { continue; }
+
+			sparseMatrix->rowColumns[position] = (uint32)column;
+			sparseMatrix->rowValues[position] = value;
+			position++;
+		}
+	}
+	sparseMatrix->rowStart[dimension] = (uint32)position;
+
+	// columns
+	position = 0;
+	for(ull column = 0; column < dimension; column++)
+	{
+		sparseMatrix->columnStart[column] = (uint32)position;
+		for(ull row = 0; row < dimension; row++)
+		{
+			double value = matrix[GET_INDEX(row, column, dimension)];
+			if(value == 0.0) { continue; }
+
+			sparseMatrix->columnRows[position] = (uint32)row;
+			sparseMatrix->columnValues[position] = value;
+			position++;
+		}
+	}
+	sparseMatrix->columnStart[dimension] = (uint32)position;
+
+	return true;
+
+  // Bouml preserved body end 000C1D11
+}
+
+void Algorithms::FreeSparseTransitionMatrix(SparseTransitionMatrix* sparseMatrix)
+{
+  // Bouml preserved body begin 000C1D91
+
+	if(sparseMatrix == NULL) { return; }
+
+	if(sparseMatrix->rowStart != NULL) { Free(sparseMatrix->rowStart); }
+	if(sparseMatrix->rowColumns != NULL) { Free(sparseMatrix->rowColumns); }
+	if(sparseMatrix->rowValues != NULL) { Free(sparseMatrix->rowValues); }
+	if(sparseMatrix->columnStart != NULL) { Free(sparseMatrix->columnStart); }
+	if(sparseMatrix->columnRows != NULL) { Free(sparseMatrix->columnRows); }
+	if(sparseMatrix->columnValues != NULL) { Free(sparseMatrix->columnValues); }
+
+	memset(sparseMatrix, 0, sizeof(SparseTransitionMatrix));
+
+  // Bouml preserved body end 000C1D91
+}
+
+bool Algorithms::GetBlockSparseMatrix(const double* blockPattern, ull numBlockRows, ull blockDimension, BlockSparseMatrix* matrix)
+{
+  // Bouml preserved body begin 000C2811
+
+	if(blockPattern == NULL || numBlockRows == 0 || blockDimension == 0 || matrix == NULL) { return false; }
+
+	ull numBlocks = 0;
+	for(ull index = 0; index < numBlockRows * numBlockRows; index++) { if(blockPattern[index] != 0.0) { numBlocks++; } }
+
+	matrix->numBlockRows = numBlockRows;
+	matrix->blockDimension = blockDimension;
+	matrix->numBlocks = numBlocks;
+
+	matrix->blockRowStart = (ull*)Allocate((numBlockRows + 1) * sizeof(ull));
+	matrix->blockColumns = (ull*)Allocate(MAX(numBlocks, 1) * sizeof(ull));
+	matrix->blockIndex = (ull*)Allocate(numBlockRows * numBlockRows * sizeof(ull));
+
+	ull valuesByteSize = MAX(numBlocks, 1) * blockDimension * blockDimension * sizeof(double);
+	matrix->values = (double*)Allocate(valuesByteSize);
+
+	VERIFY(matrix->blockRowStart != NULL && matrix->blockColumns != NULL && matrix->blockIndex != NULL && matrix->values != NULL);
+	memset(matrix->values, 0, valuesByteSize);
+
+	ull block = 0;
+	for(ull blockRow = 0; blockRow < numBlockRows; blockRow++)
+	{
+		matrix->blockRowStart[blockRow] = block;
+		for(ull blockColumn = 0; blockColumn < numBlockRows; blockColumn++)
+		{
+			ull index = GET_INDEX(blockRow, blockColumn, numBlockRows);
+			if(blockPattern[index] == 0.0) { matrix->blockIndex[index] = BLOCK_SPARSE_NO_BLOCK; continue; }
+
+			matrix->blockIndex[index] = block;
+			matrix->blockColumns[block] = blockColumn;
+			block++;
+		}
+	}
+	matrix->blockRowStart[numBlockRows] = block;
+
+	return true;
+
+  // Bouml preserved body end 000C2811
+}
+
+void Algorithms::FreeBlockSparseMatrix(BlockSparseMatrix* matrix)
+{
+  // Bouml preserved body begin 000C2891
+
+	if(matrix == NULL) { return; }
+
+	if(matrix->blockRowStart != NULL) { Free(matrix->blockRowStart); }
+	if(matrix->blockColumns != NULL) { Free(matrix->blockColumns); }
+	if(matrix->blockIndex != NULL) { Free(matrix->blockIndex); }
+	if(matrix->values != NULL) { Free(matrix->values); }
+
+	memset(matrix, 0, sizeof(BlockSparseMatrix));
+
+  // Bouml preserved body end 000C2891
+}
+
+double* Algorithms::GetBlock(const BlockSparseMatrix* matrix, ull blockRow, ull blockColumn)
+{
+  // Bouml preserved body begin 000C2911
+
+	DEBUG_VERIFY(matrix != NULL && blockRow < matrix->numBlockRows && blockColumn < matrix->numBlockRows);
+
+	ull block = matrix->blockIndex[GET_INDEX(blockRow, blockColumn, matrix->numBlockRows)];
+	if(block == BLOCK_SPARSE_NO_BLOCK) { return NULL; }
+
+	return &matrix->values[block * matrix->blockDimension * matrix->blockDimension];
+
+  // Bouml preserved body end 000C2911
+}
+
+void Algorithms::ExpandBlockSparseMatrix(const BlockSparseMatrix* matrix, double* denseMatrix)
+{
+  // Bouml preserved body begin 000C2991
+
+	VERIFY(matrix != NULL && denseMatrix != NULL);
+
+	ull blockDimension = matrix->blockDimension;
+	ull dimension = matrix->numBlockRows * blockDimension;
+
+	memset(denseMatrix, 0, dimension * dimension * sizeof(double));
+
+	for(ull blockRow = 0; blockRow < matrix->numBlockRows; blockRow++)
+	{
+		for(ull block = matrix->blockRowStart[blockRow]; block < matrix->blockRowStart[blockRow + 1]; block++)
+		{
+			const double* values = &matrix->values[block * blockDimension * blockDimension];
+			ull blockColumn = matrix->blockColumns[block];
+
+			for(ull i = 0; i < blockDimension; i++)
+			{
+				memcpy(&denseMatrix[GET_INDEX(blockRow * blockDimension + i, blockColumn * blockDimension, dimension)], &values[i * blockDimension], blockDimension * sizeof(double));
+			}
+		}
+	}
+
+  // Bouml preserved body end 000C2991
+}
+
+bool Algorithms::CompressToBlockSparseMatrix(const double* denseMatrix, BlockSparseMatrix* matrix)
+{
+  // Bouml preserved body begin 000C2A11
+
+	VERIFY(matrix != NULL && denseMatrix != NULL);
+
+	ull blockDimension = matrix->blockDimension;
+	ull dimension = matrix->numBlockRows * blockDimension;
+
+	for(ull blockRow = 0; blockRow < matrix->numBlockRows; blockRow++)
+	{
+		for(ull blockColumn = 0; blockColumn < matrix->numBlockRows; blockColumn++)
+		{
+			double* values = GetBlock(matrix, blockRow, blockColumn);
+
+			for(ull i = 0; i < blockDimension; i++)
+			{
+				const double* denseRow = &denseMatrix[GET_INDEX(blockRow * blockDimension + i, blockColumn * blockDimension, dimension)];
+
+				if(values != NULL) { memcpy(&values[i * blockDimension], denseRow, blockDimension * sizeof(double)); continue; }
+
+				for(ull j = 0; j < blockDimension; j++) { if(denseRow[j] != 0.0) { return false; } } // non-zero entry outside of the blocks
+			}
+		}
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C2A11
+}
+
+bool Algorithms::ComputeSteadyStateVector(const BlockSparseMatrix* transitionMatrix, double* steadyStateVector, ull* iterations, double* residual)
+{
+  // Bouml preserved body begin 000C2A91
+
+	VERIFY(transitionMatrix != NULL && steadyStateVector != NULL && transitionMatrix->numBlockRows != 0);
+
+	ull dimension = transitionMatrix->numBlockRows * transitionMatrix->blockDimension;
+
+	double* x = steadyStateVector;
+	for(ull i = 0; i < dimension; i++) { x[i] = 1.0 / dimension; }
+
+	double* next = (double*)Allocate(dimension * sizeof(double));
+	VERIFY(next != NULL);
+
+	// power iteration (see SteadyStateByPowerIteration())
+	bool converged = false;
+	ull iter = 0;
+	for(iter = 1; iter <= SS_MAX_ITERATIONS; iter++)
+	{
+		double delta = SteadyStateResidual(transitionMatrix, x, next); // next = x * P
+
+		if(delta < SS_TOLERANCE) { memcpy(x, next, dimension * sizeof(double)); converged = true; break; }
+
+		double sum = 0.0;
+		for(ull j = 0; j < dimension; j++) { x[j] = 0.5 * (x[j] + next[j]); sum += x[j]; }
+		for(ull j = 0; j < dimension; j++) { x[j] /= sum; }
+	}
+
+	if(iterations != NULL) { *iterations = MIN(iter, (ull)SS_MAX_ITERATIONS); }
+
+	if(residual != NULL) { *residual = SteadyStateResidual(transitionMatrix, x, next); }
+
+	Free(next);
+
+	return converged;
+
+  // Bouml preserved body end 000C2A91
+}
+
+double Algorithms::SteadyStateResidual(const BlockSparseMatrix* transitionMatrix, const double* vector, double* temp)
+{
+  // Bouml preserved body begin 000C2B11
+
+	ull blockDimension = transitionMatrix->blockDimension;
+	ull dimension = transitionMatrix->numBlockRows * blockDimension;
+
+	memset(temp, 0, dimension * sizeof(double));
+
+	// temp = vector * transitionMatrix (block by block, each block row by row)
+	for(ull blockRow = 0; blockRow < transitionMatrix->numBlockRows; blockRow++)
+	{
+		const double* x = &vector[blockRow * blockDimension];
+
+		for(ull block = transitionMatrix->blockRowStart[blockRow]; block < transitionMatrix->blockRowStart[blockRow + 1]; block++)
+		{
+			const double* values = &transitionMatrix->values[block * blockDimension * blockDimension];
+			double* y = &temp[transitionMatrix->blockColumns[block] * blockDimension];
+
+			for(ull i = 0; i < blockDimension; i++)
+			{
+				double xi = x[i];
+				if(xi == 0.0) { continue; }
+
+				const double* row = &values[i * blockDimension];
+				for(ull j = 0; j < blockDimension; j++) { y[j] += xi * row[j]; }
+			}
+		}
+	}
+
+	double residual = 0.0;
+	for(ull j = 0; j < dimension; j++) { residual += ABS(temp[j] - vector[j]); }
+
+	return residual;
+
+  // Bouml preserved body end 000C2B11
+}
+
+
 } // namespace lpm
@@ -48,9 +48,113 @@
 #include "../include/MetricOperation.h"
 #include "../include/FilterOperation.h"
 #include "../include/Context.h"
+#include "../include/ObservedEvent.h"
 
 namespace lpm {
 
+// computes the log-likelihood of a block of LIKELIHOOD_USER_BLOCK users with every pseudonym (task index: index of the block)
+//
+// At each timestamp, the probability of the observed event of pseudonym p given user u is
+//   sum_loc presence(u, loc) * (app(u, loc, 0) * lppm(p, loc, 0) + app(u, loc, 1) * lppm(p, loc, 1))
+// i.e. the entry (u, p) of the product of the (users x (2 x numLoc)) matrix [presence(u, loc) * app(u, loc, k)] with the ((2 x numLoc) x Nnyms) matrix [lppm(p, loc, k)].
+class SteadyStateLikelihoodTask : public ParallelTask 
+{
+  public:
+    SteadyStateLikelihoodTask(const EmissionTable* emissions, const double* presence, ull numPeriods, const vector<ull>& periodIndices, const double* observations, double* likelihood, double* scratch, ull scratchSize);
+
+    virtual bool Run(ull taskIdx, ull workerIdx);
+
+
+  private:
+    const EmissionTable* emissions;
+
+    const double* presence;
+
+    ull numPeriods;
+
+    const vector<ull>& periodIndices;
+
+    const double* observations;
+
+    double* likelihood;
+
+    double* scratch;
+
+    ull scratchSize;
+
+};
+
+SteadyStateLikelihoodTask::SteadyStateLikelihoodTask(const EmissionTable* emissions, const double* presence, ull numPeriods, const vector<ull>& periodIndices, const double* observations, double* likelihood, double* scratch, ull scratchSize) : periodIndices(periodIndices)
+{
+	this->emissions = emissions;
+	this->presence = presence;
+	this->numPeriods = numPeriods;
+	this->observations = observations;
+	this->likelihood = likelihood;
+	this->scratch = scratch;
+	this->scratchSize = scratchSize;
+}
+
+bool SteadyStateLikelihoodTask::Run(ull taskIdx, ull workerIdx)
+{
+	const double bigNumber = 1e20;
+	const double bigNumberInverse = 1.0 / bigNumber;
+
+	ull numTimes = emissions->numTimes;
+	ull numLoc = emissions->numLoc;
+	ull Nusers = emissions->numUsers;
+	ull Nnyms = emissions->numPseudonyms;
+
+	ull firstUser = taskIdx * LIKELIHOOD_USER_BLOCK;
+	ull numRows = MIN((ull)LIKELIHOOD_USER_BLOCK, Nusers - firstUser);
+
+	// each worker has its own scratch buffer: the (numRows x (2 x numLoc)) user matrix and the (numRows x Nnyms) product
+	double* users = &scratch[workerIdx * scratchSize];
+	double* probabilities = &users[LIKELIHOOD_USER_BLOCK * 2 * numLoc];
+
+	for(ull timeIndex = 0; timeIndex < numTimes; timeIndex++)
+	{
+		ull tpIndex = periodIndices[timeIndex];
+
+		for(ull row = 0; row < numRows; row++)
+		{
+			ull userIndex = firstUser + row;
+
+			const double* subChainSteadyStateVector = &presence[GET_INDEX_3D(userIndex, tpIndex, 0, numPeriods, numLoc)];
+			const double* app = &emissions->applicationProbabilities[GET_INDEX_3D(userIndex, timeIndex, 0, numTimes, 2 * numLoc)];
+
+			double* userRow = &users[row * 2 * numLoc];
+			for(ull locIndex = 0; locIndex < numLoc; locIndex++)
+			{
+				userRow[2 * locIndex] = subChainSteadyStateVector[locIndex] * app[2 * locIndex];
+				userRow[2 * locIndex + 1] = subChainSteadyStateVector[locIndex] * app[2 * locIndex + 1];
+			}
+		}
+
+		Algorithms::MultiplyMatrices(users, &observations[timeIndex * 2 * numLoc * Nnyms], numRows, 2 * numLoc, Nnyms, probabilities);
+
+		for(ull row = 0; row < numRows; row++)
+		{
+			double* logsum = &likelihood[GET_INDEX(firstUser + row, 0, Nnyms)];
+			const double* sums = &probabilities[row * Nnyms];
+
+			for(ull nymIndex = 0; nymIndex < Nnyms; nymIndex++)
+			{
+				double sum = sums[nymIndex];
+
+				// take care of small sum
+				VERIFY(sum == 0.0 || sum > bigNumberInverse);
+
+				if(sum == 0.0) { sum = DBL_MIN; }
+
+				logsum[nymIndex] += log(sum);
+			}
+		}
+	}
+
+	return true;
+}
+
 AttackOperation::AttackOperation(string name) : Operation<TraceSet, AttackOutput>(name) 
 {
   // Bouml preserved body begin 00049491
@@ -58,6 +162,7 @@ AttackOperation::AttackOperation(string name) : Operation<TraceSet, AttackOutput
 	context = NULL;
 	applicationPDF = NULL;
 	lppmPDF = NULL;
+	numThreads = 1;
 
   // Bouml preserved body end 00049491
 }
@@ -119,5 +224,266 @@ void AttackOperation::SetContext(const Context* newContext)
   // Bouml preserved body end 00052191
 }
 
+//! 
+//! \brief Sets the number of threads used by the attack.
+//!
+//! \param[in] numThreads 	ull, the number of worker threads (THREADS_ALL_PROCESSORS for one thread per processor).
+//!
+//! \note The default is 1. The results do not depend on the number of threads.
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool AttackOperation::SetNumThreads(ull numThreads) 
+{
+  // Bouml preserved body begin 000C1291
+
+	this->numThreads = numThreads;
+
+	return true;
+
+  // Bouml preserved body end 000C1291
+}
+
+
+bool AttackOperation::ComputeEmissionTable(const TraceSet* trace, EmissionTable* table) const
+{
+  // Bouml preserved body begin 000C0E91
+
+	VERIFY(trace != NULL && table != NULL && context != NULL);
+	VERIFY(applicationPDF != NULL && lppmPDF != NULL);
+
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+	ull numTimes = maxTime - minTime + 1;
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	map<ull, UserProfile*> profiles = map<ull, UserProfile*>();
+	VERIFY(context->GetProfiles(profiles) == true);
+
+	map<ull, Trace*> mapping = map<ull, Trace*>();
+	trace->GetMapping(mapping);
+
+	table->numUsers = profiles.size();
+	table->numPseudonyms = mapping.size();
+	table->numTimes = numTimes;
+	table->numLoc = numLoc;
+
+	ull lppmByteSize = table->numPseudonyms * numTimes * numLoc * 2 * sizeof(double);
+	table->lppmProbabilities = (double*)Allocate(lppmByteSize);
+	VERIFY(table->lppmProbabilities != NULL);
+	memset(table->lppmProbabilities, 0, lppmByteSize);
+
+	ull applicationByteSize = table->numUsers * numTimes * numLoc * 2 * sizeof(double);
+	table->applicationProbabilities = (double*)Allocate(applicationByteSize);
+	VERIFY(table->applicationProbabilities != NULL);
+	memset(table->applicationProbabilities, 0, applicationByteSize);
+
+	// LPPM probabilities: once per observed event
+	ull pseudonymIndex = 0;
+	pair_foreach_const(map<ull, Trace*>, mapping, pseudonymsIter)
+	{
+		ull pseudonym = pseudonymsIter->first;
+		Trace* observedTrace = pseudonymsIter->second;
+
+		vector<Event*> events = vector<Event*>();
+		observedTrace->GetEvents(events);
+
+		VERIFY(numTimes == events.size());
+
+		ull tm = minTime;
+		foreach_const(vector<Event*>, events, eventsIter)
+		{
+			ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
+			VERIFY(observedEvent != NULL);
+
+			double* lppm = &table->lppmProbabilities[GET_INDEX_3D(pseudonymIndex, (tm - minTime), 0, numTimes, 2 * numLoc)];
+			VERIFY(lppmPDF->PDFVector(context, pseudonym, tm, observedEvent, lppm) == true);
+
+			tm++;
+		}
+
+		pseudonymIndex++;
+	}
+
+	// application probabilities: once per (user, time)
+	ull userIndex = 0;
+	pair_foreach_const(map<ull, UserProfile*>, profiles, usersIter)
+	{
+		ull user = usersIter->first;
+
+		for(ull tm = minTime; tm <= maxTime; tm++)
+		{
+			double* app = &table->applicationProbabilities[GET_INDEX_3D(userIndex, (tm - minTime), 0, numTimes, 2 * numLoc)];
+			VERIFY(applicationPDF->PDFVector(context, user, tm, NULL, app) == true);
+		}
+
+		userIndex++;
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C0E91
+}
+
+void AttackOperation::FreeEmissionTable(EmissionTable* table) const
+{
+  // Bouml preserved body begin 000C0F11
+
+	VERIFY(table != NULL);
+
+	if(table->lppmProbabilities != NULL) { Free(table->lppmProbabilities); table->lppmProbabilities = NULL; }
+	if(table->applicationProbabilities != NULL) { Free(table->applicationProbabilities); table->applicationProbabilities = NULL; }
+
+  // Bouml preserved body end 000C0F11
+}
+
+
+//! 
+//! \brief Computes the log-likelihood matrix of the observed traces, under the (sub-chain) steady-state vectors of the users only
+//!
+//! This is the likelihood used by the weak adversary, and a cheap pre-filter for the strong adversary. The probabilities of the observed events 
+//! at each timestamp are computed for all the (user, pseudonym) pairs at once, as a matrix product.
+//!
+//! \param[in] trace 	TraceSet*, containing observed events.
+//! \param[in] emissions 	EmissionTable*, the emission probabilities of the observed events.
+//! \param[out] matrix 	double**, the output (Nusers x Nusers) matrix (allocated here, but freed by the caller).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool AttackOperation::ComputeSteadyStateLikelihood(const TraceSet* trace, const EmissionTable* emissions, double** matrix) const
+{
+  // Bouml preserved body begin 000C1C91
+
+	// get user profiles
+	map<ull, UserProfile*> profiles = map<ull, UserProfile*>();
+	VERIFY(context->GetProfiles(profiles) == true);
+
+	ull Nusers = profiles.size();
+
+	// get mapping (pseudonym -> observed trace)
+	map<ull, Trace*> mapping = map<ull, Trace*>();
+	trace->GetMapping(mapping);
+
+	VERIFY(Nusers == mapping.size());
+	ull Nnyms = mapping.size();
+
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+	ull numTimes = maxTime - minTime + 1;
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	VERIFY(emissions->numUsers == Nusers && emissions->numPseudonyms == Nnyms && emissions->numTimes == numTimes && emissions->numLoc == numLoc);
+
+	// the emission table has been computed from the observed traces: only check that they are consistent
+	pair_foreach_const(map<ull, Trace*>, mapping, pseudonymsIter)
+	{
+		vector<Event*> events = vector<Event*>();
+		pseudonymsIter->second->GetEvents(events);
+
+		VERIFY(numTimes == events.size());
+
+		ull tm = minTime;
+		foreach_const(vector<Event*>, events, eventsIter)
+		{
+			ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
+			set<ull> timestamps = set<ull>();
+			observedEvent->GetTimestamps(timestamps);
+
+			VERIFY(timestamps.size() == 1 && *(timestamps.begin()) == tm);
+
+			tm++;
+		}
+	}
+
+	// time period of each timestamp
+	ull numPeriods = 0; TPInfo tpInfo;
+	VERIFY(Parameters::GetInstance()->GetTimePeriodInfo(&numPeriods, &tpInfo) == true);
+	ull minPeriod = tpInfo.minPeriod;
+
+	vector<ull> periodIndices = vector<ull>(numTimes, 0);
+	for(ull tm = minTime; tm <= maxTime; tm++)
+	{
+		ull tp = Parameters::GetInstance()->LookupTimePeriod(tm);
+		if(tp == INVALID_TIME_PERIOD)
+		{
+			SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+			return false;
+		}
+
+		periodIndices[tm - minTime] = tp - minPeriod;
+	}
+
+	// sub-chain steady-state vector of each user and time period (Nusers x numPeriods x numLoc)
+	ull presenceByteSize = Nusers * numPeriods * numLoc * sizeof(double);
+	double* presence = (double*)Allocate(presenceByteSize);
+	VERIFY(presence != NULL);
+	memset(presence, 0, presenceByteSize);
+
+	ull userIndex = 0;
+	pair_foreach_const(map<ull, UserProfile*>, profiles, usersIter)
+	{
+		double* steadyStateVector = NULL;
+		VERIFY(usersIter->second->GetSteadyStateVector(&steadyStateVector) == true);
+		VERIFY(steadyStateVector != NULL);
+
+		for(ull tpIndex = 0; tpIndex < numPeriods; tpIndex++)
+		{
+			double* subChainSteadyStateVector = &presence[GET_INDEX_3D(userIndex, tpIndex, 0, numPeriods, numLoc)];
+			VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tpIndex + minPeriod, subChainSteadyStateVector) == true);
+		}
+
+		userIndex++;
+	}
+
+	// LPPM probabilities of the observed events, transposed for each timestamp: (2 x numLoc) x Nnyms
+	ull observationByteSize = numTimes * 2 * numLoc * Nnyms * sizeof(double);
+	double* observations = (double*)Allocate(observationByteSize);
+	VERIFY(observations != NULL);
+	memset(observations, 0, observationByteSize);
+
+	for(ull nymIndex = 0; nymIndex < Nnyms; nymIndex++)
+	{
+		for(ull timeIndex = 0; timeIndex < numTimes; timeIndex++)
+		{
+			const double* lppm = &emissions->lppmProbabilities[GET_INDEX_3D(nymIndex, timeIndex, 0, numTimes, 2 * numLoc)];
+			for(ull index = 0; index < 2 * numLoc; index++)
+			{
+				observations[GET_INDEX_3D(timeIndex, index, nymIndex, 2 * numLoc, Nnyms)] = lppm[index];
+			}
+		}
+	}
+
+	ull byteSize = (Nusers * Nusers) * sizeof(double);
+	double* likelihood = *matrix = (double*)Allocate(byteSize);
+	VERIFY(likelihood != NULL);
+	memset(likelihood, 0, byteSize);
+
+	// blocks of users are computed independently, each worker uses its own scratch buffer
+	ull numBlocks = (Nusers + LIKELIHOOD_USER_BLOCK - 1) / LIKELIHOOD_USER_BLOCK;
+	ull numWorkers = ThreadPool::GetNumWorkers(numThreads, numBlocks);
+
+	ull scratchSize = LIKELIHOOD_USER_BLOCK * (2 * numLoc + Nnyms);
+	ull scratchByteSize = numWorkers * scratchSize * sizeof(double);
+	double* scratch = (double*)Allocate(scratchByteSize);
+	VERIFY(scratch != NULL);
+	memset(scratch, 0, scratchByteSize);
+
+	SteadyStateLikelihoodTask task = SteadyStateLikelihoodTask(emissions, presence, numPeriods, periodIndices, observations, likelihood, scratch, scratchSize);
+	bool success = ThreadPool::Execute(&task, numBlocks, numThreads);
+
+	Free(scratch);
+	Free(observations);
+	Free(presence);
+
+	return success;
+
+  // Bouml preserved body end 000C1C91
+}
 
 } // namespace lpm
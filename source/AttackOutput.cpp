@@ -55,6 +55,9 @@ AttackOutput::AttackOutput()
 	probabilityDistribution = NULL;
 	anonymizationMap = map<ull, ull>();
 	mostLikelyTrace = NULL;
+	numAlternatives = 0;
+	alternativePseudonyms = NULL;
+	alternativeDistributions = NULL;
 
   // Bouml preserved body end 00094411
 }
@@ -66,6 +69,8 @@ AttackOutput::~AttackOutput()
 	if(probabilityDistribution != NULL) { Free(probabilityDistribution); }
 	anonymizationMap.clear();
 	if(mostLikelyTrace != NULL) { Free(mostLikelyTrace); }
+	if(alternativePseudonyms != NULL) { Free(alternativePseudonyms); }
+	if(alternativeDistributions != NULL) { Free(alternativeDistributions); }
 
   // Bouml preserved body end 00094491
 }
@@ -134,5 +139,32 @@ void AttackOutput::SetMostLikelyTrace(const ull* trace)
   // Bouml preserved body end 0007CA91
 }
 
+bool AttackOutput::GetAlternatives(ull* numAlternatives, ull** pseudonyms, double** distributions) const 
+{
+  // Bouml preserved body begin 000C1A11
+
+	if(numAlternatives == NULL || pseudonyms == NULL || distributions == NULL) { return false; }
+
+	*numAlternatives = this->numAlternatives;
+	*pseudonyms = alternativePseudonyms;
+	*distributions = alternativeDistributions;
+
+	return true;
+
+  // Bouml preserved body end 000C1A11
+}
+
+void AttackOutput::SetAlternatives(ull numAlternatives, const ull* pseudonyms, double* distributions) 
+{
+  // Bouml preserved body begin 000C1A91
+
+	DEBUG_VERIFY(pseudonyms != NULL && distributions != NULL);
+	this->numAlternatives = numAlternatives;
+	alternativePseudonyms = const_cast<ull*>(pseudonyms);
+	alternativeDistributions = distributions;
+
+  // Bouml preserved body end 000C1A91
+}
+
 
 } // namespace lpm
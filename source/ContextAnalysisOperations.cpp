@@ -189,8 +189,9 @@ bool PredictabilityAnalysisOperation::Execute(const Context* input, File* output
 				{
 					if(tpInfo.propTransMatrix[GET_INDEX(tp - minPeriod, tp2 - minPeriod, numPeriods)] == 0) { continue; } // if the time period transition is not possible (has prob. 0), skip it.
 
-					double* transitionVector = NULL;
-					VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, tp, loc, tp2, &transitionVector, false) == true);
+					const double* subChainTransitionMatrix = NULL;
+					VERIFY(profile->GetSubChainTransitionMatrix(tp, tp2, &subChainTransitionMatrix) == true);
+					const double* transitionVector = &subChainTransitionMatrix[GET_INDEX((loc - minLoc), 0, numLoc)];
 
 					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
 					{
@@ -208,7 +209,6 @@ bool PredictabilityAnalysisOperation::Execute(const Context* input, File* output
 						}
 					}
 
-					Free(transitionVector);
 				}
 			}
 		}
@@ -336,8 +336,9 @@ bool RandomnessAnalysisOperation::Execute(const Context* input, File* output)
 				{
 					if(tpInfo.propTransMatrix[GET_INDEX(tp - minPeriod, tp2 - minPeriod, numPeriods)] == 0) { continue; } // if the time period transition is not possible (has prob. 0), skip it.
 
-					double* transitionVector = NULL;
-					VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, tp, loc, tp2, &transitionVector, false) == true);
+					const double* subChainTransitionMatrix = NULL;
+					VERIFY(profile->GetSubChainTransitionMatrix(tp, tp2, &subChainTransitionMatrix) == true);
+					const double* transitionVector = &subChainTransitionMatrix[GET_INDEX((loc - minLoc), 0, numLoc)];
 
 					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
 					{
@@ -346,7 +347,6 @@ bool RandomnessAnalysisOperation::Execute(const Context* input, File* output)
 						er1 -= stationaryProb * transitionMatrix[fullChainIdx] * log2(transitionVector[(loc2 - minLoc)]);
 					}
 
-					Free(transitionVector);
 				}
 			}
 		}
@@ -51,11 +51,178 @@
 
 namespace lpm {
 
+// a user to be processed by the Gibbs sampling procedure
+struct GibbsSamplingJob 
+{
+    vector<TraceVector>* learningTraces;
+
+    double* priorTransitionsCount;
+
+    UserProfile* profile;
+
+    double* transitionsCount;
+
+};
+
+// runs the Gibbs sampling procedure for one user (job), using the user's own random stream
+class GibbsSamplingTask : public ParallelTask 
+{
+  public:
+    GibbsSamplingTask(const CreateContextOperation* operation, vector<GibbsSamplingJob>& jobs, ull seed);
+
+    virtual bool Run(ull taskIdx, ull workerIdx);
+
+
+  private:
+    const CreateContextOperation* operation;
+
+    vector<GibbsSamplingJob>& jobs;
+
+    ull seed;
+
+};
+
+GibbsSamplingTask::GibbsSamplingTask(const CreateContextOperation* operation, vector<GibbsSamplingJob>& jobs, ull seed) : jobs(jobs)
+{
+	this->operation = operation;
+	this->seed = seed;
+}
+
+bool GibbsSamplingTask::Run(ull taskIdx, ull workerIdx)
+{
+	GibbsSamplingJob& job = jobs[taskIdx];
+	RNG* rng = RNG::GetInstance();
+
+	rng->SeedThreadStream(RNG::DeriveSeed(seed, job.profile->GetUser()));
+
+	bool success = operation->DoGibbsSampling(*job.learningTraces, job.priorTransitionsCount, job.profile, job.transitionsCount);
+
+	rng->ReleaseThreadStream();
+
+	if(success == true) { success = operation->AppendToJournal(job.profile, job.transitionsCount); }
+
+	return success;
+}
+
+// frees the per-chain buffers of the Gibbs sampling procedure (see CreateContextOperation::DoGibbsSampling())
+static void FreeGibbsChains(vector<BlockSparseMatrix>& transitionMatrices, vector<double*>& steadyStateVectors, vector<vector<TraceVector> >& estimatedTraces, vector<double*>& chainSums, vector<double*>& chainSquaredSums)
+{
+	for(ull chain = 0; chain < transitionMatrices.size(); chain++) { Algorithms::FreeBlockSparseMatrix(&transitionMatrices[chain]); }
+	foreach_const(vector<double*>, steadyStateVectors, iter) { Free(*iter); }
+	foreach_const(vector<double*>, chainSums, iter) { Free(*iter); }
+	foreach_const(vector<double*>, chainSquaredSums, iter) { Free(*iter); }
+
+	for(ull chain = 0; chain < estimatedTraces.size(); chain++)
+	{
+		foreach_const(vector<TraceVector>, estimatedTraces[chain], iterTV) { TraceVector tvec = *iterTV; Free(tvec.trace); }
+	}
+
+	transitionMatrices.clear(); steadyStateVectors.clear(); estimatedTraces.clear();
+	chainSums.clear(); chainSquaredSums.clear();
+}
+
+// releases the profiles read from the journal (see CreateContextOperation::ReadJournal())
+static void FreeJournal(map<ull, UserProfile*>& profiles, map<ull, double*>& transitionsCount)
+{
+	pair_foreach_const(map<ull, UserProfile*>, profiles, iter) { iter->second->Release(); }
+	pair_foreach_const(map<ull, double*>, transitionsCount, iter) { Free(iter->second); }
+
+	profiles.clear(); transitionsCount.clear();
+}
+
+// writes a line of doubles as their bit patterns, so that the checkpoints are restored exactly
+static bool WriteDoublesLine(const File* file, const double* values, ull count)
+{
+	vector<ull> bits = vector<ull>(count, 0);
+	memcpy(&bits[0], values, count * sizeof(double));
+
+	string line = "";
+	VERIFY(LineFormatter<ull>::GetInstance()->FormatVector(&bits[0], count, line) == true);
+
+	return file->WriteLine(line);
+}
+
+// reads a line written by WriteDoublesLine()
+static bool ReadDoublesLine(const File* file, double* values, ull count)
+{
+	string line = "";
+	if(file->ReadNextLine(line) == false) { return false; }
+
+	vector<ull> bits = vector<ull>(); size_t pos = 0;
+	if(LineParser<ull>::GetInstance()->ParseFields(line, bits, count, &pos) == false || pos != string::npos || bits.size() != count) { return false; }
+
+	memcpy(values, &bits[0], count * sizeof(double));
+
+	return true;
+}
+
+// checks the steady-state vector computed by the given method: fails (and sets the error code) if the method failed (e.g. it did not converge, 
+// unless converged is not NULL), or if the stationary distribution leaves an entire time period without mass (see CreateContextOperation::ComputeSteadyStateVector())
+static bool CheckSteadyStateVector(bool methodSuccess, SteadyStateMethod method, const double* steadyStateVector, ull numPeriodsInclDummies, ull numLoc, bool* converged, ull iterations, double residual)
+{
+	if(converged != NULL) { *converged = methodSuccess; }
+
+	// the iterative methods leave their last iterate, which the caller may accept
+	bool accepted = methodSuccess || (converged != NULL && (method == PowerIteration || method == GaussSeidel));
+
+	bool success = accepted;
+	for(ull tpIdx = 0; tpIdx < numPeriodsInclDummies && success == true; tpIdx++)
+	{
+		double tpSum = 0.0;
+		for(ull locIdx = 0; locIdx < numLoc; locIdx++) { tpSum += steadyStateVector[tpIdx * numLoc + locIdx]; }
+
+		if(tpSum == 0.0) { success = false; }
+	}
+
+	if(success == false)
+	{
+		stringstream details("");
+		details << "steady-state method " << method << (accepted == false ? " failed" : " left a time period without mass") << " (" << iterations << " iterations, residual: " << residual << ")";
+		SET_ERROR_CODE_DETAILS(ERROR_CODE_STEADY_STATE_FAILURE, details.str());
+
+		return false;
+	}
+
+	// check
+	double sum = 0.0;
+	for(ull i = 0; i < numPeriodsInclDummies * numLoc; i++) { sum += steadyStateVector[i]; }
+	VERIFY(ABS(sum - 1.0) <= EPSILON);
+
+	return true;
+}
+
+// writes raw values to a binary stream (see CreateContextOperation::WriteSamplerState())
+static bool WriteValues(std::fstream& stream, const void* values, ull byteSize)
+{
+	stream.write((const char*)values, byteSize);
+
+	return stream.good();
+}
+
+// reads raw values written by WriteValues()
+static bool ReadValues(std::fstream& stream, void* values, ull byteSize)
+{
+	stream.read((char*)values, byteSize);
+
+	return stream.good() && (ull)stream.gcount() == byteSize;
+}
+
 CreateContextOperation::CreateContextOperation(string name) : Operation<KnowledgeInput, Context>(name)
 {
   // Bouml preserved body begin 00045E11
 
 	SetLimits(1024, 1); // by default spend at most 1024 iterations per user or 1 sec per user
+	SetNumThreads(1);
+	SetSeed(KC_RANDOM_SEED);
+	SetSteadyStateMethod(PowerIteration);
+	SetConvergenceCriterion(KC_DEFAULT_GS_CHAINS, KC_NO_CONVERGENCE_TARGET, KC_DEFAULT_BURN_IN);
+	SetPreviousContext(NULL);
+	SetTransitionsCountOutput(NULL);
+	SetCheckpoint(KC_NO_CHECKPOINT, KC_DEFAULT_CHECKPOINT_INTERVAL);
+
+	journalFile = NULL;
+	checkpointSeed = 0;
+	pthread_mutex_init(&journalLock, NULL);
 
   // Bouml preserved body end 00045E11
 }
@@ -63,6 +230,9 @@ CreateContextOperation::CreateContextOperation(string name) : Operation<Knowledg
 CreateContextOperation::~CreateContextOperation() 
 {
   // Bouml preserved body begin 00066D11
+
+	pthread_mutex_destroy(&journalLock);
+
   // Bouml preserved body end 00066D11
 }
 
@@ -81,6 +251,15 @@ bool CreateContextOperation::Execute(const KnowledgeInput* input, Context* outpu
 
 	if(input == NULL || output == NULL) { return false; }
 
+	// the convergence target must be reachable within the limits (the diagnostics start after step 0 and the burn-in)
+	if(targetRHat != KC_NO_CONVERGENCE_TARGET && maxGSPerUser != KC_NO_LIMITS && GetBurnIn() + KC_CONVERGENCE_MIN_ITERATIONS + 1 > maxGSPerUser)
+	{
+		stringstream details("");
+		details << "the convergence target needs at least " << (GetBurnIn() + KC_CONVERGENCE_MIN_ITERATIONS + 1) << " iterations (burn-in " << GetBurnIn() << "), but the limit is " << maxGSPerUser;
+		SET_ERROR_CODE_DETAILS(ERROR_CODE_INVALID_ARGUMENTS, details.str());
+		return false;
+	}
+
 	Context* context = output;
 
 	set<ull> unknownUsers = set<ull>(); // sets of users for which we have no mobility info
@@ -90,8 +269,62 @@ bool CreateContextOperation::Execute(const KnowledgeInput* input, Context* outpu
 	map<ull, vector<TraceVector> > learningTraces = map<ull, vector<TraceVector> >();
 	map<ull, double*> priorTransitionsCount = map<ull, double*>();
 
+	// each user (including the unknown users below) is sampled from its own random stream derived from baseSeed
+	ull baseSeed = seed;
+
+	// resume: restore the seed and the profiles of the journal (if any), and start the journal over with them (dropping an entry left incomplete by an interruption)
+	map<ull, UserProfile*> journaledProfiles = map<ull, UserProfile*>();
+	map<ull, double*> journaledTransitionsCount = map<ull, double*>();
+	if(checkpointPrefix.empty() == false)
+	{
+		ull journalSeed = 0;
+		if(ReadJournal(&journalSeed, journaledProfiles, journaledTransitionsCount) == true)
+		{
+			if(seed == KC_RANDOM_SEED || seed == journalSeed) { baseSeed = journalSeed; }
+			else
+			{
+				FreeJournal(journaledProfiles, journaledTransitionsCount);
+
+				LOG_MESSAGE(Log::warningLevel, "The journal was written with another seed, the knowledge is constructed from scratch!");
+			}
+		}
+	}
+	if(baseSeed == KC_RANDOM_SEED) { baseSeed = RNG::GetInstance()->GenerateSeed(); }
+
+	if(checkpointPrefix.empty() == false)
+	{
+		checkpointSeed = baseSeed; // the sampler states saved with another seed are discarded
+
+		journalFile = new File(checkpointPrefix + KC_JOURNAL_FILE_SUFFIX, false);
+		VERIFY(journalFile != NULL);
+
+		stringstream seedLine(""); seedLine << baseSeed;
+		bool journalSuccess = journalFile->IsGood() && journalFile->WriteLine(seedLine.str());
+		pair_foreach_const(map<ull, UserProfile*>, journaledProfiles, iter)
+		{
+			map<ull, double*>::const_iterator iterCount = journaledTransitionsCount.find(iter->first);
+			journalSuccess = journalSuccess && AppendToJournal(iter->second, (iterCount != journaledTransitionsCount.end()) ? iterCount->second : NULL);
+		}
+
+		if(journalSuccess == false)
+		{
+			SET_ERROR_CODE_DETAILS(ERROR_CODE_INVALID_ARGUMENTS, "the journal could not be written");
+
+			delete journalFile; journalFile = NULL;
+			FreeJournal(journaledProfiles, journaledTransitionsCount);
+
+			return false;
+		}
+	}
+
 	bool* transFeasibilityMatrix = NULL;
-	if(ReadKnowledgeFiles(input, learningTraces, priorTransitionsCount, &transFeasibilityMatrix) == false){ return false; }
+	if(ReadKnowledgeFiles(input, learningTraces, priorTransitionsCount, &transFeasibilityMatrix) == false)
+	{
+		if(journalFile != NULL) { delete journalFile; journalFile = NULL; }
+		FreeJournal(journaledProfiles, journaledTransitionsCount);
+
+		return false;
+	}
 
 	// ull Nusers = learningTraces.size();
 	// VERIFY(Nusers != 0 && learningTraces.size() == priorTransitionsCount.size());
@@ -108,11 +341,15 @@ bool CreateContextOperation::Execute(const KnowledgeInput* input, Context* outpu
 	// ull maxPeriod = minPeriod + numPeriods - 1;
 
 	ull numStates = numPeriods * numLoc;
+	ull numStatesInclDummies = tpInfo.numPeriodsInclDummies * numLoc;
+
+	map<ull, double*> transitionsCount = map<ull, double*>(); // the counts to persist (if any)
+	ull numCopiedProfiles = 0; ull numRestoredProfiles = 0;
 
-	pair_foreach_const(map<ull, vector<TraceVector> >, learningTraces, iter)
+	vector<GibbsSamplingJob> jobs = vector<GibbsSamplingJob>();
+	pair_foreach(map<ull, vector<TraceVector> >, learningTraces, iter)
 	{
 		ull user = iter->first;
-		vector<TraceVector> traces = iter->second;
 
 		if(Parameters::GetInstance()->UserExists(user) == true) // only process this user if he exists
 		{
@@ -123,38 +360,110 @@ bool CreateContextOperation::Execute(const KnowledgeInput* input, Context* outpu
 
 			VERIFY(aprioriTransitionsCount != NULL);
 
-			UserProfile* profile = new UserProfile(user);
-			VERIFY(profile != NULL);
+			// the persisted counts start from the prior counts (over non-dummy tps), i.e. the counts read from the file, 
+			// to which an epsilon (< 1) was added for the feasible transitions (see ReadKnowledgeFiles())
+			double* userTransitionsCount = NULL;
+			if(transitionsCountOutputFile != NULL)
+			{
+				ull transitionsCountByteSize = numStates * numStates * sizeof(double);
+				userTransitionsCount = (double*)Allocate(transitionsCountByteSize);
+				VERIFY(userTransitionsCount != NULL);
 
-			// allocate learning traces for that user for Gibbs sampling
-			ull numTraces = traces.size();
-			VERIFY(numTraces != 0);
+				for(ull state1Idx = 0; state1Idx < numStates; state1Idx++)
+				{
+					for(ull state2Idx = 0; state2Idx < numStates; state2Idx++)
+					{
+						userTransitionsCount[GET_INDEX(state1Idx, state2Idx, numStates)] = floor(aprioriTransitionsCount[GET_INDEX(state1Idx, state2Idx, numStatesInclDummies)]);
+					}
+				}
 
-			if(DoGibbsSampling(traces, aprioriTransitionsCount, profile) == false)
+				transitionsCount.insert(pair<ull, double*>(user, userTransitionsCount));
+			}
+
+			// resume: the journaled profile of the user is restored as is (provided its transitions count was journaled, if it is persisted)
+			map<ull, UserProfile*>::const_iterator iterJournal = journaledProfiles.find(user);
+			map<ull, double*>::const_iterator iterJournalCount = journaledTransitionsCount.find(user);
+			if(iterJournal != journaledProfiles.end() && (userTransitionsCount == NULL || iterJournalCount != journaledTransitionsCount.end()))
 			{
-				profile->Release();
+				context->AddProfile(iterJournal->second);
+				if(userTransitionsCount != NULL) { memcpy(userTransitionsCount, iterJournalCount->second, numStates * numStates * sizeof(double)); }
 				Free(aprioriTransitionsCount);
-				pair_foreach_const(map<ull, vector<TraceVector> >, learningTraces, iter2)
-				{ foreach_const(vector<TraceVector>, iter2->second, iterV) { Free((*iterV).trace); } }
 
-				priorTransitionsCount.clear();
-				learningTraces.clear();
-				output->ClearProfiles();
+				numRestoredProfiles++;
+				continue;
+			}
+
+			// incremental update: if the new learning traces of the user contain no event, its previous profile is kept as is
+			bool hasEvents = false;
+			foreach_const(vector<TraceVector>, iter->second, iterTV)
+			{
+				TraceVector tvec = *iterTV;
+				for(ull tmIdx = 0; tmIdx < tvec.length && hasEvents == false; tmIdx++) { if(tvec.trace[tmIdx] != 0) { hasEvents = true; } }
+			}
 
-				Free(transFeasibilityMatrix);
+			UserProfile* previousProfile = NULL;
+			if(previousContext != NULL && hasEvents == false && previousContext->GetUserProfile(user, &previousProfile) == true)
+			{
+				context->AddProfile(previousProfile);
+				Free(aprioriTransitionsCount);
 
-				return false;
+				numCopiedProfiles++;
+				continue;
 			}
 
-			Free(aprioriTransitionsCount);
+			UserProfile* profile = new UserProfile(user);
+			VERIFY(profile != NULL);
 
+			// learning traces for that user for Gibbs sampling
+			ull numTraces = iter->second.size();
+			VERIFY(numTraces != 0);
 
-			context->AddProfile(profile);
-			profile->Release();
+			GibbsSamplingJob job;
+			job.learningTraces = &iter->second;
+			job.priorTransitionsCount = aprioriTransitionsCount;
+			job.profile = profile;
+			job.transitionsCount = userTransitionsCount;
+
+			jobs.push_back(job);
 		}
+	}
+
+	stringstream info("");
+	if(checkpointPrefix.empty() == false)
+	{
+		info << "Restored " << numRestoredProfiles << " profile(s) from the journal!";
+		Log::GetInstance()->Append(info.str());
+		info.str("");
+	}
+
+	if(previousContext != NULL)
+	{
+		info << "Kept " << numCopiedProfiles << " unchanged profile(s) of the previous context!";
+		Log::GetInstance()->Append(info.str());
+		info.str("");
+	}
+
+	info << "Sampling " << jobs.size() << " users using " << ThreadPool::GetNumWorkers(numThreads, jobs.size()) << " thread(s)...";
+	Log::GetInstance()->Append(info.str());
+
+	GibbsSamplingTask task = GibbsSamplingTask(this, jobs, baseSeed);
+	bool success = ThreadPool::Execute(&task, jobs.size(), numThreads);
 
-		traces.clear();
+	// the journal is complete (the unknown users below are not journaled)
+	if(journalFile != NULL) { delete journalFile; journalFile = NULL; }
+	FreeJournal(journaledProfiles, journaledTransitionsCount);
+
+	// add the profiles in order (regardless of the order in which they were sampled)
+	foreach_const(vector<GibbsSamplingJob>, jobs, iterJobs)
+	{
+		GibbsSamplingJob job = *iterJobs;
+
+		if(success == true) { context->AddProfile(job.profile); }
+
+		job.profile->Release();
+		Free(job.priorTransitionsCount);
 	}
+	jobs.clear();
 
 	pair_foreach_const(map<ull, vector<TraceVector> >, learningTraces, iter2)
 	{ foreach_const(vector<TraceVector>, iter2->second, iterV) { Free((*iterV).trace); } }
@@ -162,10 +471,39 @@ bool CreateContextOperation::Execute(const KnowledgeInput* input, Context* outpu
 	priorTransitionsCount.clear();
 	learningTraces.clear();
 
+	// persist the transitions counts
+	if(success == true && transitionsCountOutputFile != NULL) { success = WriteTransitionsCount(transitionsCountOutputFile, transitionsCount); }
+
+	pair_foreach_const(map<ull, double*>, transitionsCount, iter) { Free(iter->second); }
+	transitionsCount.clear();
+
+	if(success == false)
+	{
+		output->ClearProfiles();
+
+		Free(transFeasibilityMatrix);
+
+		return false;
+	}
+
+	// incremental update: the users for which there is no information keep their previous profile (if any)
+	if(previousContext != NULL)
+	{
+		set<ull> users = unknownUsers;
+		foreach_const(set<ull>, users, iter)
+		{
+			UserProfile* previousProfile = NULL;
+			if(previousContext->GetUserProfile(*iter, &previousProfile) == true)
+			{
+				context->AddProfile(previousProfile);
+				unknownUsers.erase(*iter);
+			}
+		}
+	}
+
 	if(unknownUsers.size() > 0)
 	{
 		ull numPeriodsInclDummies = tpInfo.numPeriodsInclDummies;
-		ull numStatesInclDummies = numPeriodsInclDummies * numLoc;
 
 		// do Gibbs sampling once, and then assign the result to each unknown user
 
@@ -231,7 +569,11 @@ bool CreateContextOperation::Execute(const KnowledgeInput* input, Context* outpu
 		vector<TraceVector> tvecs = vector<TraceVector>();
 		tvecs.push_back(vec);
 
-		if(DoGibbsSampling(tvecs, aprioriTransitionsCount, unknownProfile) == false)
+		RNG::GetInstance()->SeedThreadStream(RNG::DeriveSeed(baseSeed, 0)); // user ids start at 1
+		bool unknownSuccess = DoGibbsSampling(tvecs, aprioriTransitionsCount, unknownProfile);
+		RNG::GetInstance()->ReleaseThreadStream();
+
+		if(unknownSuccess == false)
 		{
 			unknownProfile->Release();
 			Free(aprioriTransitionsCount);
@@ -325,123 +667,251 @@ bool CreateContextOperation::SetLimits(ull maxSamples, ull maxSeconds)
   // Bouml preserved body end 0007E411
 }
 
-bool CreateContextOperation::TransitionMatrixFromCountMatrix(const double* count, double* alpha, double* theta, double* transitionMatrix, bool sample) const 
+//! 
+//! \brief Sets the number of threads used to sample users concurrently.
+//!
+//! \param[in] numThreads 	ull, the number of worker threads (THREADS_ALL_PROCESSORS for one thread per processor).
+//!
+//! \note The default is 1 (i.e. users are sampled one after the other).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool CreateContextOperation::SetNumThreads(ull numThreads) 
+{
+  // Bouml preserved body begin 000C0411
+
+	this->numThreads = numThreads;
+
+	return true;
+
+  // Bouml preserved body end 000C0411
+}
+
+//! 
+//! \brief Sets the seed of the Gibbs sampling procedure.
+//!
+//! \param[in] seed 	ull, the seed (KC_RANDOM_SEED to draw a new seed for each execution).
+//!
+//! \note Each user is sampled from its own random stream derived from the seed and the user id. Hence, 
+//! for a fixed seed, the constructed knowledge does not depend on the number of threads 
+//! (as long as the iterations are not limited by time, see \a SetLimits()).
+//!
+//! \return nothing
+//!
+void CreateContextOperation::SetSeed(ull seed) 
+{
+  // Bouml preserved body begin 000C0491
+
+	this->seed = seed;
+
+  // Bouml preserved body end 000C0491
+}
+
+//! 
+//! \brief Sets the method used to compute the steady-state vectors.
+//!
+//! \param[in] method 	SteadyStateMethod, the method (PowerIteration by default).
+//!
+//! \note If the method fails for the steady-state vector of a profile (e.g. an iterative method does not converge within 
+//! SS_MAX_ITERATIONS iterations), the error is reported (the error details give the number of iterations and the residual), 
+//! and the vector is computed again by DenseLinearSolve, with a warning; the knowledge construction only fails if this fails too. 
+//! For the samples of the Gibbs sampling procedure, the last iterate of an iterative method which did not converge is used instead, 
+//! and the number of such samples is logged.
+//!
+//! \return nothing
+//!
+void CreateContextOperation::SetSteadyStateMethod(SteadyStateMethod method) 
+{
+  // Bouml preserved body begin 000C0811
+
+	steadyStateMethod = method;
+
+  // Bouml preserved body end 000C0811
+}
+
+//! 
+//! \brief Sets the number of chains of the Gibbs sampling procedure, and the convergence target at which it stops.
+//!
+//! \param[in] numChains 	ull, the number of independent chains sampled (in lockstep) for each user.
+//! \param[in] targetRHat 	double, the target potential scale reduction factor (Gelman-Rubin R-hat), or KC_NO_CONVERGENCE_TARGET.
+//! \param[in] burnIn 	ull, the number of iterations (after the initial step) discarded by the convergence diagnostics.
+//!
+//! \note With several chains, the R-hat of each entry of the transition matrix is computed after each iteration 
+//! (and logged, along with the largest one at the end of the procedure), over the samples of each chain drawn after 
+//! the initial step and the \a burnIn iterations which follow it. If a target is set, the procedure stops for a user 
+//! as soon as the largest R-hat is at most \a targetRHat (computed over at least KC_CONVERGENCE_MIN_ITERATIONS iterations), 
+//! the limits set with \a SetLimits() still applying. The constructed knowledge averages the samples of all chains.
+//! \note The default burn-in (KC_DEFAULT_BURN_IN) is half of the iterations after the initial step allowed by \a SetLimits() 
+//! (KC_TIME_LIMITED_BURN_IN if the number of iterations is not limited). \a Execute() fails if a target is set which 
+//! cannot be reached within the limits, i.e. if \a burnIn + KC_CONVERGENCE_MIN_ITERATIONS iterations do not follow the initial step.
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool CreateContextOperation::SetConvergenceCriterion(ull numChains, double targetRHat, ull burnIn) 
+{
+  // Bouml preserved body begin 000C2691
+
+	if(numChains == 0) { return false; }
+	if(targetRHat != KC_NO_CONVERGENCE_TARGET && (numChains < 2 || targetRHat < 1.0)) { return false; }
+
+	this->numChains = numChains;
+	this->targetRHat = targetRHat;
+	this->burnIn = burnIn;
+
+	return true;
+
+  // Bouml preserved body end 000C2691
+}
+
+//! 
+//! \brief Sets the previously constructed context to update incrementally.
+//!
+//! \param[in] previousContext 	Context*, the previous context (NULL to construct the knowledge from scratch).
+//!
+//! \note In an incremental update, the learning traces only contain the new events, and the transitions count file 
+//! holds the counts persisted by the previous construction (see \a SetTransitionsCountOutput()), so that the Gibbs sampling 
+//! procedure is warm-started from them. The users whose new learning traces contain no event (and the users for which there is no 
+//! information) keep the profile of the previous context, if they have one, without being sampled again.
+//! The previous context must remain valid until \a Execute() returns.
+//!
+//! \return nothing
+//!
+void CreateContextOperation::SetPreviousContext(const Context* previousContext) 
+{
+  // Bouml preserved body begin 000C2C91
+
+	this->previousContext = previousContext;
+
+  // Bouml preserved body end 000C2C91
+}
+
+//! 
+//! \brief Sets the file to which the transitions count of each user is persisted by \a Execute().
+//!
+//! \param[in] outputFile 	File*, the output file (NULL to persist nothing).
+//!
+//! \note The counts are written in the format of the transitions count file of the KnowledgeInput. They are the prior counts of the user 
+//! plus the transitions observed in its learning traces (i.e. between two known locations), so that the file can be used as the 
+//! transitions count file of a later incremental update (see \a SetPreviousContext()). The transitions sampled to fill the gaps 
+//! are not persisted: they would otherwise be counted again as evidence by each update.
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool CreateContextOperation::SetTransitionsCountOutput(File* outputFile) 
+{
+  // Bouml preserved body begin 000C2D11
+
+	if(outputFile != NULL && outputFile->IsGood() == false) { return false; }
+
+	transitionsCountOutputFile = outputFile;
+
+	return true;
+
+  // Bouml preserved body end 000C2D11
+}
+
+//! 
+//! \brief Sets the checkpoints from which an interrupted knowledge construction can be resumed.
+//!
+//! \param[in] checkpointPrefix 	string, the path prefix of the checkpoint files (KC_NO_CHECKPOINT to disable the checkpoints).
+//! \param[in] checkpointInterval 	ull, the number of Gibbs sampling iterations between two checkpoints of a user being sampled.
+//!
+//! \note Each completed profile is appended to the journal (\a checkpointPrefix followed by KC_JOURNAL_FILE_SUFFIX), and 
+//! the state of the sampling of each user in progress (the estimated traces of each chain, the sums of the samples, and the 
+//! random stream) is saved every \a checkpointInterval iterations (to \a checkpointPrefix-user followed by KC_SAMPLER_STATE_FILE_SUFFIX, 
+//! which is removed when the user is completed). Executing again with the same inputs and settings (including the seed, see \a SetSeed()) 
+//! restores the journaled profiles and resumes the other users from their last checkpoint, so that the knowledge constructed 
+//! is the same as the one of an uninterrupted execution (as long as the iterations are not limited by time, see \a SetLimits()).
+//! The journal is kept when the execution completes: remove it to construct the knowledge from scratch.
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool CreateContextOperation::SetCheckpoint(string checkpointPrefix, ull checkpointInterval) 
+{
+  // Bouml preserved body begin 000C2F11
+
+	if(checkpointInterval == 0) { return false; }
+
+	this->checkpointPrefix = checkpointPrefix;
+	this->checkpointInterval = checkpointInterval;
+
+	return true;
+
+  // Bouml preserved body end 000C2F11
+}
+
+bool CreateContextOperation::TransitionMatrixFromCountMatrix(const BlockSparseMatrix* count, double* alpha, double* theta, BlockSparseMatrix* transitionMatrix, bool sample) const 
 {
   // Bouml preserved body begin 000BCF91
 
 	VERIFY(count != NULL && alpha != NULL && theta != NULL && transitionMatrix != NULL);
+	VERIFY(count->numBlocks == transitionMatrix->numBlocks && count->blockDimension == transitionMatrix->blockDimension);
 
 	Parameters* params = Parameters::GetInstance();
 	RNG* rng = RNG::GetInstance();
 
-	// get location parameters
-	ull minLoc = 0; ull maxLoc = 0;
-	VERIFY(params->GetLocationstampsRange(&minLoc, &maxLoc) == true);
-	ull numLoc = maxLoc - minLoc + 1;
-
 	// get time period parameters
 	ull numPeriods = 0;  TPInfo tpInfo;
 	VERIFY(params->GetTimePeriodInfo(&numPeriods, &tpInfo) == true);
-	// ull minPeriod = tpInfo.minPeriod;
 
 	ull numPeriodsInclDummies = tpInfo.numPeriodsInclDummies;
-	ull numStatesInclDummies = numPeriodsInclDummies * numLoc;
+	ull numLoc = count->blockDimension;
+	ull blockSize = numLoc * numLoc;
 
-	ull thetaByteSize = numLoc * numLoc * sizeof(double);
-	ull alphaByteSize = thetaByteSize;
+	ull thetaByteSize = blockSize * sizeof(double);
 
 	// we sample on Pr(r1, r2 | p1, p2) and then use this to compute Pr(r2, p2 | r1, p1)
+	// note: only the (tp1, tp2) blocks such that the time period transition is possible are stored
 	for(ull tp1Idx = 0; tp1Idx < numPeriodsInclDummies; tp1Idx++)
 	{
-		for(ull tp2Idx = 0; tp2Idx < numPeriodsInclDummies; tp2Idx++)
+		for(ull block = count->blockRowStart[tp1Idx]; block < count->blockRowStart[tp1Idx + 1]; block++)
 		{
+			ull tp2Idx = count->blockColumns[block];
+
 			ull tpTransIdx = GET_INDEX(tp1Idx, tp2Idx, numPeriodsInclDummies);
 			double tpTransProb = tpInfo.propTransMatrix[tpTransIdx];
+			VERIFY(tpTransProb != 0);
 
-			ull rowByteSize = alphaByteSize / numLoc; // alpha has numLoc rows
 			// fill up alpha with counts: C(r1, r2, p1, p2)
-			for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
-			{
-				ull rowStartIdx = tp1Idx * numLoc + loc1Idx;
-				ull colStartIdx = tp2Idx * numLoc;
-				ull countMatrixIdx = GET_INDEX(rowStartIdx, colStartIdx, numStatesInclDummies);
-
-				ull rowIdx = loc1Idx * numLoc;
-				memcpy(&alpha[rowIdx], &count[countMatrixIdx], rowByteSize);
-			}
+			memcpy(alpha, &count->values[block * blockSize], blockSize * sizeof(double));
 
 			memset(theta, 0, thetaByteSize);
 
-			if(tpTransProb == 0)
+			ull vectorSize = blockSize;
+			if(sample == true)
 			{
-				// check if the count matrix is consistent
-				for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
-				{
-					for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++)
-					{
-						ull idx = GET_INDEX(loc1Idx, loc2Idx, numLoc);
-						if(alpha[idx] != 0) // count matrix is inconsistent
-						{
-							SET_ERROR_CODE_DETAILS(ERROR_CODE_IMPOSSIBLE_TRACE, "the provided count matrix is inconsistent with the time partitioning");
+				rng->GetDirichletRandomSample(alpha, vectorSize, theta); // do the actual sampling
 
-							return false;
-						}
-					}
+				for(ull i=0; i < vectorSize; i++)
+				{
+					VERIFY((alpha[i] > 0 && theta[i] == 0) == false); // make sure that if alpha[i] > 0, so is theta[i]
 				}
 			}
-			else // safe to sample
+			else
 			{
-				ull vectorSize = numLoc * numLoc;
-				if(sample == true)
-				{
-					rng->GetDirichletRandomSample(alpha, vectorSize, theta); // do the actual sampling
-
-					for(ull i=0; i < vectorSize; i++)
-					{
-						VERIFY((alpha[i] > 0 && theta[i] == 0) == false); // make sure that if alpha[i] > 0, so is theta[i]
-					}
-				}
-				else
-				{
-					CODING_ERROR; // shouldn't be able to get here
-					// rng->GetDirichletExpectedValue(alpha, vectorSize, theta);
-				}
+				CODING_ERROR; // shouldn't be able to get here
+				// rng->GetDirichletExpectedValue(alpha, vectorSize, theta);
 			}
 
 			// multiply each sample by Pr(p2 | p1) and put the elements in the matrix
-			for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
-			{
-				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++)
-				{
-					ull idx = GET_INDEX(loc1Idx, loc2Idx, numLoc);
-					double prob = theta[idx] * tpTransProb;
-
-					ull transMatrixIdx = GET_INDEX((tp1Idx * numLoc + loc1Idx), (tp2Idx * numLoc + loc2Idx), numStatesInclDummies);
-					transitionMatrix[transMatrixIdx] = prob;
-				}
-			}
+			double* values = &transitionMatrix->values[block * blockSize];
+			for(ull idx = 0; idx < blockSize; idx++) { values[idx] = theta[idx] * tpTransProb; }
 		}
 
 		// last step: normalize (divide by the sum over loc2Idx, tp2Idx)
 		for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
 		{
 			double sum = 0.0;
-			for(ull tp2Idx = 0; tp2Idx < numPeriodsInclDummies; tp2Idx++)
+			for(ull block = transitionMatrix->blockRowStart[tp1Idx]; block < transitionMatrix->blockRowStart[tp1Idx + 1]; block++)
 			{
-				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++)
-				{
-					ull transMatrixIdx = GET_INDEX((tp1Idx * numLoc + loc1Idx), (tp2Idx * numLoc + loc2Idx), numStatesInclDummies);
-					sum = sum + transitionMatrix[transMatrixIdx];
-				}
+				const double* row = &transitionMatrix->values[block * blockSize + loc1Idx * numLoc];
+				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++) { sum = sum + row[loc2Idx]; }
 			}
 
-			for(ull tp2Idx = 0; tp2Idx < numPeriodsInclDummies; tp2Idx++)
+			for(ull block = transitionMatrix->blockRowStart[tp1Idx]; block < transitionMatrix->blockRowStart[tp1Idx + 1]; block++)
 			{
-				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++)
-				{
-					ull transMatrixIdx = GET_INDEX((tp1Idx * numLoc + loc1Idx), (tp2Idx * numLoc + loc2Idx), numStatesInclDummies);
-					transitionMatrix[transMatrixIdx] /= sum;
-				}
+				double* row = &transitionMatrix->values[block * blockSize + loc1Idx * numLoc];
+				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++) { row[loc2Idx] /= sum; }
 			}
 		}
 	}
@@ -457,7 +927,7 @@ void CreateContextOperation::GetIntermediaryTransitionVector(map<ull, double*>&
   // Bouml preserved body end 000BD011
 }
 
-void CreateContextOperation::ComputeSteadyStateVector(const double* transitionMatrix, double* steadyStateVector) const 
+bool CreateContextOperation::ComputeSteadyStateVector(const double* transitionMatrix, SteadyStateMethod method, double* steadyStateVector, bool* converged, ull* iterations, double* residual) const 
 {
   // Bouml preserved body begin 0007E511
 
@@ -476,77 +946,72 @@ void CreateContextOperation::ComputeSteadyStateVector(const double* transitionMa
 	ull numPeriodsInclDummies = tpInfo.numPeriodsInclDummies;
 	ull numStatesInclDummies = numPeriodsInclDummies * numLoc;
 
-	const double epsilon = EPSILON;
-	const ull maxIterations = 30;
-	const ull minIterations = 6;
+	ull iter = 0; double res = 0.0;
+	bool success = Algorithms::ComputeSteadyStateVector(transitionMatrix, numStatesInclDummies, steadyStateVector, method, &iter, &res);
 
-	ull transitionMatrixByteSize = numStatesInclDummies * numStatesInclDummies * sizeof(double);
-	double* res = (double*)Allocate(transitionMatrixByteSize);
-	VERIFY(res != NULL);
-	memcpy(res, transitionMatrix, transitionMatrixByteSize);
+	if(iterations != NULL) { *iterations = iter; }
+	if(residual != NULL) { *residual = res; }
 
-	double* temp = (double*)Allocate(transitionMatrixByteSize);
-	VERIFY(temp != NULL);
-	memset(temp, 0, transitionMatrixByteSize);
+	return CheckSteadyStateVector(success, method, steadyStateVector, numPeriodsInclDummies, numLoc, converged, iter, res);
 
-	const double normalizationFactor = numStatesInclDummies * numStatesInclDummies;
-	ull iter = 0;
-	for(iter = 1; iter < maxIterations; iter++)
-	{
-		double delta = 0.0;
+  // Bouml preserved body end 0007E511
+}
 
-		Algorithms::MultiplySquareMatrices(res, res, numStatesInclDummies, temp);
+bool CreateContextOperation::ComputeSteadyStateVector(const BlockSparseMatrix* transitionMatrix, SteadyStateMethod method, double* steadyStateVector, bool* converged, ull* iterations, double* residual) const 
+{
+  // Bouml preserved body begin 000C2B91
 
-		for(ull stateIdx1 = 0; stateIdx1 < numStatesInclDummies; stateIdx1++)
-		{
-			for(ull stateIdx2 = 0; stateIdx2 < numStatesInclDummies; stateIdx2++)
-			{
-				ull index = GET_INDEX(stateIdx1, stateIdx2, numStatesInclDummies);
-				delta += ABS(temp[index] - res[index]);
-			}
-		}
+	VERIFY(transitionMatrix != NULL && steadyStateVector != NULL);
 
-		delta /= normalizationFactor;
+	ull numLoc = transitionMatrix->blockDimension;
+	ull numPeriodsInclDummies = transitionMatrix->numBlockRows;
+	ull numStatesInclDummies = numPeriodsInclDummies * numLoc;
 
-		if(iter >= minIterations && delta < epsilon){ break; }
+	// the power iteration works on the stored blocks directly
+	if(method == PowerIteration)
+	{
+		ull iter = 0; double res = 0.0;
+		bool success = Algorithms::ComputeSteadyStateVector(transitionMatrix, steadyStateVector, &iter, &res);
+
+		if(iterations != NULL) { *iterations = iter; }
+		if(residual != NULL) { *residual = res; }
 
-		memcpy(res, temp, transitionMatrixByteSize);
+		return CheckSteadyStateVector(success, method, steadyStateVector, numPeriodsInclDummies, numLoc, converged, iter, res);
 	}
 
-	ull firstRowIndex = GET_INDEX(0, 0, numStatesInclDummies);
+	// the other methods work on the dense matrix (numStatesInclDummies^2 entries, i.e. without the memory savings of the blocks)
+	ull denseMatrixByteSize = numStatesInclDummies * numStatesInclDummies * sizeof(double);
+	double* denseMatrix = (double*)Allocate(denseMatrixByteSize);
+	VERIFY(denseMatrix != NULL);
 
-	ull steadyStateVectorByteSize = numStatesInclDummies * sizeof(double);
-	memcpy(steadyStateVector, &res[firstRowIndex], steadyStateVectorByteSize);
+	Algorithms::ExpandBlockSparseMatrix(transitionMatrix, denseMatrix);
 
-	Free(temp);
-	Free(res);
+	bool success = ComputeSteadyStateVector(denseMatrix, method, steadyStateVector, converged, iterations, residual);
 
-	// check
-	double sum = 0.0;
-	for(ull i = 0; i < numStatesInclDummies; i++) { sum += steadyStateVector[i]; }
-	VERIFY(ABS(sum - 1.0) <= epsilon);
+	Free(denseMatrix);
 
-  // Bouml preserved body end 0007E511
+	return success;
+
+  // Bouml preserved body end 000C2B91
 }
 
-bool CreateContextOperation::DoGibbsSampling(vector<TraceVector>& learningTraces, double* priorTransitionsCount, UserProfile* profile) const 
+bool CreateContextOperation::DoGibbsSampling(vector<TraceVector>& learningTraces, double* priorTransitionsCount, UserProfile* profile, double* transitionsCount) const 
 {
   // Bouml preserved body begin 0007E491
 
 	if(learningTraces.empty() == true || priorTransitionsCount == NULL || profile == NULL) { return false; }
 
-	ull numTraces = learningTraces.size();
-
 	ull startTime = (ull)time(NULL);
 
 	ull user = profile->GetUser();
 
 	stringstream info("");
-	info << "Starting Gibbs Sampling for user " << user << "!";
+	info << "Starting Gibbs Sampling for user " << user;
+	if(numChains > 1) { info << " (" << numChains << " chains)"; }
+	info << "!";
 	Log::GetInstance()->Append(info.str());
 
 	Parameters* params = Parameters::GetInstance();
-	RNG* rng = RNG::GetInstance();
 
 	// get time parameters
 	//	ull minTime = 0; ull maxTime = 0;
@@ -571,29 +1036,86 @@ bool CreateContextOperation::DoGibbsSampling(vector<TraceVector>& learningTraces
 
 	VERIFY(numStatesInclDummies*numStatesInclDummies <= ((ull)((ll)-1))); // make sure we the problem size can be handled
 
-	// transition matrix
-	ull transitionMatrixByteSize = numStatesInclDummies * numStatesInclDummies * sizeof(double);
-	double* transitionMatrix = (double*)Allocate(transitionMatrixByteSize);
-	VERIFY(transitionMatrix != NULL);
-	memset(transitionMatrix, 0, transitionMatrixByteSize);
+	// the matrices below are block-sparse: only the (numLoc x numLoc) blocks of the time period transitions (tp1, tp2) which are possible are stored
+	// (this bounds the memory of the sampler only: the steady-state methods other than PowerIteration expand the matrix they are given, and the profile 
+	// built at the end stores dense matrices, as well as dense sub-chain tables, see UserProfile::GetSubChainTransitionMatrix())
+	BlockSparseMatrix priorCount; memset(&priorCount, 0, sizeof(priorCount));
+	VERIFY(Algorithms::GetBlockSparseMatrix(tpInfo.propTransMatrix, numPeriodsInclDummies, numLoc, &priorCount) == true);
+
+	if(Algorithms::CompressToBlockSparseMatrix(priorTransitionsCount, &priorCount) == false)
+	{
+		SET_ERROR_CODE_DETAILS(ERROR_CODE_IMPOSSIBLE_TRACE, "the provided count matrix is inconsistent with the time partitioning");
+		Algorithms::FreeBlockSparseMatrix(&priorCount);
+		return false;
+	}
 
-	// transition matrix sum
-	double* transitionMatrixSum = (double*)Allocate(transitionMatrixByteSize);
-	VERIFY(transitionMatrixSum != NULL);
-	memset(transitionMatrixSum, 0, transitionMatrixByteSize);
+	ull numEntries = priorCount.numBlocks * numLoc * numLoc; // number of stored entries
+	ull entriesByteSize = numEntries * sizeof(double);
 
-	// steady-state vector
+	// each chain has its own transition matrix, steady-state vector and estimated traces (constructed to "mirror" learningTraces)
 	ull steadyStateVectorByteSize = numStatesInclDummies * sizeof(double);
-	double* steadyStateVector = (double*)Allocate(steadyStateVectorByteSize);
-	VERIFY(steadyStateVector != NULL);
-	memset(steadyStateVector, 0, steadyStateVectorByteSize);
 
-	// variance matrix
-	ull varianceMatrixByteSize = numStates * numStates * sizeof(double);
-	double* varianceMatrix = (double*)Allocate(varianceMatrixByteSize);
-	VERIFY(varianceMatrix != NULL);
-	memset(varianceMatrix, 0, varianceMatrixByteSize);
+	vector<BlockSparseMatrix> transitionMatrices = vector<BlockSparseMatrix>();
+	vector<double*> steadyStateVectors = vector<double*>();
+	vector<vector<TraceVector> > estimatedTraces = vector<vector<TraceVector> >();
+	for(ull chain = 0; chain < numChains; chain++)
+	{
+		BlockSparseMatrix transitionMatrix; memset(&transitionMatrix, 0, sizeof(transitionMatrix));
+		VERIFY(Algorithms::GetBlockSparseMatrix(tpInfo.propTransMatrix, numPeriodsInclDummies, numLoc, &transitionMatrix) == true);
+		transitionMatrices.push_back(transitionMatrix);
+
+		double* steadyStateVector = (double*)Allocate(steadyStateVectorByteSize);
+		VERIFY(steadyStateVector != NULL);
+		memset(steadyStateVector, 0, steadyStateVectorByteSize);
+		steadyStateVectors.push_back(steadyStateVector);
+
+		vector<TraceVector> chainTraces = vector<TraceVector>();
+		foreach_const(vector<TraceVector>, learningTraces, iterTV)
+		{
+			TraceVector tvec = *iterTV;
+
+			TraceVector tvec2;
+			tvec2.offset = tvec.offset;
+			tvec2.length = tvec.length;
+
+			ull estimatedTraceByteSize = tvec2.length * sizeof(ull);
+			tvec2.trace = (ull*)Allocate(estimatedTraceByteSize);
+			VERIFY(tvec2.trace != NULL);
+			memcpy(tvec2.trace, tvec.trace, estimatedTraceByteSize);
+
+			chainTraces.push_back(tvec2);
+		}
+		VERIFY(chainTraces.size() == learningTraces.size());
 
+		estimatedTraces.push_back(chainTraces);
+	}
+
+	// transition matrix sum (over the samples of all chains)
+	BlockSparseMatrix transitionMatrixSum; memset(&transitionMatrixSum, 0, sizeof(transitionMatrixSum));
+	VERIFY(Algorithms::GetBlockSparseMatrix(tpInfo.propTransMatrix, numPeriodsInclDummies, numLoc, &transitionMatrixSum) == true);
+
+	// sum of squares (variance matrix)
+	BlockSparseMatrix squaredSum; memset(&squaredSum, 0, sizeof(squaredSum));
+	VERIFY(Algorithms::GetBlockSparseMatrix(tpInfo.propTransMatrix, numPeriodsInclDummies, numLoc, &squaredSum) == true);
+
+	// sum and sum of squares of the samples of each chain (used for the convergence diagnostics, if there are several chains)
+	vector<double*> chainSums = vector<double*>();
+	vector<double*> chainSquaredSums = vector<double*>();
+	if(numChains > 1)
+	{
+		for(ull chain = 0; chain < numChains; chain++)
+		{
+			double* chainSum = (double*)Allocate(entriesByteSize);
+			VERIFY(chainSum != NULL);
+			memset(chainSum, 0, entriesByteSize);
+			chainSums.push_back(chainSum);
+
+			double* chainSquaredSum = (double*)Allocate(entriesByteSize);
+			VERIFY(chainSquaredSum != NULL);
+			memset(chainSquaredSum, 0, entriesByteSize);
+			chainSquaredSums.push_back(chainSquaredSum);
+		}
+	}
 
 	// alpha (used for dirichlet sampling)
 	ull alphaByteSize = numLoc * numLoc * sizeof(double);
@@ -607,733 +1129,746 @@ bool CreateContextOperation::DoGibbsSampling(vector<TraceVector>& learningTraces
 	VERIFY(theta != NULL);
 	memset(theta, 0, thetaByteSize);
 
-	// estimated traces (constructed to "mirror" learningTraces)
-	vector<TraceVector> estimatedTraces = vector<TraceVector>();
-	foreach_const(vector<TraceVector>, learningTraces, iterTV)
-	{
-		TraceVector tvec = *iterTV;
+	// count
+	BlockSparseMatrix count; memset(&count, 0, sizeof(count));
+	VERIFY(Algorithms::GetBlockSparseMatrix(tpInfo.propTransMatrix, numPeriodsInclDummies, numLoc, &count) == true);
 
-		TraceVector tvec2;
-		tvec2.offset = tvec.offset;
-		tvec2.length = tvec.length;
+	ull burnInSteps = GetBurnIn();
 
-		ull estimatedTraceByteSize = tvec2.length * sizeof(ull);
-		tvec2.trace = (ull*)Allocate(estimatedTraceByteSize);
-		VERIFY(tvec2.trace != NULL);
-		memcpy(tvec2.trace, tvec.trace, estimatedTraceByteSize);
+	ull step = 1;
+	double maxRHat = DBL_MAX; // largest potential scale reduction factor over the entries of the transition matrix (computed only if there are several chains)
+	ull numDiagnosticSamples = 0; // number of samples of each chain in chainSums (i.e. drawn after step 0 and the burn-in iterations)
 
-		estimatedTraces.push_back(tvec2);
+	// resume from the last checkpoint of the user (if any), in which case step 0 is skipped
+	bool resumed = (checkpointPrefix.empty() == false && ReadSamplerState(user, &step, &transitionMatrixSum, &squaredSum, chainSums, chainSquaredSums, estimatedTraces) == true);
+	if(resumed == true)
+	{
+		numDiagnosticSamples = (step > burnInSteps + 1) ? step - burnInSteps - 1 : 0;
+		if(numChains > 1) { maxRHat = ComputePotentialScaleReduction(chainSums, chainSquaredSums, numDiagnosticSamples, numEntries); }
+
+		info.str("");
+		info << "Resuming Gibbs Sampling for user " << user << " after " << step << " iterations!";
+		Log::GetInstance()->Append(info.str());
 	}
-	VERIFY(estimatedTraces.size() == numTraces);
 
-	// count
-	ull countByteSize = numStatesInclDummies * numStatesInclDummies * sizeof(ull);
-	double* count = (double*)Allocate(countByteSize);
-	VERIFY(count != NULL);
-	memset(count, 0, countByteSize);
+	// the steady-state vectors of the samples only serve to sample the events preceding the first observed one: the last iterate of 
+	// an iterative method which did not converge is used for them (and reported below), rather than failing the whole procedure
+	ull numUnconvergedSteadyStates = 0;
 
 	// Step 0
 
 	/**** -- (a) P given LT, CM -- ****/
-	memcpy(count, priorTransitionsCount, countByteSize); // put prior transitions count in count
+	memcpy(count.values, priorCount.values, entriesByteSize); // put prior transitions count in count
 
 	// add transitions in the learning traces to count
+	bool countSuccess = AddTransitionsCount(learningTraces, &count);
+
 	bool allFull = true; bool computationNeedsSteadyState = false;
 	foreach_const(vector<TraceVector>, learningTraces, iterTV)
 	{
 		TraceVector tvec = *iterTV;
-		ull* trace = tvec.trace;
-		ull minTime = tvec.offset;
-		ull numTimes = tvec.length;
-		ull maxTime = minTime + numTimes - 1;
-
-		bool full = true;
-		for(ull tm = minTime; tm <= maxTime; tm++) // go to maxTime, but with wrap-around
-		{
-			ull nexttm = tm == maxTime ? minTime : (tm + 1); // next timestamp (with wrap-around)
-
-			ull startLoc = trace[(tm - minTime)];
-			ull endLoc = trace[(nexttm - minTime)];
-
-			if(tm == minTime && startLoc == 0) { computationNeedsSteadyState = true; }
-
-			if(startLoc == 0 || endLoc == 0) { full = false; continue; }
-
-
-			ull startTP = params->LookupTimePeriod(tm, true);
-			ull endTP = params->LookupTimePeriod(nexttm, true);
-			if(startTP == INVALID_TIME_PERIOD || endTP == INVALID_TIME_PERIOD)
-			{
-				SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-				return false;
-			}
-
-			ull startTPIdx = (startTP - minPeriod); ull endTPIdx = (endTP - minPeriod);
-			ull startLocIdx = (startLoc - minLoc); ull endLocIdx = (endLoc - minLoc);
-
-			ull startStateIdx = startTPIdx * numLoc + startLocIdx;
-			ull endStateIdx = endTPIdx * numLoc + endLocIdx;
-			ull countIdx = GET_INDEX(startStateIdx, endStateIdx, numStatesInclDummies);
-			count[countIdx]++;
-		}
+		for(ull tmIdx = 0; tmIdx < tvec.length; tmIdx++) { if(tvec.trace[tmIdx] == 0) { allFull = false; break; } }
 
-		if(full == false) { allFull = false; }
+		if(tvec.trace[0] == 0) { computationNeedsSteadyState = true; }
 	}
 
-	// Generate P^{0}
-	if(TransitionMatrixFromCountMatrix(count, alpha, theta, transitionMatrix, true) == false)
+	// Generate P^{0} of each chain (and add it to PSUM)
+	for(ull chain = 0; chain < numChains && resumed == false; chain++)
 	{
-		Free(count); Free(theta); Free(alpha);
-		Free(transitionMatrixSum);
-		Free(transitionMatrix);
-		Free(steadyStateVector);
-		foreach_const(vector<TraceVector>, estimatedTraces, iterTV)	{ TraceVector tvec = *iterTV; Free(tvec.trace); }
+		BlockSparseMatrix* transitionMatrix = &transitionMatrices[chain];
 
-		return false; // error code is set inside the function
-	}
+		bool success = (countSuccess == true && TransitionMatrixFromCountMatrix(&count, alpha, theta, transitionMatrix, true) == true);
 
-	// Set P^{0} to PSUM
-	memcpy(transitionMatrixSum, transitionMatrix, transitionMatrixByteSize);
+		if(success == true) { AddSample(transitionMatrix, &transitionMatrixSum, &squaredSum, NULL, NULL); } // (step 0 is discarded by the convergence diagnostics)
 
-	if(computationNeedsSteadyState == true)	{ ComputeSteadyStateVector(transitionMatrix, steadyStateVector); }
+		if(success == true && computationNeedsSteadyState == true)
+		{
+			bool converged = true;
+			success = ComputeSteadyStateVector(transitionMatrix, steadyStateMethod, steadyStateVectors[chain], &converged);
+			if(converged == false) { numUnconvergedSteadyStates++; }
+		}
 
-	// update variance matrix
-	for(ull stateIdx1 = 0; stateIdx1 < numStates; stateIdx1++)
-	{
-		for(ull stateIdx2 = 0; stateIdx2 < numStates; stateIdx2++)
+		if(success == false)
 		{
-			ull transMatrixIdx = GET_INDEX(stateIdx1, stateIdx2, numStatesInclDummies);
-			ull idx = GET_INDEX(stateIdx1, stateIdx2, numStates);
+			Free(theta); Free(alpha);
+			Algorithms::FreeBlockSparseMatrix(&count); Algorithms::FreeBlockSparseMatrix(&priorCount);
+			Algorithms::FreeBlockSparseMatrix(&transitionMatrixSum); Algorithms::FreeBlockSparseMatrix(&squaredSum);
+			FreeGibbsChains(transitionMatrices, steadyStateVectors, estimatedTraces, chainSums, chainSquaredSums);
 
-			double p = transitionMatrix[transMatrixIdx];
-			varianceMatrix[idx] += p*p;
+			return false; // error code is set inside the function
 		}
 	}
 
-	ull step = 1;
-
-	double* samplingProbVector = NULL;
+	// buffers used to fill the gaps of the learning traces (allocated once, see SampleMissingEvents())
+	double* samplingProbVector = NULL; double* forwardProbMatrix = NULL; ull* gapTPs = NULL;
 	if(allFull == false)
 	{
+		ull maxTraceLength = 0;
+		foreach_const(vector<TraceVector>, learningTraces, iterTV) { if(iterTV->length > maxTraceLength) { maxTraceLength = iterTV->length; } }
+
 		// vector from which we sample
 		ull samplingProbVectorByteSize = numLoc * sizeof(double); // this vector has numLoc entries (and not numStates) this is NOT a mistake!
 		samplingProbVector = (double*)Allocate(samplingProbVectorByteSize);
 		VERIFY(samplingProbVector != NULL);
 		memset(samplingProbVector, 0, samplingProbVectorByteSize);
 
+		// forward probabilities (one row of numLoc entries per element of a gap)
+		ull forwardProbMatrixByteSize = maxTraceLength * numLoc * sizeof(double);
+		forwardProbMatrix = (double*)Allocate(forwardProbMatrixByteSize);
+		VERIFY(forwardProbMatrix != NULL);
+		memset(forwardProbMatrix, 0, forwardProbMatrixByteSize);
+
+		// time periods of the elements of a gap
+		ull gapTPsByteSize = maxTraceLength * sizeof(ull);
+		gapTPs = (ull*)Allocate(gapTPsByteSize);
+		VERIFY(gapTPs != NULL);
+		memset(gapTPs, 0, gapTPsByteSize);
+
 		/**** -- (b) ET given P -- ****/
-		// Generate ET^{0}
-		for(ull trace = 0; trace < numTraces; trace++)
+		// Generate ET^{0} of each chain, a feasible initial sample (i.e. a trace of probability > 0)
+		for(ull chain = 0; chain < numChains && resumed == false; chain++)
 		{
-			TraceVector tvec = learningTraces[trace];
-			ull* learningTrace = tvec.trace; VERIFY(learningTrace != NULL);
-			ull minTime = tvec.offset;
-			ull numTimes = tvec.length;
-			ull maxTime = minTime + numTimes - 1;
-
-			TraceVector tvec2 = estimatedTraces[trace];
-			ull* estimatedTrace = tvec2.trace; VERIFY(estimatedTrace != NULL);
-			VERIFY(minTime == tvec2.offset && numTimes == tvec2.length);
-
-			double** gapsMatrixArray = NULL;
-
-			// here we want to generate a feasible initial sample (i.e. a trace of probability > 0)
-			// first we look over the trace and collect information about the gaps (i.e. the tps that they are composed of)
-			map<ull, vector<ull> > gapsTPsVectorMap = map<ull, vector<ull> >();
-			for(ull tm = minTime; tm <= maxTime; tm++)
+			if(SampleMissingEvents(learningTraces, estimatedTraces[chain], &transitionMatrices[chain], steadyStateVectors[chain], gapTPs, forwardProbMatrix, samplingProbVector) == false)
 			{
-				ull loc = learningTrace[(tm - minTime)];
+				Free(theta); Free(alpha);
+				Algorithms::FreeBlockSparseMatrix(&count); Algorithms::FreeBlockSparseMatrix(&priorCount);
+				Algorithms::FreeBlockSparseMatrix(&transitionMatrixSum); Algorithms::FreeBlockSparseMatrix(&squaredSum);
+				Free(samplingProbVector); Free(forwardProbMatrix); Free(gapTPs);
+				FreeGibbsChains(transitionMatrices, steadyStateVectors, estimatedTraces, chainSums, chainSquaredSums);
 
-				if(loc == 0) // no loc available (loc == 0)
-				{
-					ull key = tm;
-					vector<ull> tpVector = vector<ull>();
-
-					while(loc == 0)
-					{
-						ull tp = params->LookupTimePeriod(tm, true);
-						if(tp == INVALID_TIME_PERIOD)
-						{
-							SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-							return false;
-						}
+				return false; // error code is set inside the function
+			}
+		}
+	}
 
-						tpVector.push_back(tp);
+	// Steps 1, 2, ...
+	while(true)
+	{
+#define GS_MINIMUM_STEPS 2
+		// break if either the max number of GS iteration have been reached, the time limit has been exceeded, or the chains have converged
+		if(step >= maxGSPerUser && maxGSPerUser != KC_NO_LIMITS) { break; }
+		else if(maxSecondsPerUser != KC_NO_LIMITS && step >= GS_MINIMUM_STEPS && (time(NULL) - startTime) > maxSecondsPerUser) { break; }
+		else if(targetRHat != KC_NO_CONVERGENCE_TARGET && numDiagnosticSamples >= KC_CONVERGENCE_MIN_ITERATIONS && maxRHat <= targetRHat) { break; }
+#undef GS_MINIMUM_STEPS
 
-						if(tm == maxTime) { break; }
+		for(ull chain = 0; chain < numChains; chain++)
+		{
+			BlockSparseMatrix* transitionMatrix = &transitionMatrices[chain];
 
-						tm++;
-						loc = learningTrace[(tm - minTime)];
-					}
+			if(allFull == false) // if traces are all full, no need to recount
+			{
+				/**** -- (a) P given ET, CM -- ****/
+				memcpy(count.values, priorCount.values, entriesByteSize);  // put prior transitions count in count
 
-					pair<ull, vector<ull> > timeTPVectorPair = pair<ull, vector<ull> >(key, tpVector);
-					gapsTPsVectorMap.insert(timeTPVectorPair);
-				}
+				// count the number of transitions in ET^{step - 1}
+				countSuccess = AddTransitionsCount(estimatedTraces[chain], &count);
 			}
 
-			// In a second step, we fill missing events of each gap using a strategy which depends on the nature of the gap
-			pair_foreach_const(map<ull, vector<ull> >, gapsTPsVectorMap, iterGaps)
-			{
-				ull firstTime = iterGaps->first;
-				vector<ull> tpVector = iterGaps->second;
+			// Generate P^{step}
+			bool success = (countSuccess == true && TransitionMatrixFromCountMatrix(&count, alpha, theta, transitionMatrix, true) == true);
 
-				ull lastTime = firstTime + tpVector.size() - 1;
-				ull prevTime = firstTime - 1;
-				ull nextTime = lastTime + 1;
+			// Add P^{step} to PSUM (and to the sums of the chain, after the burn-in)
+			bool diagnosed = (numChains > 1 && step > burnInSteps);
+			if(success == true) { AddSample(transitionMatrix, &transitionMatrixSum, &squaredSum, diagnosed ? chainSums[chain] : NULL, diagnosed ? chainSquaredSums[chain] : NULL); }
 
-				ull prevLoc = 0; ull prevTp = 0;
-				ull nextLoc = 0; ull nextTp = 0;
+			if(success == true && computationNeedsSteadyState == true)
+			{
+				bool converged = true;
+				success = ComputeSteadyStateVector(transitionMatrix, steadyStateMethod, steadyStateVectors[chain], &converged);
+				if(converged == false) { numUnconvergedSteadyStates++; }
+			}
 
-				if(prevTime >= minTime) { prevLoc = learningTrace[(prevTime - minTime)]; prevTp = params->LookupTimePeriod(prevTime, true); }
-				if(nextTime <= maxTime) { nextLoc = learningTrace[(nextTime - minTime)]; nextTp = params->LookupTimePeriod(nextTime, true); }
+			/**** -- (b) ET given P -- ****/
+			// Generate ET^{step}: each gap is sampled as a block, given P and the locations surrounding it
+			if(success == true && allFull == false)
+			{
+				success = SampleMissingEvents(learningTraces, estimatedTraces[chain], transitionMatrix, steadyStateVectors[chain], gapTPs, forwardProbMatrix, samplingProbVector);
+			}
 
-				// switch over the different cases
-				if(nextLoc == 0) // fill forward
-				{
-					if(prevLoc == 0) // both are zero -> trace is empty -> fill forward without constraints
-					{
-						ull prevFilledLoc = 0;
-						ull prevFilledTp = 0;
-						for(ull tm = firstTime; tm <= lastTime; tm++)
-						{
-							double* tmpProbVector = NULL;
-							ull loc = 0;
+			if(success == false)
+			{
+				Free(theta); Free(alpha);
+				Algorithms::FreeBlockSparseMatrix(&count); Algorithms::FreeBlockSparseMatrix(&priorCount);
+				Algorithms::FreeBlockSparseMatrix(&transitionMatrixSum); Algorithms::FreeBlockSparseMatrix(&squaredSum);
+				if(samplingProbVector != NULL) { Free(samplingProbVector); Free(forwardProbMatrix); Free(gapTPs); }
+				FreeGibbsChains(transitionMatrices, steadyStateVectors, estimatedTraces, chainSums, chainSquaredSums);
 
-							ull gapElementIdx = tm - firstTime;
-							ull tp = tpVector[gapElementIdx];
+				return false; // error code is set inside the function
+			}
+		}
 
-							if(gapElementIdx == 0) // use steady state
-							{
-								VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, &tmpProbVector, true) == true);
-							}
-							else // use the transition vector (transition probability conditional on the current tp, the next tp, and the current loc)
-							{
-								VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, prevFilledTp, prevFilledLoc, tp, &tmpProbVector, true) == true);
-							}
+		step++;
 
-							loc = rng->SampleIndexFromVector(tmpProbVector, numLoc) + minLoc; // get sample
+		if(numChains > 1)
+		{
+			numDiagnosticSamples = (step > burnInSteps + 1) ? step - burnInSteps - 1 : 0;
+			maxRHat = ComputePotentialScaleReduction(chainSums, chainSquaredSums, numDiagnosticSamples, numEntries);
 
-							estimatedTrace[(tm - minTime)] = loc; // fill in the sampled location
+			LOG_MESSAGE(Log::debugLevel, "Gibbs Sampling for user " << user << ": R-hat " << maxRHat << " after " << step << " iterations");
+		}
 
-							prevFilledLoc = loc;
-							prevFilledTp = tp;
+		// checkpoint
+		if(checkpointPrefix.empty() == false && step % checkpointInterval == 0)
+		{
+			if(WriteSamplerState(user, step, &transitionMatrixSum, &squaredSum, chainSums, chainSquaredSums, estimatedTraces) == false)
+			{
+				LOG_MESSAGE(Log::warningLevel, "Could not save the state of the Gibbs Sampling for user " << user << " after " << step << " iterations!");
+			}
+		}
+	}
+	if(samplingProbVector != NULL) { Free(samplingProbVector); Free(forwardProbMatrix); Free(gapTPs); }
 
-							Free(tmpProbVector);
-						}
-					}
-					else  // we have a previous loc, but no next loc -> fill forward with prev loc constraint
-					{
-						ull prevFilledLoc = prevLoc;
-						ull prevFilledTp = prevTp;
-						for(ull tm = firstTime; tm <= lastTime; tm++)
-						{
-							double* tmpProbVector = NULL;
-							ull loc = 0;
+	if(checkpointPrefix.empty() == false) { remove(GetSamplerStateFileName(user).c_str()); } // the user is completed
 
-							ull gapElementIdx = tm - firstTime;
-							ull tp = tpVector[gapElementIdx];
+	ull numSamples = step * numChains;
 
-							 // use the transition vector (transition probability conditional on the current tp, the next tp, and the current loc)
-							VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, prevFilledTp, prevFilledLoc, tp, &tmpProbVector, true) == true);
+	info.str("");
+	info << "Finished Gibbs Sampling for user " << user << " after " << step << " iterations";
+	if(numChains > 1) { info << " of " << numChains << " chains (R-hat: " << maxRHat << " over the last " << numDiagnosticSamples << " iterations)"; }
+	info << " (" << (time(NULL) - startTime) << " seconds)!";
+	Log::GetInstance()->Append(info.str());
 
-							loc = rng->SampleIndexFromVector(tmpProbVector, numLoc) + minLoc; // get sample
+	if(numUnconvergedSteadyStates > 0)
+	{
+		LOG_MESSAGE(Log::warningLevel, "Gibbs Sampling for user " << user << ": the steady-state vectors of " << numUnconvergedSteadyStates << " sample(s) did not converge (the last iterates were used)!");
+	}
 
-							estimatedTrace[(tm - minTime)] = loc; // fill in the sampled location
+	// add the transitions observed in the learning traces (to be persisted), but not the sampled ones
+	if(transitionsCount != NULL)
+	{
+		memset(count.values, 0, entriesByteSize);
+		VERIFY(AddTransitionsCount(learningTraces, &count) == true); // the learning traces were counted successfully in step 0
 
-							prevFilledLoc = loc;
-							prevFilledTp = tp;
+		for(ull tp1Idx = 0; tp1Idx < numPeriods; tp1Idx++) // (non-dummy tps only)
+		{
+			for(ull block = count.blockRowStart[tp1Idx]; block < count.blockRowStart[tp1Idx + 1]; block++)
+			{
+				ull tp2Idx = count.blockColumns[block];
+				if(tp2Idx >= numPeriods) { continue; }
 
-							Free(tmpProbVector);
-						}
+				for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
+				{
+					for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++)
+					{
+						ull idx = GET_INDEX(tp1Idx * numLoc + loc1Idx, tp2Idx * numLoc + loc2Idx, numStates);
+						transitionsCount[idx] += count.values[(block * numLoc + loc1Idx) * numLoc + loc2Idx];
 					}
 				}
-				else // we have a next loc -> fill forward but we need to compute n steps transitions matrices
-				{
-					ull gapSize = lastTime - firstTime + 1;
+			}
+		}
+	}
 
-					// here we have to compute the i steps time period dependent transition matrix, for i=1, 2, ..., gapSize.
-					ull gapsMatrixByteSize = numLoc * numLoc * sizeof(double);
-					ull gapsMatrixArrayByteSize = gapSize * sizeof(double*);
+	// keep the steady-state vector of the first chain for the output
+	double* steadyStateVector = steadyStateVectors[0];
+	steadyStateVectors.erase(steadyStateVectors.begin());
 
-					gapsMatrixArray = (double**)Allocate(gapsMatrixArrayByteSize);
-					VERIFY(gapsMatrixArray != NULL);
-					memset(gapsMatrixArray, 0, gapsMatrixArrayByteSize);
+	FreeGibbsChains(transitionMatrices, steadyStateVectors, estimatedTraces, chainSums, chainSquaredSums);
+	Free(theta); Free(alpha);
+	Algorithms::FreeBlockSparseMatrix(&count); Algorithms::FreeBlockSparseMatrix(&priorCount);
 
-					ull lastGapElementIdx = gapSize - 1;
-					for(ull tm = lastTime; tm >= firstTime; tm--)
-					{
-						ull gapElementIdx = tm - firstTime;
-						ull tp = tpVector[gapElementIdx];
-						ull tp2 = (tm+1 <= lastTime) ? tpVector[gapElementIdx+1] : nextTp;
+	// average the transition matrix, and adjust the variance matrix
+	if(numSamples > 1)
+	{
+		for(ull idx = 0; idx < numEntries; idx++)
+		{
+			transitionMatrixSum.values[idx] /= numSamples;
+			squaredSum.values[idx] /= numSamples;
+		}
+	}
 
-						 double* subMatrix = (double*)Allocate(gapsMatrixByteSize);
-						 VERIFY(subMatrix != NULL);
-						 memset(subMatrix, 0, gapsMatrixByteSize);
+	// the steady-state vector of the profile must converge: otherwise, the failure is reported and the vector is computed by the (exact) dense linear solver
+	ull steadyStateIterations = 0; double steadyStateResidual = 0.0;
+	bool steadyStateSuccess = ComputeSteadyStateVector(&transitionMatrixSum, steadyStateMethod, steadyStateVector, NULL, &steadyStateIterations, &steadyStateResidual);
+	if(steadyStateSuccess == false && steadyStateMethod != DenseLinearSolve)
+	{
+		LOG_MESSAGE(Log::warningLevel, "Steady-state vector for user " << user << ": method " << steadyStateMethod << " failed after " << steadyStateIterations << " iterations (residual: " << steadyStateResidual << "), using DenseLinearSolve instead!");
 
-						 for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
-						 {
-							 ull transMatrixRowIdx = GET_INDEX((tp - minPeriod) * numLoc + loc1Idx, (tp2 - minPeriod) * numLoc, numStatesInclDummies);
-							 memcpy(&subMatrix[loc1Idx * numLoc], &transitionMatrix[transMatrixRowIdx], numLoc * sizeof(double));
+		steadyStateSuccess = ComputeSteadyStateVector(&transitionMatrixSum, DenseLinearSolve, steadyStateVector, NULL, &steadyStateIterations, &steadyStateResidual);
+	}
 
-							 NORMALIZE_VECTOR(&subMatrix[loc1Idx * numLoc], numLoc); // renormalize
-						 }
+	if(steadyStateSuccess == false)
+	{
+		Free(steadyStateVector);
+		Algorithms::FreeBlockSparseMatrix(&transitionMatrixSum); Algorithms::FreeBlockSparseMatrix(&squaredSum);
 
-						 if(gapElementIdx == lastGapElementIdx)
-						 {
-							 gapsMatrixArray[gapElementIdx] = subMatrix;
-						 }
-						 else
-						 {
-							 double* nextMatrix = gapsMatrixArray[gapElementIdx+1];
-							 VERIFY(nextMatrix != NULL);
+		return false; // error code is set inside the function
+	}
 
-							 double* prevMatrix = (double*)Allocate(gapsMatrixByteSize);
-							 VERIFY(prevMatrix != NULL);
-							 memset(prevMatrix, 0, gapsMatrixByteSize);
+	info.str("");
+	info << "Steady-state vector for user " << user << " computed in " << steadyStateIterations << " iterations (residual: " << steadyStateResidual << ")!";
+	Log::GetInstance()->Append(info.str());
 
-							 Algorithms::MultiplySquareMatrices(subMatrix, nextMatrix, numLoc, prevMatrix);
+	// the profile stores dense matrices
+	ull transitionMatrixByteSize = numStatesInclDummies * numStatesInclDummies * sizeof(double);
+	double* averageTransitionMatrix = (double*)Allocate(transitionMatrixByteSize);
+	VERIFY(averageTransitionMatrix != NULL);
+	Algorithms::ExpandBlockSparseMatrix(&transitionMatrixSum, averageTransitionMatrix);
+	Algorithms::FreeBlockSparseMatrix(&transitionMatrixSum);
 
-							 gapsMatrixArray[gapElementIdx] = prevMatrix;
+	ull varianceMatrixByteSize = numStates * numStates * sizeof(double);
+	double* varianceMatrix = (double*)Allocate(varianceMatrixByteSize);
+	VERIFY(varianceMatrix != NULL);
+	memset(varianceMatrix, 0, varianceMatrixByteSize);
 
-							 Free(subMatrix);
-						 }
-					}
+	for(ull tp1Idx = 0; tp1Idx < numPeriods; tp1Idx++) // (non-dummy tps only)
+	{
+		for(ull block = squaredSum.blockRowStart[tp1Idx]; block < squaredSum.blockRowStart[tp1Idx + 1]; block++)
+		{
+			ull tp2Idx = squaredSum.blockColumns[block];
+			if(tp2Idx >= numPeriods) { continue; }
 
-					// we take care of both prevLoc == 0 and prevLoc != 0 with the code below:
-					ull prevFilledLoc = prevLoc;
-					ull prevFilledTp = prevTp;
-					for(ull tm = firstTime; tm <= lastTime; tm++)
-					{
-						ull gapElementIdx = tm - firstTime;
-						ull tp = tpVector[gapElementIdx];
+			for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
+			{
+				ull idx = GET_INDEX(tp1Idx * numLoc + loc1Idx, tp2Idx * numLoc, numStates);
+				memcpy(&varianceMatrix[idx], &squaredSum.values[(block * numLoc + loc1Idx) * numLoc], numLoc * sizeof(double));
+			}
+		}
+	}
+	Algorithms::FreeBlockSparseMatrix(&squaredSum);
 
-						double* outgoingMatrix = gapsMatrixArray[gapElementIdx];
-						VERIFY(outgoingMatrix != NULL);
+	ull maxPeriod = tpInfo.maxPeriod;
 
-						double* incomingVector = NULL;
-						if(tm == firstTime && prevLoc == 0) // we have no previous loc, so the incoming vector is the steady-state vector
-						{
-							VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, &incomingVector, true) == true);
-						}
-						else
-						{
-							VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, prevFilledTp, prevFilledLoc, tp, &incomingVector, true) == true);
-						}
+	// if we have dummy tps then we need to extract the transition matrix and steady state vector over non-dummy tps
+	if(numStates != numStatesInclDummies)
+	{
+		// extract the transition matrix for non-dummy tps (exclude dummy tps)
+		ull transitionMatrixByteSize = numStates * numStates * sizeof(double);
+		double* transitionMatrix = (double*)Allocate(transitionMatrixByteSize);
+		VERIFY(transitionMatrix != NULL);
+		memset(transitionMatrix, 0, transitionMatrixByteSize);
 
-						ull loc = 0;
-						ull nextLocIdx = (nextLoc - minLoc);
-						double sum = 0.0;
-						for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
-						{
-							ull loc2Idx = (loc2 - minLoc);
+		for(ull tp1 = minPeriod; tp1 <= maxPeriod; tp1++)
+		{
+			for(ull loc1 = minLoc; loc1 <= maxLoc; loc1++)
+			{
+				ull state1Idx = (tp1 - minPeriod) * numLoc + (loc1 - minLoc);
 
-							// compute the probability of going to loc2 at time tp (from prevFilledLoc, at time prevFilledTp) and then from loc2
-							// going to nextLoc at time nextTp (going over lastTime - tm + 1 steps at times tpVector[gapElementIdx], tpVector[gapElementIdx+1], ...)
-							double incomingOutgoingProb = incomingVector[loc2Idx] * outgoingMatrix[GET_INDEX(loc2Idx, nextLocIdx, numLoc)];
-							samplingProbVector[loc2Idx] = incomingOutgoingProb;
+				double sum = 0.0;
+				for(ull tp2 = minPeriod; tp2 <= maxPeriod; tp2++)
+				{
+					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
+					{
+						ull state2Idx = (tp2 - minPeriod) * numLoc + (loc2 - minLoc);
 
-							sum += incomingOutgoingProb;
-						}
+						ull subMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStates);
+						ull fullMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStatesInclDummies);
 
-						if(sum == 0.0) // impossible trace
-						{
-							SET_ERROR_CODE(ERROR_CODE_IMPOSSIBLE_TRACE);
+						transitionMatrix[subMatrixIdx] = averageTransitionMatrix[fullMatrixIdx];
+						sum += transitionMatrix[subMatrixIdx];
+					}
+				}
 
-							Free(transitionMatrix);
-							Free(transitionMatrixSum);
-							Free(steadyStateVector);
+				// normalize
+				double check = 0.0;
+				for(ull tp2 = minPeriod; tp2 <= maxPeriod; tp2++)
+				{
+					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
+					{
+						ull state2Idx = (tp2 - minPeriod) * numLoc + (loc2 - minLoc);
 
-							Free(count);
-							foreach_const(vector<TraceVector>, estimatedTraces, iterTV)	{ TraceVector tvec = *iterTV; Free(tvec.trace); }
-							Free(samplingProbVector);
-							Free(incomingVector);
+						ull subMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStates);
+						transitionMatrix[subMatrixIdx] /= sum;
+						check += transitionMatrix[subMatrixIdx];
+					}
+				}
+				VERIFY(abs(check - 1) < EPSILON);
 
-							for(ull gapElementIdx = 0; gapElementIdx < gapSize; gapElementIdx++) { Free(gapsMatrixArray[gapElementIdx]); }
-							Free(gapsMatrixArray);
 
-							return false;
-						}
+				// adjust variance
+				for(ull tp2 = minPeriod; tp2 <= maxPeriod; tp2++)
+				{
+					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
+					{
+						ull state2Idx = (tp2 - minPeriod) * numLoc + (loc2 - minLoc);
 
-						NORMALIZE_VECTOR(samplingProbVector, numLoc);
+						ull subMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStates);
 
-						loc = rng->SampleIndexFromVector(samplingProbVector, numLoc) + minLoc; // get sample
+						varianceMatrix[subMatrixIdx] /= sum*sum;
+					}
+				}
 
-						estimatedTrace[(tm - minTime)] = loc; // fill in the sampled location
+			}
+		}
+		Free(averageTransitionMatrix);
 
-						prevFilledLoc = loc;
-						prevFilledTp = tp;
 
-						Free(incomingVector);
-					}
+		// extract the steady state vector for non-dummy tps (exclude dummy tps)
+		ull steadyStateVectorByteSize = numStates * sizeof(double);
+		double* subSteadyStateVector = (double*)Allocate(steadyStateVectorByteSize);
+		VERIFY(subSteadyStateVector != NULL);
+		memset(subSteadyStateVector, 0, steadyStateVectorByteSize);
 
-					// cleanup
-					for(ull gapElementIdx = 0; gapElementIdx < gapSize; gapElementIdx++) { Free(gapsMatrixArray[gapElementIdx]); }
-					Free(gapsMatrixArray);
-				}
+		double sum = 0.0;
+		for(ull tp = minPeriod; tp <= maxPeriod; tp++)
+		{
+			for(ull loc = minLoc; loc <= maxLoc; loc++)
+			{
+				ull vectorIdx = GET_INDEX(tp - minPeriod, loc - minLoc, numLoc);
+				subSteadyStateVector[vectorIdx] = steadyStateVector[vectorIdx]; // note: no difference in index, this is normal
+				sum += subSteadyStateVector[vectorIdx];
+			}
+		}
+
+		// normalize
+		for(ull tp = minPeriod; tp <= maxPeriod; tp++)
+		{
+			for(ull loc = minLoc; loc <= maxLoc; loc++)
+			{
+				ull vectorIdx = GET_INDEX(tp - minPeriod, loc - minLoc, numLoc);
+				subSteadyStateVector[vectorIdx] /= sum;
 			}
 		}
+		Free(steadyStateVector);
+
+		// set output
+		profile->SetTransitionMatrix(transitionMatrix);
+		profile->SetSteadyStateVector(subSteadyStateVector);
+		profile->SetAccuracyInfo(numSamples, varianceMatrix);
+	}
+	else
+	{
+		// set output
+		profile->SetTransitionMatrix(averageTransitionMatrix);
+		profile->SetSteadyStateVector(steadyStateVector);
+		profile->SetAccuracyInfo(numSamples, varianceMatrix);
 	}
 
-	// Steps 1, 2, ...
-	while(true)
+	return true;
+
+  // Bouml preserved body end 0007E491
+}
+
+bool CreateContextOperation::SampleMissingEvents(const vector<TraceVector>& learningTraces, vector<TraceVector>& estimatedTraces, const BlockSparseMatrix* transitionMatrix, const double* steadyStateVector, ull* gapTPs, double* forwardProbMatrix, double* samplingProbVector) const 
+{
+  // Bouml preserved body begin 000C2591
+
+	VERIFY(learningTraces.size() == estimatedTraces.size());
+	VERIFY(transitionMatrix != NULL && steadyStateVector != NULL && gapTPs != NULL && forwardProbMatrix != NULL && samplingProbVector != NULL);
+
+	Parameters* params = Parameters::GetInstance();
+
+	ull numTraces = learningTraces.size();
+	for(ull trace = 0; trace < numTraces; trace++)
 	{
-#define GS_MINIMUM_STEPS 2
-		// break if either the max number of GS iteration have been reached or the time limit has been exceeded
-		if(step == maxGSPerUser && maxGSPerUser != KC_NO_LIMITS) { break; }
-		else if(maxSecondsPerUser != KC_NO_LIMITS && step >= GS_MINIMUM_STEPS && (time(NULL) - startTime) > maxSecondsPerUser) { break; }
-#undef GS_MINIMUM_STEPS
+		TraceVector tvec = learningTraces[trace];
+		ull* learningTrace = tvec.trace; VERIFY(learningTrace != NULL);
+		ull minTime = tvec.offset;
+		ull numTimes = tvec.length;
+		ull maxTime = minTime + numTimes - 1;
 
-		if(allFull == false) // if traces are all full, no need to recount
+		TraceVector tvec2 = estimatedTraces[trace];
+		ull* estimatedTrace = tvec2.trace; VERIFY(estimatedTrace != NULL);
+		VERIFY(minTime == tvec2.offset && numTimes == tvec2.length);
+
+		ull tm = minTime;
+		while(tm <= maxTime)
 		{
-			/**** -- (a) P given ET, CM -- ****/
-			memcpy(count, priorTransitionsCount, countByteSize);  // put prior transitions count in count
+			if(learningTrace[(tm - minTime)] != 0) { tm++; continue; }
 
-			// count the number of transitions in ET^{step - 1}
-			foreach_const(vector<TraceVector>, estimatedTraces, iterTV)
+			// collect the tps of the gap starting at tm
+			ull firstTime = tm;
+			while(tm <= maxTime && learningTrace[(tm - minTime)] == 0)
 			{
-				TraceVector tvec = *iterTV;
-				ull* estimatedTrace = tvec.trace; VERIFY(estimatedTrace != NULL);
-				ull minTime = tvec.offset;
-				ull numTimes = tvec.length;
-				ull maxTime = minTime + numTimes - 1;
-
-				for(ull tm = minTime; tm <= maxTime; tm++) // go to maxTime, but with wrap-around
+				ull tp = params->LookupTimePeriod(tm, true);
+				if(tp == INVALID_TIME_PERIOD)
 				{
-					ull nexttm = tm == maxTime ? minTime : (tm + 1); // next timestamp (with wrap-around)
+					SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+					return false;
+				}
 
-					ull startLoc = estimatedTrace[(tm - minTime)];
-					ull endLoc = estimatedTrace[(nexttm - minTime)];
+				gapTPs[(tm - firstTime)] = tp;
+				tm++;
+			}
+			ull gapSize = tm - firstTime;
 
-					VERIFY(startLoc != 0 && endLoc != 0);
+			// the known locations surrounding the gap (if any)
+			ull prevLoc = 0; ull prevTp = 0;
+			ull nextLoc = 0; ull nextTp = 0;
 
-					ull startTP = params->LookupTimePeriod(tm, true);
-					ull endTP = params->LookupTimePeriod(nexttm, true);
-					if(startTP == INVALID_TIME_PERIOD || endTP == INVALID_TIME_PERIOD)
-					{
-						SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-						return false;
-					}
+			if(firstTime > minTime) { prevLoc = learningTrace[(firstTime - 1 - minTime)]; prevTp = params->LookupTimePeriod(firstTime - 1, true); }
+			if(tm <= maxTime) { nextLoc = learningTrace[(tm - minTime)]; nextTp = params->LookupTimePeriod(tm, true); }
 
-					ull startTPIdx = (startTP - minPeriod); ull endTPIdx = (endTP - minPeriod);
-					ull startLocIdx = (startLoc - minLoc); ull endLocIdx = (endLoc - minLoc);
+			if((prevLoc != 0 && prevTp == INVALID_TIME_PERIOD) || (nextLoc != 0 && nextTp == INVALID_TIME_PERIOD))
+			{
+				SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+				return false;
+			}
 
-					ull startStateIdx = startTPIdx * numLoc + startLocIdx;
-					ull endStateIdx = endTPIdx * numLoc + endLocIdx;
-					ull countIdx = GET_INDEX(startStateIdx, endStateIdx, numStatesInclDummies);
-					count[countIdx]++;
-				}
+			if(SampleGap(transitionMatrix, steadyStateVector, prevLoc, prevTp, gapTPs, gapSize, nextLoc, nextTp, forwardProbMatrix, samplingProbVector, &estimatedTrace[(firstTime - minTime)]) == false)
+			{
+				return false; // error code is set inside the function
 			}
 		}
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C2591
+}
+
+bool CreateContextOperation::SampleGap(const BlockSparseMatrix* transitionMatrix, const double* steadyStateVector, ull prevLoc, ull prevTp, const ull* gapTPs, ull gapSize, ull nextLoc, ull nextTp, double* forwardProbMatrix, double* samplingProbVector, ull* gapLocs) const 
+{
+  // Bouml preserved body begin 000C2611
+
+	VERIFY(gapSize != 0);
+
+	Parameters* params = Parameters::GetInstance();
+
+	// get location parameters
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(params->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	// get time period parameters
+	ull numPeriods = 0;  TPInfo tpInfo;
+	VERIFY(params->GetTimePeriodInfo(&numPeriods, &tpInfo) == true);
+	ull minPeriod = tpInfo.minPeriod;
 
-		// Generate P^{step}
-		VERIFY(TransitionMatrixFromCountMatrix(count, alpha, theta, transitionMatrix, true) == true);
+	// forward filtering: the row gapElementIdx of forwardProbMatrix holds the (normalized) probability of each loc at the time of gapElementIdx,
+	// given the previous loc (or the steady-state vector), divided by the mass of the row of the sub-chain used to leave it (so that the rows need not be renormalized)
+	for(ull gapElementIdx = 0; gapElementIdx < gapSize; gapElementIdx++)
+	{
+		ull tp = gapTPs[gapElementIdx];
+		double* forwardVector = &forwardProbMatrix[gapElementIdx * numLoc];
 
-		// Add P^{step} to PSUM
-		for(ull stateIdx1 = 0; stateIdx1 < numStatesInclDummies; stateIdx1++)
+		if(gapElementIdx == 0 && prevLoc == 0) // we have no previous loc, so we start from the steady-state vector
 		{
-			for(ull stateIdx2 = 0; stateIdx2 < numStatesInclDummies; stateIdx2++)
-			{
-				ull index = GET_INDEX(stateIdx1, stateIdx2, numStatesInclDummies);
-				transitionMatrixSum[index] += transitionMatrix[index];
-			}
+			VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, forwardVector, true) == true);
 		}
+		else if(gapElementIdx == 0)
+		{
+			const double* block = Algorithms::GetBlock(transitionMatrix, prevTp - minPeriod, tp - minPeriod);
 
-		if(computationNeedsSteadyState == true) { ComputeSteadyStateVector(transitionMatrix, steadyStateVector); }
-
-		// update variance matrix
-		for(ull stateIdx1 = 0; stateIdx1 < numStates; stateIdx1++)
+			if(block == NULL) { memset(forwardVector, 0, numLoc * sizeof(double)); }
+			else { memcpy(forwardVector, &block[(prevLoc - minLoc) * numLoc], numLoc * sizeof(double)); }
+		}
+		else
 		{
-			for(ull stateIdx2 = 0; stateIdx2 < numStates; stateIdx2++)
+			const double* prevForwardVector = &forwardProbMatrix[(gapElementIdx - 1) * numLoc];
+			const double* block = Algorithms::GetBlock(transitionMatrix, gapTPs[gapElementIdx - 1] - minPeriod, tp - minPeriod);
+
+			memset(forwardVector, 0, numLoc * sizeof(double));
+			for(ull loc1Idx = 0; loc1Idx < numLoc && block != NULL; loc1Idx++)
 			{
-				ull transMatrixIdx = GET_INDEX(stateIdx1, stateIdx2, numStatesInclDummies);
-				ull idx = GET_INDEX(stateIdx1, stateIdx2, numStates);
+				double prob = prevForwardVector[loc1Idx];
+				if(prob == 0.0) { continue; }
 
-				double p = transitionMatrix[transMatrixIdx];
-				varianceMatrix[idx] += p*p;
+				const double* transMatrixRow = &block[loc1Idx * numLoc];
+				for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++) { forwardVector[loc2Idx] += prob * transMatrixRow[loc2Idx]; }
 			}
 		}
 
-		if(allFull == false)
-		{
-			/**** -- (b) ET given P -- ****/
-			// Generate ET^{step}
-			for(ull trace = 0; trace < numTraces; trace++)
-			{
-				TraceVector tvec = learningTraces[trace];
-				ull* learningTrace = tvec.trace; VERIFY(learningTrace != NULL);
-				ull minTime = tvec.offset;
-				ull numTimes = tvec.length;
-				ull maxTime = minTime + numTimes - 1;
+		double sum = 0.0;
+		for(ull locIdx = 0; locIdx < numLoc; locIdx++) { sum += forwardVector[locIdx]; }
 
-				TraceVector tvec2 = estimatedTraces[trace];
-				ull* estimatedTrace = tvec2.trace; VERIFY(estimatedTrace != NULL);
-				VERIFY(minTime == tvec2.offset && numTimes == tvec2.length);
+		if(sum == 0.0) // impossible trace
+		{
+			SET_ERROR_CODE(ERROR_CODE_IMPOSSIBLE_TRACE);
+			return false;
+		}
 
-				for(ull tm = minTime; tm <= maxTime; tm++)
-				{
-					ull loc = learningTrace[(tm - minTime)];
-
-					// Lookup the proper time periods
-					ull tp = params->LookupTimePeriod(tm, true);
-					ull prevtp = tp;
-					if(tm > minTime) { prevtp = params->LookupTimePeriod(tm-1, true); }
-					ull nexttp = tp;
-					if(tm < maxTime) { nexttp = params->LookupTimePeriod(tm+1, true); }
-					if(prevtp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD || nexttp == INVALID_TIME_PERIOD)
-					{
-						SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-						return false;
-					}
+		for(ull locIdx = 0; locIdx < numLoc; locIdx++) { forwardVector[locIdx] /= sum; }
 
-					if(loc == 0) // no loc available (loc == 0)
-					{
-						double* probVector = samplingProbVector;
+		// divide by the mass of the rows of the sub-chain (tp, tp2), i.e. renormalize the transitions out of this element
+		if(gapElementIdx + 1 < gapSize || nextLoc != 0)
+		{
+			ull tp2 = (gapElementIdx + 1 < gapSize) ? gapTPs[gapElementIdx + 1] : nextTp;
+			const double* block = Algorithms::GetBlock(transitionMatrix, tp - minPeriod, tp2 - minPeriod);
 
-						double sum = 0.0;
-						if(tm == minTime) // first event
-						{
-							double* tmpSSV = NULL; // note: in this case, since tm == minTime, we have prevtp == tp
-							VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, &tmpSSV, true) == true);
+			for(ull loc1Idx = 0; loc1Idx < numLoc; loc1Idx++)
+			{
+				if(forwardVector[loc1Idx] == 0.0) { continue; }
 
-							for(ull loc2 = minLoc; loc2 <= numLoc; loc2++)
-							{
-								ull locIndex = loc2 - minLoc;
-								// probability of being at loc2 (at time tm, i.e. in time period tp == prevtp)
-								double presenceProb = tmpSSV[locIndex];
+				double rowSum = 0.0;
+				if(block != NULL) { for(ull loc2Idx = 0; loc2Idx < numLoc; loc2Idx++) { rowSum += block[loc1Idx * numLoc + loc2Idx]; } }
 
-								ull nextLocIndex = ((tm + 1) - minTime);
-								ull nextLoc = estimatedTrace[nextLocIndex];
+				forwardVector[loc1Idx] = (rowSum == 0.0) ? 0.0 : (forwardVector[loc1Idx] / rowSum);
+			}
+		}
+	}
 
-								// probability of going from loc2 (at time tm, i.e. in time period tp == prevtp) to nextLoc (at time tm+1, i.e. in time period nexttp)
-								double* transSubVector = NULL;
-								VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, tp, loc2, nexttp, &transSubVector, true) == true);
-								double transProb = transSubVector[(nextLoc - minLoc)];
-								Free(transSubVector); // free the sub-vector
+	// backward sampling: sample the last element given the next loc (if any), then each element given the one sampled after it
+	RNG* rng = RNG::GetInstance();
+	ull sampledLoc = nextLoc; ull sampledTp = nextTp;
+	for(ull gapElementIdx = gapSize; gapElementIdx-- > 0; )
+	{
+		ull tp = gapTPs[gapElementIdx];
+		const double* forwardVector = &forwardProbMatrix[gapElementIdx * numLoc];
 
-								double product = presenceProb * transProb;
+		double sum = 0.0;
+		if(sampledLoc == 0) // last element of a gap with no next loc
+		{
+			memcpy(samplingProbVector, forwardVector, numLoc * sizeof(double));
+			sum = 1.0;
+		}
+		else
+		{
+			const double* block = Algorithms::GetBlock(transitionMatrix, tp - minPeriod, sampledTp - minPeriod);
+			ull sampledLocIdx = sampledLoc - minLoc;
 
-								probVector[locIndex] = product;
-								sum += product;
-							}
+			for(ull locIdx = 0; locIdx < numLoc; locIdx++)
+			{
+				double prob = (block == NULL) ? 0.0 : (forwardVector[locIdx] * block[locIdx * numLoc + sampledLocIdx]);
+				samplingProbVector[locIdx] = prob;
+				sum += prob;
+			}
+		}
 
-							Free(tmpSSV); // free the sub-chain steady-state vector
-						}
-						else if(tm == maxTime) // last event
-						{
-							ull prevLocTmIndex = ((tm - 1) - minTime);
-							ull prevLoc = estimatedTrace[prevLocTmIndex];
+		if(sum == 0.0) // impossible trace
+		{
+			SET_ERROR_CODE(ERROR_CODE_IMPOSSIBLE_TRACE);
+			return false;
+		}
 
-							double* transSubVector = NULL;
-							VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, prevtp, prevLoc, tp, &transSubVector, true) == true);
+		NORMALIZE_VECTOR(samplingProbVector, numLoc);
 
-							for(ull loc2 = minLoc; loc2 <= numLoc; loc2++)
-							{
-								ull locIndex = loc2 - minLoc;
+		sampledLoc = rng->SampleIndexFromVector(samplingProbVector, numLoc) + minLoc; // get sample
+		sampledTp = tp;
 
-								// probability of going from prevLoc (at time tm-1, i.e. in time period prevtp) to loc2 (at time tm, i.e. in time period tp)
-								double transProb = transSubVector[locIndex];
+		gapLocs[gapElementIdx] = sampledLoc; // fill in the sampled location
+	}
 
-								probVector[locIndex] = transProb;
-								sum += transProb;
-							}
-							Free(transSubVector); // free the sub-vector
-						}
-						else // middle
-						{
+	return true;
 
-							ull prevLocTmIndex = ((tm - 1) - minTime);
-							ull prevLoc = estimatedTrace[prevLocTmIndex];
+  // Bouml preserved body end 000C2611
+}
 
-							ull nextLocTmIndex = ((tm + 1) - minTime);
-							ull nextLoc = estimatedTrace[nextLocTmIndex];
+void CreateContextOperation::AddSample(const BlockSparseMatrix* transitionMatrix, BlockSparseMatrix* transitionMatrixSum, BlockSparseMatrix* squaredSum, double* chainSum, double* chainSquaredSum) const 
+{
+  // Bouml preserved body begin 000C2711
 
-							double* transSubVector = NULL;
-							VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, prevtp, prevLoc, tp, &transSubVector, true) == true);
+	VERIFY(transitionMatrix->numBlocks == transitionMatrixSum->numBlocks && transitionMatrix->numBlocks == squaredSum->numBlocks);
 
-							// next step
-							// GetIntermediaryTransitionVector(intermProbVectorCache, transitionMatrix, prevLoc, nextLoc, prevTp, tp, nextTp, &transSubVector);
+	ull numEntries = transitionMatrix->numBlocks * transitionMatrix->blockDimension * transitionMatrix->blockDimension;
 
-							for(ull loc2 = minLoc; loc2 <= numLoc; loc2++)
-							{
-								ull locIndex = loc2 - minLoc;
+	// add the sample to PSUM and to the sum of squares (variance matrix), and to the sums of the chain
+	for(ull idx = 0; idx < numEntries; idx++)
+	{
+		double p = transitionMatrix->values[idx];
 
-								// probability of going from prevLoc (at time tm-1, i.e. in time period prevtp) to loc2 (at time tm, i.e. in time period tp)
-								double prevTransProb = transSubVector[locIndex];
+		transitionMatrixSum->values[idx] += p;
+		squaredSum->values[idx] += p*p;
 
-								// probability of going from loc2 (at time tm, i.e. in time period tp) to nextLoc (at time tm+1, i.e. in time period nexttp)
-								double* nextTransSubVector = NULL;
-								VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, tp, loc2, nexttp, &nextTransSubVector, true) == true);
-								double nextTransProb = nextTransSubVector[(nextLoc - minLoc)];
-								Free(nextTransSubVector); // free the sub-vector
+		if(chainSum != NULL) { chainSum[idx] += p; chainSquaredSum[idx] += p*p; }
+	}
 
-								double product = prevTransProb * nextTransProb;
+  // Bouml preserved body end 000C2711
+}
 
-								probVector[locIndex] = product;
-								sum += product;
-							}
-							Free(transSubVector); // free the sub-vector
-						}
+bool CreateContextOperation::AddTransitionsCount(const vector<TraceVector>& traces, BlockSparseMatrix* count) const 
+{
+  // Bouml preserved body begin 000C2C11
 
+	Parameters* params = Parameters::GetInstance();
 
-						NORMALIZE_VECTOR(probVector, numLoc);  // normalization
-						// for(ull loc2 = minLoc; loc2 <= numLoc; loc2++){ probVector[loc2 - minLoc] /= sum; }
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(params->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
 
-						// get the loc by sampling from probVector
-						loc = minLoc + RNG::GetInstance()->SampleIndexFromVector(probVector, numLoc);
-						estimatedTrace[(tm - minTime)] = loc;
-					}
-				}
-			}
-		}
+	ull numPeriods = 0;  TPInfo tpInfo;
+	VERIFY(params->GetTimePeriodInfo(&numPeriods, &tpInfo) == true);
+	ull minPeriod = tpInfo.minPeriod;
 
-		step++;
-	}
-	if(samplingProbVector != NULL) { Free(samplingProbVector); }
-	foreach_const(vector<TraceVector>, estimatedTraces, iterTV)	{ TraceVector tvec = *iterTV; Free(tvec.trace); }
+	foreach_const(vector<TraceVector>, traces, iterTV)
+	{
+		TraceVector tvec = *iterTV;
+		ull* trace = tvec.trace; VERIFY(trace != NULL);
+		ull minTime = tvec.offset;
+		ull numTimes = tvec.length;
+		ull maxTime = minTime + numTimes - 1;
 
-	info.str("");
-	info << "Finished Gibbs Sampling for user " << user << " after " << step << " iterations (" << (time(NULL) - startTime) << " seconds)!";
-	Log::GetInstance()->Append(info.str());
+		for(ull tm = minTime; tm <= maxTime; tm++) // go to maxTime, but with wrap-around
+		{
+			ull nexttm = tm == maxTime ? minTime : (tm + 1); // next timestamp (with wrap-around)
 
-	Free(transitionMatrix);
-	Free(count);
+			ull startLoc = trace[(tm - minTime)];
+			ull endLoc = trace[(nexttm - minTime)];
 
+			if(startLoc == 0 || endLoc == 0) { continue; }
 
-	if(step > 1)
-	{
-		// average the transition matrix
-		for(ull stateIdx1 = 0; stateIdx1 < numStatesInclDummies; stateIdx1++)
-		{
-			for(ull stateIdx2 = 0; stateIdx2 < numStatesInclDummies; stateIdx2++)
+			ull startTP = params->LookupTimePeriod(tm, true);
+			ull endTP = params->LookupTimePeriod(nexttm, true);
+			if(startTP == INVALID_TIME_PERIOD || endTP == INVALID_TIME_PERIOD)
 			{
-				ull index = GET_INDEX(stateIdx1, stateIdx2, numStatesInclDummies);
-				transitionMatrixSum[index] /= step;
+				SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+				return false;
 			}
-		}
 
-		// adjust variance matrix
-		for(ull stateIdx1 = 0; stateIdx1 < numStates; stateIdx1++)
-		{
-			for(ull stateIdx2 = 0; stateIdx2 < numStates; stateIdx2++)
+			double* block = Algorithms::GetBlock(count, startTP - minPeriod, endTP - minPeriod);
+			if(block == NULL) // the time period transition is not possible
 			{
-				ull index = GET_INDEX(stateIdx1, stateIdx2, numStates);
-				varianceMatrix[index] /= step;
+				SET_ERROR_CODE_DETAILS(ERROR_CODE_IMPOSSIBLE_TRACE, "the provided count matrix is inconsistent with the time partitioning");
+				return false;
 			}
+
+			block[GET_INDEX(startLoc - minLoc, endLoc - minLoc, numLoc)]++;
 		}
 	}
 
-	ComputeSteadyStateVector(transitionMatrixSum, steadyStateVector);
-
-	ull maxPeriod = tpInfo.maxPeriod;
+	return true;
 
-	// if we have dummy tps then we need to extract the transition matrix and steady state vector over non-dummy tps
-	if(numStates != numStatesInclDummies)
-	{
-		// extract the transition matrix for non-dummy tps (exclude dummy tps)
-		ull transitionMatrixByteSize = numStates * numStates * sizeof(double);
-		transitionMatrix = (double*)Allocate(transitionMatrixByteSize);
-		VERIFY(transitionMatrix != NULL);
-		memset(transitionMatrix, 0, transitionMatrixByteSize);
+  // Bouml preserved body end 000C2C11
+}
 
-		for(ull tp1 = minPeriod; tp1 <= maxPeriod; tp1++)
-		{
-			for(ull loc1 = minLoc; loc1 <= maxLoc; loc1++)
-			{
-				ull state1Idx = (tp1 - minPeriod) * numLoc + (loc1 - minLoc);
+double CreateContextOperation::ComputePotentialScaleReduction(const vector<double*>& chainSums, const vector<double*>& chainSquaredSums, ull numSamples, ull numEntries) const 
+{
+  // Bouml preserved body begin 000C2791
 
-				double sum = 0.0;
-				for(ull tp2 = minPeriod; tp2 <= maxPeriod; tp2++)
-				{
-					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
-					{
-						ull state2Idx = (tp2 - minPeriod) * numLoc + (loc2 - minLoc);
+	ull numChains = chainSums.size();
+	VERIFY(numChains > 1 && chainSquaredSums.size() == numChains);
 
-						ull subMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStates);
-						ull fullMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStatesInclDummies);
+	if(numSamples < 2) { return DBL_MAX; }
 
-						transitionMatrix[subMatrixIdx] = transitionMatrixSum[fullMatrixIdx];
-						sum += transitionMatrix[subMatrixIdx];
-					}
-				}
+	double n = (double)numSamples; double m = (double)numChains;
 
-				// normalize
-				double check = 0.0;
-				for(ull tp2 = minPeriod; tp2 <= maxPeriod; tp2++)
-				{
-					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
-					{
-						ull state2Idx = (tp2 - minPeriod) * numLoc + (loc2 - minLoc);
+	double maxRHat = 1.0;
+	for(ull idx = 0; idx < numEntries; idx++)
+	{
+		// within-chain variance W and between-chain variance B (divided by n)
+		double meanSum = 0.0; double meanSquaredSum = 0.0; double withinVariance = 0.0;
+		for(ull chain = 0; chain < numChains; chain++)
+		{
+			double mean = chainSums[chain][idx] / n;
+			double variance = (chainSquaredSums[chain][idx] - n * mean * mean) / (n - 1.0);
 
-						ull subMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStates);
-						transitionMatrix[subMatrixIdx] /= sum;
-						check += transitionMatrix[subMatrixIdx];
-					}
-				}
-				VERIFY(abs(check - 1) < EPSILON);
+			meanSum += mean; meanSquaredSum += mean * mean;
+			withinVariance += (variance > 0.0) ? variance : 0.0;
+		}
+		withinVariance /= m;
 
+		double betweenVariance = (meanSquaredSum - meanSum * meanSum / m) / (m - 1.0);
+		if(betweenVariance < 0.0) { betweenVariance = 0.0; }
 
-				// adjust variance
-				for(ull tp2 = minPeriod; tp2 <= maxPeriod; tp2++)
-				{
-					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
-					{
-						ull state2Idx = (tp2 - minPeriod) * numLoc + (loc2 - minLoc);
+		if(withinVariance <= RHAT_MIN_VARIANCE)
+		{
+			if(betweenVariance <= RHAT_MIN_VARIANCE) { continue; } // (numerically) constant entry, e.g. an unfeasible transition
 
-						ull subMatrixIdx = GET_INDEX(state1Idx, state2Idx, numStates);
+			return DBL_MAX; // the chains are stuck at different values
+		}
 
-						varianceMatrix[subMatrixIdx] /= sum*sum;
-					}
-				}
+		double pooledVariance = ((n - 1.0) / n) * withinVariance + betweenVariance;
 
-			}
-		}
-		Free(transitionMatrixSum);
+		double rHat = sqrt(pooledVariance / withinVariance);
+		if(rHat > maxRHat) { maxRHat = rHat; }
+	}
 
+	return maxRHat;
 
-		// extract the steady state vector for non-dummy tps (exclude dummy tps)
-		ull steadyStateVectorByteSize = numStates * sizeof(double);
-		double* subSteadyStateVector = (double*)Allocate(steadyStateVectorByteSize);
-		VERIFY(subSteadyStateVector != NULL);
-		memset(subSteadyStateVector, 0, steadyStateVectorByteSize);
+  // Bouml preserved body end 000C2791
+}
 
-		double sum = 0.0;
-		for(ull tp = minPeriod; tp <= maxPeriod; tp++)
-		{
-			for(ull loc = minLoc; loc <= maxLoc; loc++)
-			{
-				ull vectorIdx = GET_INDEX(tp - minPeriod, loc - minLoc, numLoc);
-				subSteadyStateVector[vectorIdx] = steadyStateVector[vectorIdx]; // note: no difference in index, this is normal
-				sum += subSteadyStateVector[vectorIdx];
-			}
-		}
+ull CreateContextOperation::GetBurnIn() const 
+{
+  // Bouml preserved body begin 000C5311
 
-		// normalize
-		for(ull tp = minPeriod; tp <= maxPeriod; tp++)
-		{
-			for(ull loc = minLoc; loc <= maxLoc; loc++)
-			{
-				ull vectorIdx = GET_INDEX(tp - minPeriod, loc - minLoc, numLoc);
-				subSteadyStateVector[vectorIdx] /= sum;
-			}
-		}
-		Free(steadyStateVector);
+	if(burnIn != KC_DEFAULT_BURN_IN) { return burnIn; }
 
-		// set output
-		profile->SetTransitionMatrix(transitionMatrix);
-		profile->SetSteadyStateVector(subSteadyStateVector);
-		profile->SetAccuracyInfo(step, varianceMatrix);
-	}
-	else
-	{
-		// set output
-		profile->SetTransitionMatrix(transitionMatrixSum);
-		profile->SetSteadyStateVector(steadyStateVector);
-		profile->SetAccuracyInfo(step, varianceMatrix);
-	}
+	// half of the iterations after step 0, so that the other half is diagnosed
+	if(maxGSPerUser != KC_NO_LIMITS) { return (maxGSPerUser - 1) / 2; }
 
-	return true;
+	return KC_TIME_LIMITED_BURN_IN;
 
-  // Bouml preserved body end 0007E491
+  // Bouml preserved body end 000C5311
 }
 
 bool CreateContextOperation::ReadKnowledgeFiles(const KnowledgeInput* input, map<ull, vector<TraceVector> >& learningTraces, map<ull, double*>& priorTransitionsCount, bool** transitionsFeasibilityMatrix) 
@@ -1913,5 +2448,308 @@ bool CreateContextOperation::ReadLearningTraces(const vector<File*>& learningTra
   // Bouml preserved body end 00081F91
 }
 
+bool CreateContextOperation::WriteTransitionsCount(const File* transitionsCountFile, const map<ull, double*>& transitionsCount) const 
+{
+  // Bouml preserved body begin 000C2D91
+
+	VERIFY(transitionsCountFile != NULL);
+
+	Parameters* params = Parameters::GetInstance();
+
+	// get location parameters
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(params->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	// get time period parameters
+	ull numPeriods = 0;
+	VERIFY(params->GetTimePeriodInfo(&numPeriods, NULL) == true);
+
+	ull numStates = numPeriods * numLoc;
+
+	ull* values = (ull*)Allocate(numStates * numStates * sizeof(ull));
+	VERIFY(values != NULL);
+
+	bool success = true;
+	pair_foreach_const(map<ull, double*>, transitionsCount, iter)
+	{
+		const double* count = iter->second;
+		VERIFY(count != NULL);
+
+		for(ull idx = 0; idx < numStates * numStates; idx++) { values[idx] = (ull)count[idx]; } // the counts are integers
+
+		stringstream line(""); line << iter->first;
+		success = success && transitionsCountFile->WriteLine(line.str());
+
+		success = success && transitionsCountFile->WriteLine(""); // leave one line empty
+
+		vector<string> lines = vector<string>();
+		VERIFY(LineFormatter<ull>::GetInstance()->FormatMatrix(values, numStates, numStates, lines) == true);
+		foreach_const(vector<string>, lines, lineIter) { success = success && transitionsCountFile->WriteLine(*lineIter); }
+
+		success = success && transitionsCountFile->WriteLine("");
+		success = success && transitionsCountFile->WriteLine("");
+	}
+
+	Free(values);
+
+	if(success == false) { SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS); }
+
+	return success;
+
+  // Bouml preserved body end 000C2D91
+}
+
+bool CreateContextOperation::ReadJournal(ull* journalSeed, map<ull, UserProfile*>& profiles, map<ull, double*>& transitionsCount) const 
+{
+  // Bouml preserved body begin 000C2F91
+
+	VERIFY(journalSeed != NULL);
+
+	profiles.clear();
+	transitionsCount.clear();
+
+	Parameters* params = Parameters::GetInstance();
+
+	// get location parameters
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(params->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	// get time period parameters
+	ull numPeriods = 0;
+	VERIFY(params->GetTimePeriodInfo(&numPeriods, NULL) == true);
+
+	ull numStates = numPeriods * numLoc;
+	ull matrixByteSize = numStates * numStates * sizeof(double);
+
+	File journal(checkpointPrefix + KC_JOURNAL_FILE_SUFFIX);
+	if(journal.IsGood() == false) { return false; } // no journal yet
+
+	// the journal starts with the line "seed" (the base seed of the execution which wrote it)
+	string seedLine = "";
+	vector<ull> seedFields = vector<ull>(); size_t seedPos = 0;
+	if(journal.ReadNextLine(seedLine) == false || LineParser<ull>::GetInstance()->ParseFields(seedLine, seedFields, 1, &seedPos) == false || seedPos != string::npos) { return false; }
+
+	*journalSeed = seedFields[0];
+
+	// each entry is made of the line "user, hasTransitionsCount", followed by the transition matrix (numStates lines), 
+	// the steady-state vector, the transitions count (numStates lines, if any), and an empty line
+	while(true)
+	{
+		string line = "";
+		if(journal.ReadNextLine(line) == false || line.empty() == true) { break; } // end of the journal
+
+		vector<ull> header = vector<ull>(); size_t pos = 0;
+		if(LineParser<ull>::GetInstance()->ParseFields(line, header, 2, &pos) == false || pos != string::npos) { break; }
+
+		ull user = header[0]; bool hasTransitionsCount = (header[1] != 0);
+
+		double* transitionMatrix = (double*)Allocate(matrixByteSize);
+		double* steadyStateVector = (double*)Allocate(numStates * sizeof(double));
+		double* userTransitionsCount = hasTransitionsCount == true ? (double*)Allocate(matrixByteSize) : NULL;
+		VERIFY(transitionMatrix != NULL && steadyStateVector != NULL && (hasTransitionsCount == false || userTransitionsCount != NULL));
+
+		bool complete = (profiles.find(user) == profiles.end());
+		for(ull stateIdx = 0; stateIdx < numStates && complete == true; stateIdx++) { complete = ReadDoublesLine(&journal, &transitionMatrix[stateIdx * numStates], numStates); }
+		complete = complete && ReadDoublesLine(&journal, steadyStateVector, numStates);
+		for(ull stateIdx = 0; stateIdx < numStates && complete == true && hasTransitionsCount == true; stateIdx++) { complete = ReadDoublesLine(&journal, &userTransitionsCount[stateIdx * numStates], numStates); }
+		complete = complete && journal.ReadNextLine(line) == true && line.empty() == true;
+
+		if(complete == false) // the entry was left incomplete (or is a duplicate)
+		{
+			Free(transitionMatrix); Free(steadyStateVector);
+			if(userTransitionsCount != NULL) { Free(userTransitionsCount); }
+
+			break;
+		}
+
+		UserProfile* profile = new UserProfile(user);
+		VERIFY(profile != NULL);
+
+		profile->SetTransitionMatrix(transitionMatrix);
+		profile->SetSteadyStateVector(steadyStateVector);
+
+		profiles.insert(pair<ull, UserProfile*>(user, profile));
+		if(userTransitionsCount != NULL) { transitionsCount.insert(pair<ull, double*>(user, userTransitionsCount)); }
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C2F91
+}
+
+bool CreateContextOperation::AppendToJournal(const UserProfile* profile, const double* transitionsCount) const 
+{
+  // Bouml preserved body begin 000C3011
+
+	if(journalFile == NULL) { return true; } // no checkpoints
+
+	Parameters* params = Parameters::GetInstance();
+
+	// get location parameters
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(params->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	// get time period parameters
+	ull numPeriods = 0;
+	VERIFY(params->GetTimePeriodInfo(&numPeriods, NULL) == true);
+
+	ull numStates = numPeriods * numLoc;
+
+	double* transitionMatrix = NULL; double* steadyStateVector = NULL;
+	VERIFY(profile->GetTransitionMatrix(&transitionMatrix) == true && profile->GetSteadyStateVector(&steadyStateVector) == true);
+
+	stringstream header("");
+	header << profile->GetUser() << DEFAULT_FIELDS_DELIMITER << " " << ((transitionsCount != NULL) ? 1 : 0);
+
+	pthread_mutex_lock(&journalLock);
+
+	bool success = journalFile->WriteLine(header.str());
+	for(ull stateIdx = 0; stateIdx < numStates && success == true; stateIdx++) { success = WriteDoublesLine(journalFile, &transitionMatrix[stateIdx * numStates], numStates); }
+	success = success && WriteDoublesLine(journalFile, steadyStateVector, numStates);
+	for(ull stateIdx = 0; stateIdx < numStates && success == true && transitionsCount != NULL; stateIdx++) { success = WriteDoublesLine(journalFile, &transitionsCount[stateIdx * numStates], numStates); }
+	success = success && journalFile->WriteLine(""); // (flushed)
+
+	pthread_mutex_unlock(&journalLock);
+
+	if(success == false) { SET_ERROR_CODE_DETAILS(ERROR_CODE_INVALID_ARGUMENTS, "the journal could not be written"); }
+
+	return success;
+
+  // Bouml preserved body end 000C3011
+}
+
+bool CreateContextOperation::WriteSamplerState(ull user, ull step, const BlockSparseMatrix* transitionMatrixSum, const BlockSparseMatrix* squaredSum, const vector<double*>& chainSums, const vector<double*>& chainSquaredSums, const vector<vector<TraceVector> >& estimatedTraces) const 
+{
+  // Bouml preserved body begin 000C3091
+
+	VERIFY(estimatedTraces.size() == numChains);
+
+	ull numEntries = transitionMatrixSum->numBlocks * transitionMatrixSum->blockDimension * transitionMatrixSum->blockDimension;
+	ull numTraces = estimatedTraces[0].size();
+
+	ull totalLength = 0;
+	foreach_const(vector<TraceVector>, estimatedTraces[0], iterTV) { totalLength += iterTV->length; }
+
+	string fileName = GetSamplerStateFileName(user);
+	string tempFileName = fileName + ".tmp";
+
+	bool success = true;
+	{
+		std::fstream file(tempFileName.c_str(), std::fstream::out | std::fstream::trunc | std::fstream::binary);
+		success = file.is_open();
+
+		// the header "user, seed, numChains, burnIn, step, rngState, numEntries, numTraces, totalLength", followed by the sums (and the sums of each chain, 
+		// if there are several chains), and by the estimated traces of each chain, all of them stored as raw values
+		ull header[KC_SAMPLER_STATE_HEADER_SIZE] = { user, checkpointSeed, numChains, GetBurnIn(), step, RNG::GetInstance()->GetThreadStreamState(), numEntries, numTraces, totalLength };
+		success = success && WriteValues(file, header, sizeof(header));
+
+		success = success && WriteValues(file, transitionMatrixSum->values, numEntries * sizeof(double));
+		success = success && WriteValues(file, squaredSum->values, numEntries * sizeof(double));
+
+		for(ull chain = 0; chain < chainSums.size() && success == true; chain++)
+		{
+			success = WriteValues(file, chainSums[chain], numEntries * sizeof(double)) && WriteValues(file, chainSquaredSums[chain], numEntries * sizeof(double));
+		}
+
+		for(ull chain = 0; chain < numChains && success == true; chain++)
+		{
+			foreach_const(vector<TraceVector>, estimatedTraces[chain], iterTV)
+			{
+				TraceVector tvec = *iterTV;
+				success = success && WriteValues(file, tvec.trace, tvec.length * sizeof(ull));
+			}
+		}
+
+		success = success && file.flush().good();
+	} // (the file is closed here)
+
+	// replace the previous state at once, so that an interruption leaves either one of them
+	if(success == true) { success = (rename(tempFileName.c_str(), fileName.c_str()) == 0); }
+	if(success == false) { remove(tempFileName.c_str()); }
+
+	return success;
+
+  // Bouml preserved body end 000C3091
+}
+
+bool CreateContextOperation::ReadSamplerState(ull user, ull* step, BlockSparseMatrix* transitionMatrixSum, BlockSparseMatrix* squaredSum, vector<double*>& chainSums, vector<double*>& chainSquaredSums, vector<vector<TraceVector> >& estimatedTraces) const 
+{
+  // Bouml preserved body begin 000C3111
+
+	VERIFY(step != NULL && estimatedTraces.size() == numChains);
+
+	std::fstream file(GetSamplerStateFileName(user).c_str(), std::fstream::in | std::fstream::binary);
+	if(file.is_open() == false) { return false; } // no checkpoint
+
+	ull numEntries = transitionMatrixSum->numBlocks * transitionMatrixSum->blockDimension * transitionMatrixSum->blockDimension;
+	ull numTraces = estimatedTraces[0].size();
+
+	ull totalLength = 0;
+	foreach_const(vector<TraceVector>, estimatedTraces[0], iterTV) { totalLength += iterTV->length; }
+
+	ull header[KC_SAMPLER_STATE_HEADER_SIZE];
+	if(ReadValues(file, header, sizeof(header)) == false) { return false; }
+
+	// the state must have been saved with the same settings and seed
+	if(header[0] != user || header[1] != checkpointSeed || header[2] != numChains || header[3] != GetBurnIn() || header[4] == 0 || header[6] != numEntries || header[7] != numTraces || header[8] != totalLength) { return false; }
+
+	// read the whole state before restoring it
+	ull numSums = 2 + chainSums.size() + chainSquaredSums.size();
+	double* sums = (double*)Allocate(numSums * numEntries * sizeof(double));
+	VERIFY(sums != NULL);
+
+	ull* traces = (ull*)Allocate(numChains * totalLength * sizeof(ull));
+	VERIFY(traces != NULL);
+
+	bool success = ReadValues(file, sums, numSums * numEntries * sizeof(double)) && ReadValues(file, traces, numChains * totalLength * sizeof(ull));
+
+	if(success == true) // restore the state
+	{
+		memcpy(transitionMatrixSum->values, &sums[0], numEntries * sizeof(double));
+		memcpy(squaredSum->values, &sums[numEntries], numEntries * sizeof(double));
+
+		for(ull chain = 0; chain < chainSums.size(); chain++)
+		{
+			memcpy(chainSums[chain], &sums[(2 + 2 * chain) * numEntries], numEntries * sizeof(double));
+			memcpy(chainSquaredSums[chain], &sums[(3 + 2 * chain) * numEntries], numEntries * sizeof(double));
+		}
+
+		ull offset = 0;
+		for(ull chain = 0; chain < numChains; chain++)
+		{
+			foreach_const(vector<TraceVector>, estimatedTraces[chain], iterTV)
+			{
+				TraceVector tvec = *iterTV;
+				memcpy(tvec.trace, &traces[offset], tvec.length * sizeof(ull));
+				offset += tvec.length;
+			}
+		}
+
+		*step = header[4];
+		RNG::GetInstance()->SeedThreadStream(header[5]);
+	}
+
+	Free(sums); Free(traces);
+
+	return success;
+
+  // Bouml preserved body end 000C3111
+}
+
+string CreateContextOperation::GetSamplerStateFileName(ull user) const 
+{
+  // Bouml preserved body begin 000C3191
+
+	stringstream fileName("");
+	fileName << checkpointPrefix << "-" << user << KC_SAMPLER_STATE_FILE_SUFFIX;
+
+	return fileName.str();
+
+  // Bouml preserved body end 000C3191
+}
+
 
 } // namespace lpm
@@ -56,6 +56,8 @@ Errors::Errors()
 	lastErrorFile = "";
 	lastErrorLine = 0;
 
+	pthread_mutex_init(&lock, NULL);
+
   // Bouml preserved body end 00099D11
 }
 
@@ -91,13 +93,19 @@ void Errors::SetErrorCode(ull errorCode, const char* file, int line, string deta
 {
   // Bouml preserved body begin 0002EB91
 
+	pthread_mutex_lock(&lock); // errors may be reported by worker threads
+
 	lastErrorCode = errorCode;
 	lastErrorFile = file;
 	lastErrorLine = line;
 	lastErrorDetails = details;
 
-	Log::GetInstance()->Append(GetLastErrorMessage(), Log::errorLevel);
-	Log::GetInstance()->RegisterError(GetLastErrorMessage());
+	string message = GetLastErrorMessage();
+
+	pthread_mutex_unlock(&lock);
+
+	Log::GetInstance()->Append(message, Log::errorLevel);
+	Log::GetInstance()->RegisterError(message);
 
   // Bouml preserved body end 0002EB91
 }
@@ -134,6 +142,8 @@ string Errors::GetLastErrorMessage() const
 		case ERROR_CODE_INVALID_TIME_PARTITIONING: message << "Invalid time partitioning"; break;
 		case ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE: message << "The trace or the intended usage is not consistent with the given time partitioning"; break;
 
+		case ERROR_CODE_STEADY_STATE_FAILURE: message << "The steady-state vector could not be computed (e.g. the method did not converge)"; break;
+
 		case ERROR_CODE_SIZE_T_OVERFLOW: message << "Overflow on size_t"; break;
 		case ERROR_CODE_MEMORY_ALLOCATION_FAILURE: message << "Failed to allocate memory"; break;
 
@@ -157,6 +157,65 @@ double DefaultApplicationOperation::PDF(const Context* context, const ActualEven
   // Bouml preserved body end 00042491
 }
 
+bool DefaultApplicationOperation::PDFVector(const Context* context, ull user, ull timestamp, const Event* outEvent, double* probabilities) const
+{
+  // Bouml preserved body begin 000C1091
+
+	if(outEvent != NULL || probabilities == NULL) { return false; }
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	if(appType == Basic)
+	{
+		for(ull locIdx = 0; locIdx < numLoc; locIdx++)
+		{
+			probabilities[GET_INDEX(locIdx, 0, 2)] = 1.0 - mu;
+			probabilities[GET_INDEX(locIdx, 1, 2)] = mu;
+		}
+	}
+	else if(appType == LocalSearch)
+	{
+		ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
+		if(tp == INVALID_TIME_PERIOD)
+		{
+			SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+			return false;
+		}
+
+		UserProfile* profile = NULL;
+		VERIFY(context->GetUserProfile(user, &profile) == true);
+		VERIFY(profile != NULL);
+
+		double* steadyStateVector = NULL;
+		VERIFY(profile->GetSteadyStateVector(&steadyStateVector) == true);
+
+		// get the proper sub-chain steady-state vector according to the time period of the events
+		double* subChainSteadyStateVector = NULL;
+		VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, &subChainSteadyStateVector) == true);
+
+		for(ull locIdx = 0; locIdx < numLoc; locIdx++)
+		{
+			double probExposure = mu * (1.0 - subChainSteadyStateVector[locIdx]);
+
+			probabilities[GET_INDEX(locIdx, 0, 2)] = 1.0 - probExposure;
+			probabilities[GET_INDEX(locIdx, 1, 2)] = probExposure;
+		}
+
+		Free(subChainSteadyStateVector); // free the sub-chain steady-state vector
+	}
+	else
+	{
+		CODING_ERROR;
+		return false;
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C1091
+}
+
 string DefaultApplicationOperation::GetDetailString() 
 {
   // Bouml preserved body begin 00095E91
@@ -362,6 +362,61 @@ double DefaultLPPMOperation::PDF(const Context* context, const ActualEvent* inEv
   // Bouml preserved body end 00042591
 }
 
+bool DefaultLPPMOperation::PDFVector(const Context* context, ull user, ull timestamp, const Event* outEvent, double* probabilities) const
+{
+  // Bouml preserved body begin 000C1011
+
+	if(context == NULL || outEvent == NULL || probabilities == NULL) { return false; }
+
+	const ObservedEvent* observedEvent = dynamic_cast<const ObservedEvent*>(outEvent);
+	VERIFY(observedEvent != NULL);
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	memset(probabilities, 0, 2 * numLoc * sizeof(double));
+
+	// the pdf of the actual events does not depend on their location
+	ActualEvent* actualEvent = new ActualEvent(user, timestamp, minLoc);
+	VERIFY(actualEvent != NULL);
+	double actualProb = PDF(context, actualEvent, observedEvent);
+	actualEvent->Release();
+
+	for(ull locIdx = 0; locIdx < numLoc; locIdx++) { probabilities[GET_INDEX(locIdx, 0, 2)] = actualProb; }
+
+	set<ull> timestamps = set<ull>();
+	observedEvent->GetTimestamps(timestamps);
+
+	if(timestamps.size() != 1 || timestamps.find(timestamp) == timestamps.end()) { return true; }
+
+	set<ull> locations = set<ull>();
+	observedEvent->GetLocationstamps(locations);
+
+	if(locations.empty() == true)
+	{
+		for(ull locIdx = 0; locIdx < numLoc; locIdx++) { probabilities[GET_INDEX(locIdx, 1, 2)] = hidingProbability; }
+		return true;
+	}
+
+	// an exposed event is consistent with the observed event iff its location is obfuscated into the observed locations,
+	// i.e. iff it belongs to the observed locations and these form an obfuscation set
+	set<ull> obfuscatedLocations = set<ull>();
+	ObfuscateLocation(*(locations.begin()), obfuscatedLocations);
+
+	if(obfuscatedLocations != locations) { return true; }
+
+	foreach_const(set<ull>, locations, iter)
+	{
+		ull loc = *iter;
+		probabilities[GET_INDEX((loc - minLoc), 1, 2)] = 1.0 - hidingProbability;
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C1011
+}
+
 string DefaultLPPMOperation::GetDetailString() 
 {
   // Bouml preserved body begin 00095E11
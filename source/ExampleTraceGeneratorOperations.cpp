@@ -166,10 +166,10 @@ bool KnowledgeSamplingTraceGeneratorOperation::GenerateUserTrace(const UserProfi
 				return false;
 			}
 
-			double* transitionVector = NULL;
-			VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, tp1, prevLoc, tp2, &transitionVector) == true);
+			const double* subChainTransitionMatrix = NULL;
+			VERIFY(profile->GetSubChainTransitionMatrix(tp1, tp2, &subChainTransitionMatrix) == true);
+			const double* transitionVector = &subChainTransitionMatrix[GET_INDEX((prevLoc - minLoc), 0, numLoc)];
 			nextLoc = minLoc + RNG::GetInstance()->SampleIndexFromVector(transitionVector, numLoc);
-			Free(transitionVector);
 		}
 
 		ActualEvent* actualEvent = new ActualEvent(user, tm, nextLoc);
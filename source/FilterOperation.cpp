@@ -47,9 +47,67 @@
 #include "../include/FilterOperation.h"
 #include "../include/Context.h"
 #include "../include/Event.h"
+#include "../include/ActualEvent.h"
+#include "../include/ExposedEvent.h"
+#include "../include/Parameters.h"
 
 namespace lpm {
 
+//! 
+//! \brief Computes the pdf of the filter operation for all the locations at once
+//!
+//! For every location \a loc, the pdf for the actual event (\a user, \a timestamp, \a loc) and for its exposed counterpart are stored
+//! in \a probabilities[GET_INDEX(loc - minLoc, 0, 2)] and \a probabilities[GET_INDEX(loc - minLoc, 1, 2)] respectively:
+//! - if \a outEvent is not \a NULL, these events are the input events and \a outEvent is the output event (e.g. for a LPPM),
+//! - if \a outEvent is \a NULL, the actual event is the input event and these events are the output events (e.g. for an application).
+//!
+//! \param[in] context 	Context*, the context.
+//! \param[in] user 	ull, the user of the input events.
+//! \param[in] timestamp 	ull, the timestamp of the input events.
+//! \param[in] outEvent	Event*, the filtered output event (or \a NULL).
+//! \param[out] probabilities 	double*, the output array (of size 2 x \a numLoc).
+//!
+//! \note The default implementation calls PDF() for every location, filter operations may override it with a faster implementation.
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool FilterFunction::PDFVector(const Context* context, ull user, ull timestamp, const Event* outEvent, double* probabilities) const
+{
+  // Bouml preserved body begin 000C0F91
+
+	if(probabilities == NULL) { return false; }
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+
+	for(ull loc = minLoc; loc <= maxLoc; loc++)
+	{
+		ActualEvent* actualEvent = new ActualEvent(user, timestamp, loc);
+		ExposedEvent* exposedEvent = new ExposedEvent(*actualEvent);
+
+		VERIFY(actualEvent != NULL && exposedEvent != NULL);
+
+		double* probs = &probabilities[GET_INDEX((loc - minLoc), 0, 2)];
+		if(outEvent != NULL)
+		{
+			probs[0] = PDF(context, actualEvent, outEvent);
+			probs[1] = PDF(context, exposedEvent, outEvent);
+		}
+		else
+		{
+			probs[0] = PDF(context, actualEvent, actualEvent);
+			probs[1] = PDF(context, actualEvent, exposedEvent);
+		}
+
+		actualEvent->Release();
+		exposedEvent->Release();
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C0F91
+}
+
 FilterOperation::FilterOperation(string name) : Operation<TraceSet, TraceSet>(name)
 {
   // Bouml preserved body begin 00021B91
@@ -603,10 +603,12 @@ void LPM::LogParameters() const
 //! \param[in] outputFile 	File*, the output file.
 //! \param[in] maxGSIterationsPerUser [optional] ull, the maximum number of Gibbs sampling iterations, for each user.
 //! \param[in] maxSecondsPerUser [optional] ull, the maximum number of seconds to spend in the Gibbs sampling procedure, for each user.
+//! \param[in] numThreads [optional] ull, the number of threads used to sample users concurrently (THREADS_ALL_PROCESSORS for one thread per processor).
+//! \param[in] checkpointPrefix [optional] string, the path prefix of the checkpoint files from which an interrupted construction is resumed (see CreateContextOperation::SetCheckpoint()).
 //!
 //! \return true or false, depending on whether the call is successful (i.e. whether the knowledge is constructed successfully)
 //!
-bool LPM::RunKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, File* outputFile, ull maxGSIterationsPerUser, ull maxSecondsPerUser) const 
+bool LPM::RunKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, File* outputFile, ull maxGSIterationsPerUser, ull maxSecondsPerUser, ull numThreads, string checkpointPrefix) const 
 {
   // Bouml preserved body begin 00067091
 
@@ -638,7 +640,8 @@ bool LPM::RunKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, File* o
 
 	Context* context = contextFactory->NewContext();
 
-	bool success = createContextOperation->SetLimits(maxGSIterationsPerUser, maxSecondsPerUser);
+	bool success = createContextOperation->SetLimits(maxGSIterationsPerUser, maxSecondsPerUser) && createContextOperation->SetNumThreads(numThreads) && 
+		createContextOperation->SetCheckpoint(checkpointPrefix);
 
 	if(success == true) { if(createContextOperation->Execute(knowledgeFiles, context) == false) { success = false; } }
 
@@ -655,6 +658,83 @@ bool LPM::RunKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, File* o
   // Bouml preserved body end 00067091
 }
 
+//! 
+//! \brief Updates previously constructed knowledge incrementally with new learning traces
+//!
+//! \param[in] knowledgeFiles 	KnowledgeInput*, the files to use for the update: the new learning traces, and the transitions count file persisted by the previous construction.
+//! \param[in] previousContextFile 	File*, the previously constructed knowledge (NULL to construct the knowledge from scratch).
+//! \param[in] outputFile 	File*, the output file.
+//! \param[in] transitionsCountOutputFile 	File*, the file to which the transitions counts are persisted for the next update (NULL to persist nothing).
+//! \param[in] maxGSIterationsPerUser [optional] ull, the maximum number of Gibbs sampling iterations, for each user.
+//! \param[in] maxSecondsPerUser [optional] ull, the maximum number of seconds to spend in the Gibbs sampling procedure, for each user.
+//! \param[in] numThreads [optional] ull, the number of threads used to sample users concurrently (THREADS_ALL_PROCESSORS for one thread per processor).
+//! \param[in] checkpointPrefix [optional] string, the path prefix of the checkpoint files from which an interrupted construction is resumed (see CreateContextOperation::SetCheckpoint()).
+//!
+//! \note Only the users whose new learning traces contain events are sampled (warm-started from their persisted counts), 
+//! the profiles of the other users are copied from the previous knowledge (see CreateContextOperation::SetPreviousContext()).
+//!
+//! \return true or false, depending on whether the call is successful (i.e. whether the knowledge is updated successfully)
+//!
+bool LPM::RunIncrementalKnowledgeConstruction(const KnowledgeInput* knowledgeFiles, const File* previousContextFile, File* outputFile, File* transitionsCountOutputFile, ull maxGSIterationsPerUser, ull maxSecondsPerUser, ull numThreads, string checkpointPrefix) const 
+{
+  // Bouml preserved body begin 000C2E11
+
+	if(knowledgeFiles == NULL || outputFile == NULL || outputFile->IsGood() == false || (previousContextFile != NULL && previousContextFile->IsGood() == false) || 
+		(transitionsCountOutputFile != NULL && transitionsCountOutputFile->IsGood() == false))
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
+
+	vector<File*> files = knowledgeFiles->learningTraceFilesVector;
+	foreach_const(vector<File*>, files, iter)
+	{
+		File* file = *iter;
+
+		if(file == NULL || file->IsGood() == false)
+		{
+			SET_ERROR_CODE_DETAILS(ERROR_CODE_INVALID_ARGUMENTS, "one of the provided learning file was not found");
+			return false;
+		}
+	}
+
+	Log::GetInstance()->Append("Entered LPM::RunIncrementalKnowledgeConstruction()!");
+
+	LoadContextOperation* loadContextOperation = new LoadContextOperation("LoadContextOperation");
+	CreateContextOperation* createContextOperation = new CreateContextOperation("CreateContextOperation");
+	StoreContextOperation* storeContextOperation = new StoreContextOperation("StoreContextOperation");
+
+	Context* previousContext = NULL;
+	Context* context = contextFactory->NewContext();
+
+	bool success = createContextOperation->SetLimits(maxGSIterationsPerUser, maxSecondsPerUser) && createContextOperation->SetNumThreads(numThreads) && 
+		createContextOperation->SetTransitionsCountOutput(transitionsCountOutputFile) && createContextOperation->SetCheckpoint(checkpointPrefix);
+
+	if(success == true && previousContextFile != NULL)
+	{
+		previousContext = contextFactory->NewContext();
+
+		if(loadContextOperation->Execute(previousContextFile, previousContext) == false) { success = false; }
+		else { createContextOperation->SetPreviousContext(previousContext); }
+	}
+
+	if(success == true) { if(createContextOperation->Execute(knowledgeFiles, context) == false) { success = false; } }
+
+	if(success == true) { if(storeContextOperation->Execute(context, outputFile) == false) { success = false; } }
+
+	context->Release();
+	if(previousContext != NULL) { previousContext->Release(); }
+	loadContextOperation->Release();
+	createContextOperation->Release();
+	storeContextOperation->Release();
+
+	Log::GetInstance()->Append((success == true) ? "Exited LPM::RunIncrementalKnowledgeConstruction() successfully!" : "LPM::RunIncrementalKnowledgeConstruction() failed!");
+
+	return success;
+
+  // Bouml preserved body end 000C2E11
+}
+
 bool LPM::RunContextAnalysisSchedule(ContextAnalysisSchedule* schedule, const File* contextFile, string outputFileName) const 
 {
   // Bouml preserved body begin 000BB611
@@ -52,7 +52,17 @@ Log::Log()
 {
   // Bouml preserved body begin 00058B91
 
+	pthread_mutex_init(&lock, NULL);
+	pthread_mutex_init(&fileLock, NULL);
+	pthread_cond_init(&writerCondition, NULL);
+
+	writerStarted = false;
+	stopWriter = false;
+	flushInterval = LOG_DEFAULT_FLUSH_INTERVAL;
+	pendingMessages = vector<pair<time_t, string> >();
+
 	enabled = false;
+	maxLevel = infoLevel;
 	SetOutputFileName("log");
 
   // Bouml preserved body end 00058B91
@@ -62,8 +72,14 @@ Log::~Log()
 {
   // Bouml preserved body begin 00058C11
 
+	StopWriter();
+
 	logFile.close();
 
+	pthread_cond_destroy(&writerCondition);
+	pthread_mutex_destroy(&fileLock);
+	pthread_mutex_destroy(&lock);
+
   // Bouml preserved body end 00058C11
 }
 
@@ -75,7 +91,7 @@ Log::~Log()
 //
 //! \param[in] message 	string to append to the log file.
 //! \param[in] level 	[optional] ushort specifying the seriousness of the message.
-//!	This can be one of Log::infoLevel (default), Log::warningLevel, or, Log::errorLevel.
+//!	This can be one of Log::infoLevel (default), Log::warningLevel, Log::errorLevel, or, Log::debugLevel.
 //
 //! \return nothing
 //!
@@ -83,24 +99,68 @@ void Log::Append(string message, ushort level)
 {
   // Bouml preserved body begin 0002B291
 
-	if(enabled == false) { return; }
+	if(IsEnabled(level) == false) { return; }
 
-	string timeString = "";
-	GetTimeString(timeString);
+	time_t t = time(NULL);
+
+	string levelMsg = ((level == warningLevel) ? "[Warning]: " : ((level == errorLevel) ? "[Error]: " : ((level == debugLevel) ? "[Debug]: " : "[Info]: ")));
+
+	pthread_mutex_lock(&lock);
+
+	if(flushInterval == 0) // synchronous
+	{
+		bool pending = (pendingMessages.empty() == false); // queued before the interval was set to 0 (see SetFlushInterval())
+
+		pthread_mutex_unlock(&lock);
+
+		if(pending == true) { Flush(); } // keep the order of the messages
+
+		string timeString = "";
+		GetTimeString(timeString, t);
+
+		pthread_mutex_lock(&fileLock);
 
-	string levelMsg = ((level == warningLevel) ? "[Warning]: " : ((level == errorLevel) ? "[Error]: " : "[Info]: "));
-	logFile << timeString << " - " << levelMsg << message << endl;
+		logFile << timeString << " - " << levelMsg << message << endl;
 
-	logFile.flush();
+		logFile.flush();
+
+		pthread_mutex_unlock(&fileLock);
+
+		return;
+	}
+
+	// the message is only queued, the time is formatted by the writer
+	if(writerStarted == false)
+	{
+		stopWriter = false;
+		writerStarted = (pthread_create(&writerThread, NULL, WriterThread, this) == 0);
+
+		static bool registered = false;
+		if(writerStarted == true && registered == false) { registered = (atexit(StopWriterAtExit) == 0); }
+	}
+
+	pendingMessages.push_back(pair<time_t, string>(t, levelMsg + message));
+
+	bool wakeWriter = (pendingMessages.size() >= LOG_MAX_PENDING_MESSAGES || writerStarted == false);
+
+	pthread_mutex_unlock(&lock);
+
+	if(wakeWriter == true)
+	{
+		if(writerStarted == true) { pthread_cond_signal(&writerCondition); }
+		else { Flush(); } // the writer thread could not be created
+	}
 
   // Bouml preserved body end 0002B291
 }
 
-const ushort Log::warningLevel = 0;
+const ushort Log::errorLevel;
+
+const ushort Log::warningLevel;
 
-const ushort Log::errorLevel = 1;
+const ushort Log::infoLevel;
 
-const ushort Log::infoLevel = 2;
+const ushort Log::debugLevel;
 
 //!
 //! \brief Sets the output file name
@@ -114,11 +174,18 @@ void Log::SetOutputFileName(string filename)
 
 	if(enabled == false) { return; }
 
+	// the pending messages go to the previous file
+	Flush();
+
+	pthread_mutex_lock(&fileLock);
+
 	if(logFile.is_open() == true) { logFile.close(); }
 
 	string filepath = filename + ".log";
 	logFile.open(filepath.c_str(), ofstream::out);
 
+	pthread_mutex_unlock(&fileLock);
+
   // Bouml preserved body end 0005D891
 }
 
@@ -139,6 +206,21 @@ void Log::SetEnabled(bool state)
   // Bouml preserved body end 0005F211
 }
 
+//!
+//! \brief Sets the highest level of the logged messages
+//
+//! \param[in] level 	ushort, the messages whose level is above \a level are dropped (the default is Log::infoLevel, Log::errorLevel only logs the errors, and Log::debugLevel logs everything).
+//!
+//! \return nothing
+void Log::SetLevel(ushort level) 
+{
+  // Bouml preserved body begin 000C2291
+
+	maxLevel = level;
+
+  // Bouml preserved body end 000C2291
+}
+
 //!
 //! \brief Registers an error
 //
@@ -149,18 +231,25 @@ void Log::RegisterError(string message)
 {
   // Bouml preserved body begin 00081C91
 
+	// the pending messages are written first
+	Flush();
+
+	string timeString = "";
+	GetTimeString(timeString, time(NULL));
+
+	pthread_mutex_lock(&lock);
+
 	if(errorLogFile.is_open() == false)
 	{
 		errorLogFile.open("error.log", ofstream::out);
 	}
 
-	string timeString = "";
-	GetTimeString(timeString);
-
 	errorLogFile << timeString << " - " << message << endl;
 
 	errorLogFile.flush();
 
+	pthread_mutex_unlock(&lock);
+
   // Bouml preserved body end 00081C91
 }
 
@@ -176,27 +265,169 @@ void Log::RegisterCrash(string message)
 {
   // Bouml preserved body begin 00081D11
 
+	// the pending messages are written first
+	Flush();
+
+	string timeString = "";
+	GetTimeString(timeString, time(NULL));
+
+	pthread_mutex_lock(&lock);
+
 	if(crashLogFile.is_open() == false)
 	{
 		crashLogFile.open("crash.log", ofstream::out);
 	}
 
-	string timeString = "";
-	GetTimeString(timeString);
-
 	crashLogFile << timeString << " - " << message << endl;
 
 	crashLogFile.flush();
 
+	pthread_mutex_unlock(&lock);
+
   // Bouml preserved body end 00081D11
 }
 
-bool Log::GetTimeString(string& timeString) const 
+//!
+//! \brief Writes the pending messages to the log file
+//!
+//! \return nothing
+void Log::Flush() 
+{
+  // Bouml preserved body begin 000C2311
+
+	pthread_mutex_lock(&fileLock);
+
+	vector<pair<time_t, string> > messages = vector<pair<time_t, string> >();
+
+	pthread_mutex_lock(&lock);
+	messages.swap(pendingMessages);
+	pthread_mutex_unlock(&lock);
+
+	// the time string is only formatted once per second
+	time_t lastTime = 0;
+	string timeString = "";
+
+	for(vector<pair<time_t, string> >::const_iterator iter = messages.begin(); iter != messages.end(); iter++)
+	{
+		if(iter == messages.begin() || iter->first != lastTime)
+		{
+			GetTimeString(timeString, iter->first);
+			lastTime = iter->first;
+		}
+
+		logFile << timeString << " - " << iter->second << "\n";
+	}
+
+	if(messages.empty() == false) { logFile.flush(); }
+
+	pthread_mutex_unlock(&fileLock);
+
+  // Bouml preserved body end 000C2311
+}
+
+//!
+//! \brief Sets the interval between two writes of the pending messages
+//!
+//! \param[in] milliseconds 	ull, the interval (the default is LOG_DEFAULT_FLUSH_INTERVAL). If 0, the messages are written (and flushed) synchronously by Append().
+//!
+//! \return nothing
+void Log::SetFlushInterval(ull milliseconds) 
+{
+  // Bouml preserved body begin 000C2391
+
+	// set the interval first, so that no message appended from now on can start the writer again
+	pthread_mutex_lock(&lock);
+	flushInterval = milliseconds;
+	pthread_mutex_unlock(&lock);
+
+	if(milliseconds == 0) { StopWriter(); } // (which writes the pending messages)
+
+	// the pending messages are written with the previous interval
+	Flush();
+
+  // Bouml preserved body end 000C2391
+}
+
+void* Log::WriterThread(void* arg) 
+{
+  // Bouml preserved body begin 000C2411
+
+	Log* log = (Log*)arg;
+
+	pthread_mutex_lock(&log->lock);
+
+	while(log->stopWriter == false)
+	{
+		// wait for the end of the interval (or to be woken up)
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+
+		ull nanoseconds = (ull)deadline.tv_nsec + (log->flushInterval % 1000) * 1000000;
+		deadline.tv_sec += (time_t)(log->flushInterval / 1000 + nanoseconds / 1000000000);
+		deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+
+		if(log->pendingMessages.size() < LOG_MAX_PENDING_MESSAGES) { pthread_cond_timedwait(&log->writerCondition, &log->lock, &deadline); }
+
+		pthread_mutex_unlock(&log->lock);
+
+		log->Flush();
+
+		pthread_mutex_lock(&log->lock);
+	}
+
+	pthread_mutex_unlock(&log->lock);
+
+	return NULL;
+
+  // Bouml preserved body end 000C2411
+}
+
+void Log::StopWriter() 
+{
+  // Bouml preserved body begin 000C2491
+
+	pthread_mutex_lock(&lock);
+
+	bool started = writerStarted;
+	if(started == true)
+	{
+		stopWriter = true;
+		pthread_cond_signal(&writerCondition);
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	if(started == true)
+	{
+		pthread_join(writerThread, NULL);
+
+		pthread_mutex_lock(&lock);
+		writerStarted = false;
+		stopWriter = false;
+		pthread_mutex_unlock(&lock);
+	}
+
+	Flush();
+
+  // Bouml preserved body end 000C2491
+}
+
+void Log::StopWriterAtExit() 
+{
+  // Bouml preserved body begin 000C2511
+
+	Log::GetInstance()->StopWriter();
+
+  // Bouml preserved body end 000C2511
+}
+
+bool Log::GetTimeString(string& timeString, time_t t) const 
 {
   // Bouml preserved body begin 00088911
 
-	time_t t = time(NULL);
-	struct tm* tm = localtime(&t);
+	struct tm tmBuffer;
+	struct tm* tm = localtime_r(&t, &tmBuffer);
+	if(tm == NULL) { return false; }
 
 #define MAX_TIME_STRING_LENGTH 1024
 	char tmp[MAX_TIME_STRING_LENGTH + 1];
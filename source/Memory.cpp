@@ -48,6 +48,17 @@
 
 namespace lpm {
 
+// counting mode: header stored in front of each chunk (16 bytes, so that the alignment of the chunk is preserved)
+struct ChunkHeader 
+{
+    ull tag; // (MEMORY_CHUNK_MAGIC << 32) | call site index
+
+    ull bytes;
+
+};
+
+#define MEMORY_CHUNK_MAGIC 0x4C504D43ULL
+
 Memory::Memory() 
 {
   // Bouml preserved body begin 00090F11
@@ -55,6 +66,36 @@ Memory::Memory()
 	references = map<void*, ull>();
 	chunks = map<void*, string>();
 
+	pthread_mutex_init(&lock, NULL);
+
+	started = false;
+	liveReferences = 0;
+
+	// not allocated with Allocate(), obviously; the first entry accounts for the call sites which do not fit in the table
+	callSites = (CallSite*)calloc(MEMORY_MAX_CALL_SITES, sizeof(CallSite));
+	VERIFY(callSites != NULL);
+	callSites[0].file = "<other call sites>";
+	callSites[0].line = 0;
+	callSites[0].state = 2;
+
+#if MEMORY_TRACKING == 0
+	mode = MemoryTrackingOff;
+#elif MEMORY_TRACKING == 1
+	mode = MemoryTrackingCounting;
+#else
+	mode = MemoryTrackingFull;
+#endif
+
+	// the compiled-in mode can be overridden at run time (unless the Allocate and Free macros bypass this class)
+	const char* env = getenv("LPM_MEMORY_TRACKING");
+	if(MEMORY_TRACKING != 0 && env != NULL)
+	{
+		string value = string(env);
+		if(value.compare("off") == 0) { mode = MemoryTrackingOff; }
+		else if(value.compare("counting") == 0) { mode = MemoryTrackingCounting; }
+		else if(value.compare("full") == 0) { mode = MemoryTrackingFull; }
+	}
+
   // Bouml preserved body end 00090F11
 }
 
@@ -67,33 +108,98 @@ Memory::~Memory()
 	references.clear();
 	chunks.clear();
 
+	pthread_mutex_destroy(&lock);
+
+	free(callSites);
+
   // Bouml preserved body end 00090F91
 }
 
-void* Memory::AllocateChunk(ull bytes, const char* file, int line) 
+// returns the index of the entry of the given call site in the call site table (claiming a free entry if needed), without locking
+ull Memory::GetCallSite(const char* file, int line) 
 {
-  // Bouml preserved body begin 00091011
+  // Bouml preserved body begin 000C1411
 
-	stringstream ss("");
-	ss << (size_t)bytes << " bytes allocated in "<< file << ":" << line;
+	ull numEntries = MEMORY_MAX_CALL_SITES - 1; // the entry 0 is reserved
+	ull hash = ((ull)(size_t)file >> 3) * 0x9E3779B97F4A7C15ULL ^ (ull)line * 0xC2B2AE3D27D4EB4FULL;
 
-	string details = ss.str();
+	for(ull probe = 0; probe < numEntries; probe++)
+	{
+		ull idx = 1 + (hash + probe) % numEntries;
+		CallSite* site = &callSites[idx];
+
+		if(site->state == 0 && __sync_bool_compare_and_swap(&site->state, 0, 1) == true) // claim the entry
+		{
+			site->file = file;
+			site->line = line;
+			__sync_synchronize();
+			site->state = 2;
+			return idx;
+		}
+
+		while(site->state != 2) { __sync_synchronize(); } // being claimed by another thread
+
+		if(site->file == file && site->line == line) { return idx; }
+	}
+
+	return 0; // table full
+
+  // Bouml preserved body end 000C1411
+}
+
+void* Memory::AllocateChunk(ull bytes, const char* file, int line) 
+{
+  // Bouml preserved body begin 00091011
 
 	if(((size_t)bytes) != bytes) // overflow on size_t
 	{
 		SET_ERROR_CODE(ERROR_CODE_SIZE_T_OVERFLOW);
 	}
 
-	void* ret = malloc(bytes);
+	if(started == false) { started = true; }
 
-	if(ret == NULL)
+	void* ret = NULL;
+
+	if(mode == MemoryTrackingOff)
 	{
-		SET_ERROR_CODE(ERROR_CODE_MEMORY_ALLOCATION_FAILURE);
+		ret = malloc(bytes);
+	}
+	else if(mode == MemoryTrackingCounting)
+	{
+		ChunkHeader* header = (ChunkHeader*)malloc(sizeof(ChunkHeader) + bytes);
+		if(header != NULL)
+		{
+			ull site = GetCallSite(file, line);
+			header->tag = (MEMORY_CHUNK_MAGIC << 32) | site;
+			header->bytes = bytes;
+
+			__sync_fetch_and_add(&callSites[site].liveChunks, 1);
+			__sync_fetch_and_add(&callSites[site].liveBytes, bytes);
+
+			ret = (void*)(header + 1);
+		}
 	}
 	else
 	{
-		// register the allocation
-		chunks.insert(pair<void*, string>(ret, details));
+		stringstream ss("");
+		ss << (size_t)bytes << " bytes allocated in "<< file << ":" << line;
+
+		string details = ss.str();
+
+		ret = malloc(bytes);
+
+		if(ret != NULL)
+		{
+			// register the allocation
+			pthread_mutex_lock(&lock);
+			chunks.insert(pair<void*, string>(ret, details));
+			pthread_mutex_unlock(&lock);
+		}
+	}
+
+	if(ret == NULL)
+	{
+		SET_ERROR_CODE(ERROR_CODE_MEMORY_ALLOCATION_FAILURE);
 	}
 
 	return ret;
@@ -105,9 +211,34 @@ void Memory::FreeChunk(void* chunk)
 {
   // Bouml preserved body begin 00091111
 
+	if(mode == MemoryTrackingOff)
+	{
+		free(chunk);
+		return;
+	}
+
+	if(mode == MemoryTrackingCounting)
+	{
+		if(chunk == NULL) { return; }
+
+		ChunkHeader* header = ((ChunkHeader*)chunk) - 1;
+		VERIFY((header->tag >> 32) == MEMORY_CHUNK_MAGIC); // allocated by AllocateChunk() in the counting mode, and not already freed
+
+		ull site = header->tag & 0xFFFFFFFFULL;
+		__sync_fetch_and_sub(&callSites[site].liveChunks, 1);
+		__sync_fetch_and_sub(&callSites[site].liveBytes, header->bytes);
+
+		header->tag = 0;
+		free(header);
+		return;
+	}
+
 	stringstream ss("");
 	ull pointer = (ull)chunk;
 
+	pthread_mutex_lock(&lock);
+
+	bool found = false;
 	map<void*, string>::iterator iter = chunks.find(chunk);
 	if(iter != chunks.end()) // found entry
 	{
@@ -117,8 +248,12 @@ void Memory::FreeChunk(void* chunk)
 		Log::GetInstance()->Append(ss.str()); */
 
 		chunks.erase(iter);
+		found = true;
 	}
-	else // not found
+
+	pthread_mutex_unlock(&lock);
+
+	if(found == false) // not found
 	{
 		ss << "Attempting to Free possibly unallocated memory at 0x" << hex << pointer << "!";
 		Log::GetInstance()->Append(ss.str(), Log::warningLevel);
@@ -129,12 +264,38 @@ void Memory::FreeChunk(void* chunk)
   // Bouml preserved body end 00091111
 }
 
+void Memory::RegisterReference(void* object) 
+{
+  // Bouml preserved body begin 000C1491
+
+	if(started == false) { started = true; }
+
+	if(mode == MemoryTrackingCounting) { __sync_fetch_and_add(&liveReferences, 1); }
+	else if(mode == MemoryTrackingFull) { UpdateReference(object, 1); }
+
+  // Bouml preserved body end 000C1491
+}
+
+void Memory::UnregisterReference(void* object) 
+{
+  // Bouml preserved body begin 000C1511
+
+	if(mode == MemoryTrackingCounting) { __sync_fetch_and_sub(&liveReferences, 1); }
+	else if(mode == MemoryTrackingFull) { UpdateReference(object, 0); }
+
+  // Bouml preserved body end 000C1511
+}
+
 void Memory::UpdateReference(void* object, ull newCount) 
 {
   // Bouml preserved body begin 00091091
 
+	if(mode != MemoryTrackingFull) { return; } // only the full mode keeps the reference counts
+
 	//ull pointer = (ull)object;
 
+	pthread_mutex_lock(&lock);
+
 	map<void*, ull>::iterator iter = references.find(object);
 	if(iter != references.end()) // found entry
 	{
@@ -164,6 +325,8 @@ void Memory::UpdateReference(void* object, ull newCount)
 		VERIFY(newCount == 1);
 	}
 
+	pthread_mutex_unlock(&lock);
+
   // Bouml preserved body end 00091091
 }
 
@@ -173,8 +336,28 @@ void Memory::Report()
 
 	stringstream ss("");
 
-	ull refs = references.size();
-	ull chunksCount = chunks.size();
+	if(mode == MemoryTrackingOff)
+	{
+		ss << "Memory tracking is off: memory leaks cannot be reported!";
+		Log::GetInstance()->Append(ss.str());
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+
+	ull refs = 0;
+	ull chunksCount = 0;
+
+	if(mode == MemoryTrackingCounting)
+	{
+		refs = liveReferences;
+		for(ull idx = 0; idx < MEMORY_MAX_CALL_SITES; idx++) { chunksCount += callSites[idx].liveChunks; }
+	}
+	else
+	{
+		refs = references.size();
+		chunksCount = chunks.size();
+	}
 
 	if(refs == 0 && chunksCount == 0)
 	{
@@ -186,6 +369,19 @@ void Memory::Report()
 		ss << "Memory leaks found: " << refs << " references, " << chunksCount << " chunks not Freed!";
 		Log::GetInstance()->Append(ss.str(), Log::warningLevel);
 
+		if(mode == MemoryTrackingCounting) // only the call sites are known
+		{
+			for(ull idx = 0; idx < MEMORY_MAX_CALL_SITES; idx++)
+			{
+				const CallSite* site = &callSites[idx];
+				if(site->state != 2 || site->liveChunks == 0) { continue; }
+
+				ss.str("");
+				ss << site->liveChunks << " chunks were not released (" << site->liveBytes << " bytes allocated in " << site->file << ":" << site->line << ")!";
+				Log::GetInstance()->Append(ss.str(), Log::warningLevel);
+			}
+		}
+
 		pair_foreach_const(map<void*, ull>, references, iter)
 		{
 			ull pointer = (ull)iter->first;
@@ -207,8 +403,47 @@ void Memory::Report()
 		}
 	}
 
+	pthread_mutex_unlock(&lock);
+
   // Bouml preserved body end 00092A91
 }
 
+//! 
+//! \brief Sets the tracking mode
+//!
+//! \param[in] newMode 	MemoryTrackingMode, the new mode.
+//!
+//! \note The mode can only be changed before the first chunk is allocated (chunks must be freed in the mode they were allocated in).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool Memory::SetTrackingMode(MemoryTrackingMode newMode) 
+{
+  // Bouml preserved body begin 000C1591
+
+	if(newMode == mode) { return true; }
+
+	if(MEMORY_TRACKING == 0 || started == true) // the Allocate and Free macros bypass this class, or chunks/references are already tracked
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_OPERATION);
+		return false;
+	}
+
+	mode = newMode;
+
+	return true;
+
+  // Bouml preserved body end 000C1591
+}
+
+MemoryTrackingMode Memory::GetTrackingMode() const 
+{
+  // Bouml preserved body begin 000C1611
+
+	return mode;
+
+  // Bouml preserved body end 000C1611
+}
+
 
 } // namespace lpm
@@ -356,9 +356,7 @@ bool MostLikelyLocationDistortionMetricOperation::Execute(const AttackOutput* in
 					mostLikelyLocProb = prob;
 				}
 
-				stringstream info2("");
-				info2 << "       sum " << userIndex << " " << tm << " " << loc << " | " << sum;
-				Log::GetInstance()->Append(info2.str());
+				LOG_MESSAGE(Log::debugLevel, "       sum " << userIndex << " " << tm << " " << loc << " | " << sum);
 
 			}
 
@@ -50,6 +50,19 @@
 
 namespace lpm {
 
+// per-thread stream state (see RNG::SeedThreadStream())
+static __thread uint64 threadStreamState = 0;
+static __thread bool threadStreamSeeded = false;
+
+// splitmix64 step: advances the state and returns the next 64 bits of the stream
+static inline uint64 NextStreamUINT64(uint64* state)
+{
+	uint64 z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
 RNG::RNG() 
 {
   // Bouml preserved body begin 00039691
@@ -79,6 +92,17 @@ double RNG::GetUniformRandomDouble() const
 
 	double r = 0.0;
 
+	if(threadStreamSeeded == true)
+	{
+		do
+		{
+			r = (double)(NextStreamUINT64(&threadStreamState) >> 11) * (1.0 / 9007199254740992.0); // 53 bits: r \in [0, 1[
+		}
+		while(r <= 0.0);
+
+		return r;
+	}
+
 	do
 	{
 		r = (double)rand() * (double)(1.0 / (double)(RAND_MAX));
@@ -164,7 +188,7 @@ bool RNG::RandomPermutation(const ull* input, const ull count, ull* output) cons
 //!
 //! \return ull, the sampled index
 //!
-ull RNG::SampleIndexFromVector(double* probVector, ull length) const 
+ull RNG::SampleIndexFromVector(const double* probVector, ull length) const 
 {
   // Bouml preserved body begin 0007FE91
 
@@ -393,5 +417,88 @@ void RNG::GetDirichletExpectedValue(double* alpha, ull K, double* theta) const
   // Bouml preserved body end 000BE991
 }
 
+//! 
+//! \brief Returns a random seed (drawn from the current generator)
+//!
+//! \return ull, the seed
+//!
+ull RNG::GenerateSeed() const 
+{
+  // Bouml preserved body begin 000C0211
+
+	return GetUniformRandomULL();
+
+  // Bouml preserved body end 000C0211
+}
+
+//! 
+//! \brief Binds a random stream seeded with \a seed to the calling thread
+//!
+//! Until \a ReleaseThreadStream() is called, all numbers generated by the calling thread are drawn from this stream.
+//!
+//! \param[in] seed 	ull, the seed of the stream.
+//!
+//! \return nothing
+//!
+void RNG::SeedThreadStream(ull seed) const 
+{
+  // Bouml preserved body begin 000C0291
+
+	threadStreamState = seed;
+	threadStreamSeeded = true;
+
+  // Bouml preserved body end 000C0291
+}
+
+//! 
+//! \brief Releases the stream bound to the calling thread (if any)
+//!
+//! \return nothing
+//!
+void RNG::ReleaseThreadStream() const 
+{
+  // Bouml preserved body begin 000C0C91
+
+	threadStreamState = 0;
+	threadStreamSeeded = false;
+
+  // Bouml preserved body end 000C0C91
+}
+
+//! 
+//! \brief Returns the state of the stream bound to the calling thread
+//!
+//! \note Binding a stream seeded with this state (see \a SeedThreadStream()) resumes the stream exactly where it was, e.g. from a checkpoint.
+//!
+//! \return ull, the state of the stream (0 if no stream is bound to the calling thread)
+//!
+ull RNG::GetThreadStreamState() const 
+{
+  // Bouml preserved body begin 000C2E91
+
+	return (threadStreamSeeded == true) ? threadStreamState : 0;
+
+  // Bouml preserved body end 000C2E91
+}
+
+//! 
+//! \brief Derives the seed of a sub-stream from a base seed and a key (e.g. a user id)
+//!
+//! \param[in] seed 	ull, the base seed.
+//! \param[in] key 	ull, the key identifying the sub-stream.
+//!
+//! \return ull, the derived seed
+//!
+ull RNG::DeriveSeed(ull seed, ull key) 
+{
+  // Bouml preserved body begin 000C0D11
+
+	uint64 state = seed ^ NextStreamUINT64(&key);
+
+	return NextStreamUINT64(&state);
+
+  // Bouml preserved body end 000C0D11
+}
+
 
 } // namespace lpm
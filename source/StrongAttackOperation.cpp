@@ -51,15 +51,217 @@
 
 namespace lpm {
 
+// computes alpha of a batch of (user, pseudonym) pairs sharing the same user (task index: index of the batch, whose pairs are given by their index in pairs)
+class AlphaTask : public ParallelTask 
+{
+  public:
+    AlphaTask(const StrongAttackOperation* operation, const vector<const UserProfile*>& profiles, const vector<const Trace*>& traces, const vector<pair<ull, ull> >& pairs, const vector<vector<ull> >& batches, const EmissionTable* emissions, double* alpha, double* logLikelihoods, bool* zeroLikelihoods, double* scratch, ull scratchSize);
+
+    virtual bool Run(ull taskIdx, ull workerIdx);
+
+
+  private:
+    const StrongAttackOperation* operation;
+
+    const vector<const UserProfile*>& profiles;
+
+    const vector<const Trace*>& traces;
+
+    const vector<pair<ull, ull> >& pairs;
+
+    const vector<vector<ull> >& batches;
+
+    const EmissionTable* emissions;
+
+    double* alpha;
+
+    double* logLikelihoods;
+
+    bool* zeroLikelihoods;
+
+    double* scratch;
+
+    ull scratchSize;
+
+};
+
+AlphaTask::AlphaTask(const StrongAttackOperation* operation, const vector<const UserProfile*>& profiles, const vector<const Trace*>& traces, const vector<pair<ull, ull> >& pairs, const vector<vector<ull> >& batches, const EmissionTable* emissions, double* alpha, double* logLikelihoods, bool* zeroLikelihoods, double* scratch, ull scratchSize) : profiles(profiles), traces(traces), pairs(pairs), batches(batches)
+{
+	this->operation = operation;
+	this->emissions = emissions;
+	this->alpha = alpha;
+	this->logLikelihoods = logLikelihoods;
+	this->zeroLikelihoods = zeroLikelihoods;
+	this->scratch = scratch;
+	this->scratchSize = scratchSize;
+}
+
+bool AlphaTask::Run(ull taskIdx, ull workerIdx)
+{
+	const vector<ull>& batch = batches[taskIdx];
+	ull userIndex = pairs[batch[0]].first;
+
+	// each worker has its own scratch buffer
+	return operation->ComputeAlphaOfUser(profiles[userIndex], traces, pairs, batch, emissions, alpha, logLikelihoods, zeroLikelihoods, &scratch[workerIdx * scratchSize]);
+}
+
+// computes beta for a list of (user, pseudonym) pairs (task index: index of the pair, whose beta is stored at taskIdx * numTimes * numLoc)
+class BetaTask : public ParallelTask 
+{
+  public:
+    BetaTask(const StrongAttackOperation* operation, const vector<const UserProfile*>& profiles, const vector<const Trace*>& traces, const vector<pair<ull, ull> >& pairs, const EmissionTable* emissions, double* beta, double* scratch);
+
+    virtual bool Run(ull taskIdx, ull workerIdx);
+
+
+  private:
+    const StrongAttackOperation* operation;
+
+    const vector<const UserProfile*>& profiles;
+
+    const vector<const Trace*>& traces;
+
+    const vector<pair<ull, ull> >& pairs;
+
+    const EmissionTable* emissions;
+
+    double* beta;
+
+    double* scratch;
+
+};
+
+BetaTask::BetaTask(const StrongAttackOperation* operation, const vector<const UserProfile*>& profiles, const vector<const Trace*>& traces, const vector<pair<ull, ull> >& pairs, const EmissionTable* emissions, double* beta, double* scratch) : profiles(profiles), traces(traces), pairs(pairs)
+{
+	this->operation = operation;
+	this->emissions = emissions;
+	this->beta = beta;
+	this->scratch = scratch;
+}
+
+bool BetaTask::Run(ull taskIdx, ull workerIdx)
+{
+	ull userIndex = pairs[taskIdx].first;
+	ull pseudonymIndex = pairs[taskIdx].second;
+
+	ull pairSize = emissions->numTimes * emissions->numLoc;
+
+	// each worker has its own (numLoc) scratch buffer
+	double* workerScratch = &scratch[workerIdx * emissions->numLoc];
+
+	return operation->ComputeBetaOfPair(profiles[userIndex], traces[pseudonymIndex], userIndex, pseudonymIndex, emissions, &beta[taskIdx * pairSize], workerScratch);
+}
+
+// computes the most likely trace (Viterbi) of one user (task index: userIndex)
+class MostLikelyTraceTask : public ParallelTask 
+{
+  public:
+    MostLikelyTraceTask(const StrongAttackOperation* operation, const vector<const UserProfile*>& profiles, const vector<const Trace*>& traces, const vector<ull>& pseudonymIndices, const EmissionTable* emissions, ull* mostLikelyTrace, double* scratch, ull scratchSize, unsigned char* predecessors, ull predecessorsByteSize);
+
+    virtual bool Run(ull taskIdx, ull workerIdx);
+
+
+  private:
+    const StrongAttackOperation* operation;
+
+    const vector<const UserProfile*>& profiles;
+
+    const vector<const Trace*>& traces;
+
+    const vector<ull>& pseudonymIndices;
+
+    const EmissionTable* emissions;
+
+    ull* mostLikelyTrace;
+
+    double* scratch;
+
+    ull scratchSize;
+
+    unsigned char* predecessors;
+
+    ull predecessorsByteSize;
+
+};
+
+MostLikelyTraceTask::MostLikelyTraceTask(const StrongAttackOperation* operation, const vector<const UserProfile*>& profiles, const vector<const Trace*>& traces, const vector<ull>& pseudonymIndices, const EmissionTable* emissions, ull* mostLikelyTrace, double* scratch, ull scratchSize, unsigned char* predecessors, ull predecessorsByteSize) : profiles(profiles), traces(traces), pseudonymIndices(pseudonymIndices)
+{
+	this->operation = operation;
+	this->emissions = emissions;
+	this->mostLikelyTrace = mostLikelyTrace;
+	this->scratch = scratch;
+	this->scratchSize = scratchSize;
+	this->predecessors = predecessors;
+	this->predecessorsByteSize = predecessorsByteSize;
+}
+
+bool MostLikelyTraceTask::Run(ull taskIdx, ull workerIdx)
+{
+	// each worker has its own scratch and predecessor buffers, the predecessors being stored as 16-bit location indices whenever possible
+	double* workerScratch = &scratch[workerIdx * scratchSize];
+	unsigned char* workerPredecessors = &predecessors[workerIdx * predecessorsByteSize];
+
+	if(emissions->numLoc <= VITERBI_SHORT_PREDECESSOR_MAX_LOC)
+	{
+		return operation->ComputeMostLikelyTraceOfUser(profiles[taskIdx], traces[taskIdx], taskIdx, pseudonymIndices[taskIdx], emissions, (ushort*)workerPredecessors, mostLikelyTrace, workerScratch);
+	}
+
+	return operation->ComputeMostLikelyTraceOfUser(profiles[taskIdx], traces[taskIdx], taskIdx, pseudonymIndices[taskIdx], emissions, (uint32*)workerPredecessors, mostLikelyTrace, workerScratch);
+}
+
+// advances the online alpha slices of the pairs of one user by the last added timestamp (task index: userIndex)
+class OnlineAlphaTask : public ParallelTask 
+{
+  public:
+    OnlineAlphaTask(StrongAttackOperation* operation, double* scratch, ull scratchSize);
+
+    virtual bool Run(ull taskIdx, ull workerIdx);
+
+
+  private:
+    StrongAttackOperation* operation;
+
+    double* scratch;
+
+    ull scratchSize;
+
+};
+
+OnlineAlphaTask::OnlineAlphaTask(StrongAttackOperation* operation, double* scratch, ull scratchSize)
+{
+	this->operation = operation;
+	this->scratch = scratch;
+	this->scratchSize = scratchSize;
+}
+
+bool OnlineAlphaTask::Run(ull taskIdx, ull workerIdx)
+{
+	// each worker has its own scratch buffer
+	return operation->AdvanceOnlineAlphaOfUser(taskIdx, &scratch[workerIdx * scratchSize]);
+}
+
 StrongAttackOperation::StrongAttackOperation() : AttackOperation("StrongAttackOperation")
 {
   // Bouml preserved body begin 0004CD91
+
+	streaming = false;
+	numAlternatives = 0;
+	numCandidates = 0;
+
+	onlineNumTimes = 0;
+	onlineAlpha = NULL;
+	onlineLogLikelihoods = NULL;
+	memset(&onlineEmissions, 0, sizeof(onlineEmissions));
+
   // Bouml preserved body end 0004CD91
 }
 
 StrongAttackOperation::~StrongAttackOperation() 
 {
   // Bouml preserved body begin 0004CE11
+
+	FreeOnlineAttack();
+
   // Bouml preserved body end 0004CE11
 }
 
@@ -105,20 +307,13 @@ bool StrongAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 {
   // Bouml preserved body begin 0004CF91
 
-/**/
-	const double bigNumber = 1e20;
-	const double bigNumberInverse = 1.0 / bigNumber;
-/**/
-
 	if(input == NULL || output == NULL || context == NULL)
 	{
 		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
 		return false;
 	}
 
-	stringstream info("");
-	info << "Starting the strong attack!";
-	Log::GetInstance()->Append(info.str());
+	LOG_MESSAGE(Log::infoLevel, "Starting the strong attack!");
 
 	// get time parameters
 	ull minTime = 0; ull maxTime = 0;
@@ -137,147 +332,132 @@ bool StrongAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 	ull Nusers = profiles.size();
 
 	// normalization variable
-	double* lrnrm = NULL;
 
 	double* alpha = NULL;
 	double* beta = NULL;
 
-	info.str("");
-	info << "Computing alpha and beta!";
-	Log::GetInstance()->Append(info.str());
-
-	//compute alpha and beta matrices for all users, pseudonyms, times, and locations
-	VERIFY(ComputeAlphaBeta(input, &alpha, &beta, &lrnrm) == true);
-	VERIFY(alpha != NULL && beta != NULL && lrnrm != NULL);
+	// emission probabilities of the observed events
+	EmissionTable emissions;
+	VERIFY(ComputeEmissionTable(input, &emissions) == true);
 
 	// de-anonymization
 	ull byteSize = (Nusers * Nusers) * sizeof(double);
 	double* likelihoodMatrix = (double*)Allocate(byteSize);
 	VERIFY(likelihoodMatrix != NULL);
 
-	for (ull userIndex = 0; userIndex < Nusers; userIndex++)
-	{
-		for (ull nymIndex = 0; nymIndex < Nusers; nymIndex++)
-		{
-			double sum = 0.0;
-			for (ull loc = minLoc; loc <= maxLoc; loc++)
-			{
-				ull index = GET_INDEX_4D(userIndex, nymIndex, (maxTime - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-				sum += alpha[index];
-			}
+	// whether the observed trace of each pair is impossible for its user (such pairs are never alternatives)
+	ull zeroLikelihoodsByteSize = (Nusers * Nusers) * sizeof(bool);
+	bool* zeroLikelihoods = (bool*)Allocate(zeroLikelihoodsByteSize);
+	VERIFY(zeroLikelihoods != NULL);
+	memset(zeroLikelihoods, 0, zeroLikelihoodsByteSize);
 
-			/*
-			stringstream info("");
-			info << "likelihood: " << (double)sum << "   " << DBL_MIN;
-			Log::GetInstance()->Append(info.str());
-			*/
+	// alpha of all the pairs is only kept in the non-streaming mode without pruning
+	bool keepAlpha = (streaming == false && numCandidates == 0);
 
-			if(sum <= 0.0)
-			{
-				sum = DBL_MIN;
+	// number of candidate pseudonyms per user (all of them without pruning)
+	ull numCandidatesPerUser = Nusers;
 
-/**/
-				lrnrm[GET_INDEX(userIndex, nymIndex, Nusers)] = 0;
-/**/
-			}
-			else
-			{
-				// re-normalization
-/**/
-				while (sum < bigNumberInverse)
-				{
-					sum *= bigNumber;
-					lrnrm[GET_INDEX(userIndex, nymIndex, Nusers)]++;
-				}
-/**/
-			}
+	// allocate mapping
+	ull byteSizeVector = Nusers * sizeof(ll);
 
-/**/
-			likelihoodMatrix[GET_INDEX(userIndex, nymIndex, Nusers)] = log(sum) + lrnrm[GET_INDEX(userIndex, nymIndex, Nusers)] * log(bigNumberInverse);
-/**/
-//			likelihoodMatrix[GET_INDEX(userIndex, nymIndex, Nusers)] = log(sum);
-		}
-	}
+	ll* mapping = (ll*)Allocate(byteSizeVector);
+	VERIFY(mapping != NULL);
+	memset(mapping, 0, byteSizeVector);
 
-/**/
-	Free(lrnrm);
-/**/
+	if(numCandidates != 0)
+	{
+		LOG_MESSAGE(Log::infoLevel, "Computing the likelihoods of the candidate pairs (pruning)!");
 
-	// log the likelihood matrix
-	Log::GetInstance()->Append("Likelihood Matrix (strong adv):");
-	for(ull i = 0; i < Nusers; i++)
+		// the assignment is computed among the candidate pairs, the likelihood of the pruned pairs being -DBL_MAX
+		VERIFY(ComputePrunedAssignment(input, &emissions, likelihoodMatrix, zeroLikelihoods, mapping, &numCandidatesPerUser) == true);
+	}
+	else if(streaming == true)
 	{
-		stringstream info("");
+		LOG_MESSAGE(Log::infoLevel, "Computing the likelihoods (streaming)!");
+
+		// only two time slices of alpha are kept for each pair
+		VERIFY(ComputeLikelihood(input, &emissions, likelihoodMatrix, zeroLikelihoods) == true);
+	}
+	else
+	{
+		LOG_MESSAGE(Log::infoLevel, "Computing alpha!");
 
-		for(ull j = 0; j < Nusers; j++)
+		//compute alpha matrices for all users, pseudonyms, times, and locations (beta is only computed for the pairs selected by the assignment)
+		vector<pair<ull, ull> > allPairs = vector<pair<ull, ull> >();
+		for(ull userIndex = 0; userIndex < Nusers; userIndex++)
 		{
-			info << " " << likelihoodMatrix[GET_INDEX(i, j, Nusers)];
+			for(ull nymIndex = 0; nymIndex < Nusers; nymIndex++) { allPairs.push_back(pair<ull, ull>(userIndex, nymIndex)); }
 		}
 
-		Log::GetInstance()->Append(info.str());
+		// the pairs are in the order of the likelihood matrix
+		VERIFY(ComputeAlphaBeta(input, &emissions, allPairs, &alpha, NULL, likelihoodMatrix, zeroLikelihoods) == true);
+		VERIFY(alpha != NULL);
 	}
 
-	// allocate weight and mapping
-	ull byteSizeMatrix = (Nusers * Nusers) * sizeof(ll);
-	ull byteSizeVector = Nusers * sizeof(ll);
-
-	ll* weight = (ll*)Allocate(byteSizeMatrix);
-	ll* mapping = (ll*)Allocate(byteSizeVector);
-	VERIFY(weight != NULL && mapping != NULL);
-	memset(weight, 0, byteSizeMatrix);
-	memset(mapping, 0, byteSizeVector);
-
-	// convert likelihood matrix to weight matrix
-	double maxnll = 0.0;
-	for(ull i = 0; i < Nusers; i++)
+	// log the likelihood matrix (debug only)
+	if(LOG_ENABLED(Log::debugLevel))
 	{
-		for(ull j = 0; j < Nusers; j++)
+		Log::GetInstance()->Append("Likelihood Matrix (strong adv):", Log::debugLevel);
+		for(ull i = 0; i < Nusers; i++)
 		{
-			ull index = GET_INDEX(i, j, Nusers);
+			stringstream info("");
 
-			double nll = -likelihoodMatrix[index];
-			if(nll > maxnll) { maxnll = nll; }
-		}
-	}
+			for(ull j = 0; j < Nusers; j++)
+			{
+				info << " " << likelihoodMatrix[GET_INDEX(i, j, Nusers)];
+			}
 
-	ll llhoodBigNumber = (maxnll == 0.0) ? -1 : (ll)(-(double)LONG_LONG_MAX/maxnll + 10000);
-	for(ull i = 0; i < Nusers; i++)
-	{
-		for(ull j = 0; j < Nusers; j++)
-		{
-			ull index = GET_INDEX(i, j, Nusers);
-			double llhood = likelihoodMatrix[index];
-			if(llhood > 0) { weight[index] = 0; }
-			else { weight[index] = (ll)(llhoodBigNumber * llhood); }
+			Log::GetInstance()->Append(info.str(), Log::debugLevel);
 		}
 	}
 
-	Free(likelihoodMatrix); likelihoodMatrix = NULL;
+	// convert likelihood matrix to cost matrix (in place): the mapping which maximizes the likelihood is the minimum cost assignment
+	double* costMatrix = likelihoodMatrix;
+	for(ull index = 0; index < Nusers * Nusers; index++) { costMatrix[index] = -likelihoodMatrix[index]; }
 
-	// log the weight matrix
-	Log::GetInstance()->Append("Weight Matrix (strong adv):");
-	for(ull i = 0; i < Nusers; i++)
+	//de-anonymization (already done among the candidate pairs with pruning)
+	if(numCandidates == 0) { VERIFY(Algorithms::MinimumCostAssignment(costMatrix, Nusers, mapping) == true); }
+
+	// select the pairs whose posterior is computed: the assigned pair of each user, followed by its most likely alternative pseudonyms (among its candidates)
+	// the pairs whose observed trace is impossible (and the pruned pairs) are not alternatives, so a user may have fewer alternatives than the others
+	ull maxAlternativesPerUser = MIN(numAlternatives, numCandidatesPerUser - 1);
+	ull numAlternativesPerUser = 0; // the largest number of alternatives of a user
+	vector<ull> assignedPairIndices = vector<ull>(Nusers, 0); // index of the assigned pair of each user in the selected pairs, its alternatives following it
+	vector<ull> numAlternativesOfUser = vector<ull>(Nusers, 0);
+	vector<pair<ull, ull> > selectedPairs = vector<pair<ull, ull> >();
+	for(ull userIndex = 0; userIndex < Nusers; userIndex++)
 	{
-		stringstream info(""); info.precision(16);
+		assignedPairIndices[userIndex] = selectedPairs.size();
+		selectedPairs.push_back(pair<ull, ull>(userIndex, mapping[userIndex]));
 
-		for(ull j = 0; j < Nusers; j++)
+		if(maxAlternativesPerUser == 0) { continue; }
+
+		vector<pair<double, ull> > candidates = vector<pair<double, ull> >(); // (cost, pseudonym index)
+		for(ull nymIndex = 0; nymIndex < Nusers; nymIndex++)
 		{
-			info << " " << weight[GET_INDEX(i, j, Nusers)];
+			ull index = GET_INDEX(userIndex, nymIndex, Nusers);
+			if(nymIndex != (ull)mapping[userIndex] && zeroLikelihoods[index] == false) { candidates.push_back(pair<double, ull>(costMatrix[index], nymIndex)); }
 		}
 
-		Log::GetInstance()->Append(info.str());
+		ull numUserAlternatives = MIN(maxAlternativesPerUser, candidates.size());
+		partial_sort(candidates.begin(), candidates.begin() + numUserAlternatives, candidates.end());
+		for(ull k = 0; k < numUserAlternatives; k++) { selectedPairs.push_back(pair<ull, ull>(userIndex, candidates[k].second)); }
+
+		numAlternativesOfUser[userIndex] = numUserAlternatives;
+		numAlternativesPerUser = MAX(numAlternativesPerUser, numUserAlternatives);
 	}
 
-	//de-anonymization
-	// prev code: VERIFY(Algorithms::MaximumWeightAssignment(Nusers, weight, mapping) == 0); // this method was called maximum weight assignment but it was computing minimum cost assignement!
+	Free(likelihoodMatrix); likelihoodMatrix = costMatrix = NULL;
+	Free(zeroLikelihoods);
 
-	ll* costMatrix = weight;
-	Algorithms::MinimumCostAssignment(costMatrix, Nusers, mapping); // Note: the weight matrix is indeed a cost matrix, the mapping which maximizes the likelihood is the minimum cost assignment!
 
-	Free(weight); weight = costMatrix = NULL;
+	map<ull, ull> userToPseudonymMapping = map<ull, ull>();
 
+	// pseudonym of each pseudonym index
+	ull* pseudonyms = (ull*)Allocate(byteSizeVector);
+	VERIFY(pseudonyms != NULL);
+	memset(pseudonyms, 0, byteSizeVector);
 
-	map<ull, ull> userToPseudonymMapping = map<ull, ull>();
 	// get mapping (pseudonym -> observed trace): just for logging
 	{
 		map<ull, Trace*> traceMapping = map<ull, Trace*>();
@@ -285,10 +465,6 @@ bool StrongAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 
 		VERIFY(Nusers == traceMapping.size());
 
-		ull* pseudonyms = (ull*)Allocate(byteSizeVector);
-		VERIFY(pseudonyms != NULL);
-		memset(pseudonyms, 0, byteSizeVector);
-
 		ull* users = (ull*)Allocate(byteSizeVector);
 		VERIFY(users != NULL);
 		memset(users, 0, byteSizeVector);
@@ -316,14 +492,11 @@ bool StrongAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 
 		pair_foreach_const(map<ull, ull>, userToPseudonymMapping, iter)
 		{
-			stringstream info("");
-			info << "Assignment: user -> pseudonym " << iter->first << " " << iter->second;
-			Log::GetInstance()->Append(info.str());
+			LOG_MESSAGE(Log::infoLevel, "Assignment: user -> pseudonym " << iter->first << " " << iter->second);
 		}
 
 		output->SetAnonymizationMap(userToPseudonymMapping); // set the mapping
 
-		Free(pseudonyms);
 		Free(users);
 	}
 
@@ -333,62 +506,88 @@ bool StrongAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 	memset(mostLikelyTrace, 0, mostLikelyTraceByteSize);
 
 	// tracking
-	VERIFY(ComputeMostLikelyTrace(input, userToPseudonymMapping, mostLikelyTrace) == true);
+	VERIFY(ComputeMostLikelyTrace(input, &emissions, userToPseudonymMapping, mostLikelyTrace) == true);
 	userToPseudonymMapping.clear();
 
 	output->SetMostLikelyTrace(mostLikelyTrace);
 
+	// compute beta (and alpha, unless it has been kept) for the selected pairs only
+	ull numSelectedPairs = selectedPairs.size();
+	vector<ull> alphaIndices = vector<ull>(numSelectedPairs, 0); // index of the alpha of each selected pair
+
+	LOG_MESSAGE(Log::infoLevel, "Computing beta of the " << numSelectedPairs << " selected pairs!");
+
+	if(keepAlpha == false)
+	{
+		VERIFY(ComputeAlphaBeta(input, &emissions, selectedPairs, &alpha, &beta, NULL, NULL) == true);
+		VERIFY(alpha != NULL && beta != NULL);
+
+		for(ull pairIndex = 0; pairIndex < numSelectedPairs; pairIndex++) { alphaIndices[pairIndex] = pairIndex; }
+	}
+	else
+	{
+		VERIFY(ComputeAlphaBeta(input, &emissions, selectedPairs, NULL, &beta, NULL, NULL) == true);
+		VERIFY(beta != NULL);
+
+		for(ull pairIndex = 0; pairIndex < numSelectedPairs; pairIndex++) { alphaIndices[pairIndex] = GET_INDEX(selectedPairs[pairIndex].first, selectedPairs[pairIndex].second, Nusers); }
+	}
+
+	FreeEmissionTable(&emissions);
+
 	// de-obfuscation
+	ull pairSize = numTimes * numLoc;
 
-	ull outputByteSize = Nusers * numTimes * numLoc * sizeof(double);
+	ull outputByteSize = Nusers * pairSize * sizeof(double);
 	double* locationDistribution = (double*)Allocate(outputByteSize);
 	VERIFY(locationDistribution != NULL);
 	memset(locationDistribution, 0, outputByteSize);
 
-
 	// for each user
 	for(ull userIndex = 0; userIndex < Nusers; userIndex++)
 	{
-		for (ull tm = minTime; tm <= maxTime; tm++)
-		{
-			double sum = 0.0;
-
-			for (ull loc = minLoc; loc <= maxLoc; loc++)
-			{
-				ull index = GET_INDEX_4D(userIndex, mapping[userIndex], (tm - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-
-				double product = 0.0;
-				product = alpha[index] * beta[index];
-
-
-				stringstream info("");
-				info << "alpha beta " << userIndex << " " << tm << " " << loc << " | " << alpha[index] << " * " << beta[index] << " = " << product;
-				Log::GetInstance()->Append(info.str());
+		ull pairIndex = assignedPairIndices[userIndex];
 
+		ComputeLocationDistribution(&alpha[alphaIndices[pairIndex] * pairSize], &beta[pairIndex * pairSize], userIndex, true, &locationDistribution[userIndex * pairSize]);
+	}
 
-				ull index2 = GET_INDEX_3D(userIndex, (tm - minTime), (loc - minLoc), numTimes, numLoc);
+	// posteriors of the alternative pseudonyms
+	if(numAlternativesPerUser > 0)
+	{
+		ull alternativesByteSize = Nusers * numAlternativesPerUser * sizeof(ull);
+		ull* alternativePseudonyms = (ull*)Allocate(alternativesByteSize);
+		VERIFY(alternativePseudonyms != NULL);
+		memset(alternativePseudonyms, 0, alternativesByteSize);
 
-				locationDistribution[index2] = product;
+		ull alternativeDistributionsByteSize = Nusers * numAlternativesPerUser * pairSize * sizeof(double);
+		double* alternativeDistributions = (double*)Allocate(alternativeDistributionsByteSize);
+		VERIFY(alternativeDistributions != NULL);
+		memset(alternativeDistributions, 0, alternativeDistributionsByteSize);
 
-				sum += product;
+		for(ull userIndex = 0; userIndex < Nusers; userIndex++)
+		{
+			for(ull k = 0; k < numAlternativesPerUser; k++)
+			{
+				ull alternativeIndex = GET_INDEX(userIndex, k, numAlternativesPerUser);
 
-				stringstream info2("");
-				info2 << "       sum " << userIndex << " " << tm << " " << loc << " | " << sum;
-				Log::GetInstance()->Append(info2.str());
+				// the missing alternatives of the user keep a zero distribution
+				if(k >= numAlternativesOfUser[userIndex])
+				{
+					alternativePseudonyms[alternativeIndex] = NO_ALTERNATIVE_PSEUDONYM;
+					continue;
+				}
 
-			}
+				ull pairIndex = assignedPairIndices[userIndex] + 1 + k;
 
-			for (ull loc = minLoc; loc <= maxLoc; loc++)
-			{
-				ull index2 = GET_INDEX_3D(userIndex, (tm - minTime), (loc - minLoc), numTimes, numLoc);
+				alternativePseudonyms[alternativeIndex] = pseudonyms[selectedPairs[pairIndex].second];
 
-				double tmp = locationDistribution[index2];
-				VERIFY(sum != 0.0 && (tmp/sum) != nan("n-char-sequence"));
-				locationDistribution[index2] /= (double)sum;
+				ComputeLocationDistribution(&alpha[alphaIndices[pairIndex] * pairSize], &beta[pairIndex * pairSize], userIndex, false, &alternativeDistributions[alternativeIndex * pairSize]);
 			}
 		}
+
+		output->SetAlternatives(numAlternativesPerUser, alternativePseudonyms, alternativeDistributions);
 	}
 
+	Free(pseudonyms);
 	Free(mapping);
 	Free(alpha);
 	Free(beta);
@@ -400,16 +599,102 @@ bool StrongAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
   // Bouml preserved body end 0004CF91
 }
 
-bool StrongAttackOperation::ComputeAlphaBeta(const TraceSet* traces, double** alpha, double** beta, double** lrnrm) const 
+//! 
+//! \brief Enables/Disables the streaming mode
+//!
+//! In the streaming mode, the likelihood of each (user, pseudonym) pair is computed by a forward pass which only keeps two time slices of alpha, 
+//! and alpha and beta are then only computed for the pairs of the resulting assignment (see also SetNumAlternatives()). The memory needed is then O(\a Nusers^2 + \a Nusers * \a numTimes * \a numLoc) 
+//! instead of O(\a Nusers^2 * \a numTimes * \a numLoc). The results are the same in both modes.
+//!
+//! \param[in] streaming 	bool, whether to enable the streaming mode (the default is false).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool StrongAttackOperation::SetStreaming(bool streaming) 
 {
-  // Bouml preserved body begin 0001F582
+  // Bouml preserved body begin 000C1891
+
+	this->streaming = streaming;
+
+	return true;
+
+  // Bouml preserved body end 000C1891
+}
+
+//! 
+//! \brief Sets the number of alternative pseudonyms whose posterior is computed for each user
+//!
+//! The backward pass is only run for the pair (user, assigned pseudonym) of each user, and for the \a numAlternatives other pseudonyms 
+//! of highest likelihood for this user. The location distributions of these alternative pairs are stored in the output (see AttackOutput::GetAlternatives()) 
+//! and can be used to assess the uncertainty of the assignment. The number of alternatives is capped at (\a Nusers - 1).
+//!
+//! \param[in] numAlternatives 	ull, the number of alternative pseudonyms per user (the default is 0, i.e. only the assigned pairs).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool StrongAttackOperation::SetNumAlternatives(ull numAlternatives) 
+{
+  // Bouml preserved body begin 000C1911
+
+	this->numAlternatives = numAlternatives;
+
+	return true;
+
+  // Bouml preserved body end 000C1911
+}
+
+//! 
+//! \brief Enables/Disables the pruning of the (user, pseudonym) pairs
+//!
+//! With pruning, all the pairs are first scored by their likelihood under the steady-state vectors of the users (i.e. the likelihood of the weak adversary), 
+//! and the forward pass is only run for the \a numCandidates best pseudonyms of each user (and the \a numCandidates best users of each pseudonym). 
+//! The assignment is then restricted to these candidate pairs, the pruned pairs having an infinite cost. If there is no complete assignment among the candidates, 
+//! \a numCandidates is doubled until there is one. The pruning ratio is reported in the log.
+//!
+//! \param[in] numCandidates 	ull, the number of candidates per user (the default is 0, i.e. no pruning).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool StrongAttackOperation::SetNumCandidates(ull numCandidates) 
+{
+  // Bouml preserved body begin 000C1B91
+
+	this->numCandidates = numCandidates;
+
+	return true;
+
+  // Bouml preserved body end 000C1B91
+}
+
+//! 
+//! \brief Starts an online attack on the observed traces of the given pseudonyms
+//!
+//! In the online mode, the observed events are added one timestamp at a time (see AddObservedEvents()), starting at the first timestamp. 
+//! The filtered alpha slice (i.e. the distribution of the location of the user given the observed events so far) and the log-likelihood of each 
+//! (user, pseudonym) pair are kept and advanced by each new timestamp, in O(\a numLoc^2) per pair, and the assignment and the location 
+//! distributions at the last timestamp can be obtained at any time (see GetOnlineOutput()). Any previous online attack is discarded.
+//!
+//! \param[in] pseudonyms 	set<ull>, the pseudonyms of the observed traces (there must be as many as profiles in the context).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool StrongAttackOperation::StartOnlineAttack(const set<ull>& pseudonyms) 
+{
+  // Bouml preserved body begin 000C2011
+
+	FreeOnlineAttack();
 
-/**/
-	const double bigNumber = 1e20;
-	const double bigNumberInverse = 1.0 / bigNumber;
-/**/
+	if(context == NULL || applicationPDF == NULL || lppmPDF == NULL)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_OPERATION);
+		return false;
+	}
+
+	map<ull, UserProfile*> profiles = map<ull, UserProfile*>();
+	VERIFY(context->GetProfiles(profiles) == true);
 
-	if(traces == NULL || alpha == NULL || beta == NULL)
+	ull Nusers = profiles.size();
+	if(Nusers == 0 || pseudonyms.size() != Nusers)
 	{
 		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
 		return false;
@@ -417,326 +702,940 @@ bool StrongAttackOperation::ComputeAlphaBeta(const TraceSet* traces, double** al
 
 	ull minTime = 0; ull maxTime = 0;
 	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
-	ull numTimes = maxTime - minTime + 1;
 
 	ull minLoc = 0; ull maxLoc = 0;
 	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
 	ull numLoc = maxLoc - minLoc + 1;
 
-	// get the user profiles
-	map<ull, UserProfile*> profiles = map<ull, UserProfile*>();
-	VERIFY(context->GetProfiles(profiles) == true);
-
-	ull Nusers = profiles.size();
+	pair_foreach_const(map<ull, UserProfile*>, profiles, iter) { onlineProfiles.push_back(iter->second); }
+	foreach_const(set<ull>, pseudonyms, iter) { onlinePseudonyms.push_back(*iter); }
 
-	//allocate memory for Alpha and Beta
-	ull byteSizeAB = (Nusers * Nusers * numTimes * numLoc) * sizeof(double);
+	ull alphaByteSize = Nusers * Nusers * numLoc * sizeof(double);
+	onlineAlpha = (double*)Allocate(alphaByteSize);
+	VERIFY(onlineAlpha != NULL);
+	memset(onlineAlpha, 0, alphaByteSize);
 
-	double* myalpha = *alpha = (double*)Allocate(byteSizeAB);
-	VERIFY(myalpha != NULL);
-	memset(myalpha, 0, byteSizeAB);
+	ull likelihoodByteSize = Nusers * Nusers * sizeof(double);
+	onlineLogLikelihoods = (double*)Allocate(likelihoodByteSize);
+	VERIFY(onlineLogLikelihoods != NULL);
+	memset(onlineLogLikelihoods, 0, likelihoodByteSize);
 
-	double* mybeta = *beta = (double*)Allocate(byteSizeAB);
-	VERIFY(mybeta != NULL);
-	memset(mybeta, 0, byteSizeAB);
+	// the emission probabilities of a single timestamp
+	onlineEmissions.numUsers = Nusers;
+	onlineEmissions.numPseudonyms = Nusers;
+	onlineEmissions.numTimes = 1;
+	onlineEmissions.numLoc = numLoc;
 
-	// normalization variables
-/**/
-	ull byteSizeNorm = Nusers * Nusers * numTimes * sizeof(double);
+	ull emissionsByteSize = Nusers * numLoc * 2 * sizeof(double);
+	onlineEmissions.lppmProbabilities = (double*)Allocate(emissionsByteSize);
+	VERIFY(onlineEmissions.lppmProbabilities != NULL);
+	memset(onlineEmissions.lppmProbabilities, 0, emissionsByteSize);
 
-	double* arnrm = (double*)Allocate(byteSizeNorm);
-	VERIFY(arnrm != NULL);
-	memset(arnrm, 0, byteSizeNorm);
+	onlineEmissions.applicationProbabilities = (double*)Allocate(emissionsByteSize);
+	VERIFY(onlineEmissions.applicationProbabilities != NULL);
+	memset(onlineEmissions.applicationProbabilities, 0, emissionsByteSize);
 
-	double* mylrnrm = *lrnrm = (double*)Allocate(Nusers * Nusers * sizeof(double));
-	VERIFY(mylrnrm != NULL);
-	memset(mylrnrm, 0, Nusers * Nusers * sizeof(double));
-/**/
+	onlineNumTimes = 0;
 
-	// get the mapping (pseudonym -> observed trace)
-	map<ull, Trace*> mappingNymObserved = map<ull, Trace*>();
-	traces->GetMapping(mappingNymObserved);
+	LOG_MESSAGE(Log::infoLevel, "Starting the online strong attack!");
 
-	VERIFY(Nusers == mappingNymObserved.size());
+	return true;
 
-	// for all users
-	ull userIndex = 0;
-	pair_foreach_const(map<ull, UserProfile*>, profiles, usersIter)
-	{
-		ull user = usersIter->first;
-		UserProfile* profile = usersIter->second;
+  // Bouml preserved body end 000C2011
+}
 
-		double* transitionMatrix = NULL;
-		profile->GetTransitionMatrix(&transitionMatrix);
+//! 
+//! \brief Adds the observed events of the next timestamp to the online attack
+//!
+//! \param[in] events 	vector<ObservedEvent*>, the observed event of each pseudonym at the timestamp following the last added one.
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool StrongAttackOperation::AddObservedEvents(const vector<ObservedEvent*>& events) 
+{
+  // Bouml preserved body begin 000C2091
 
-		double* steadyStateVector = NULL;
-		profile->GetSteadyStateVector(&steadyStateVector);
+	if(onlineAlpha == NULL)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_METHOD_CALL);
+		return false;
+	}
 
-		VERIFY(transitionMatrix != NULL && steadyStateVector != NULL);
+	ull Nusers = onlineProfiles.size();
 
-		// for all observed traces
-		ull pseudonymIndex = 0;
-		pair_foreach_const(map<ull, Trace*>, mappingNymObserved, pseudonymsIter)
-		{
-			//ull pseudonym = pseudonymsIter->first;
-			Trace* observedTrace = pseudonymsIter->second;
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+	ull numTimes = maxTime - minTime + 1;
 
-			vector<Event*> events = vector<Event*>();
-			observedTrace->GetEvents(events);
+	ull numLoc = onlineEmissions.numLoc;
 
-			VERIFY(numTimes == events.size());
+	if(onlineNumTimes == numTimes || events.size() != Nusers)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
 
-			// compute alpha
-/*
-*/
-			// for all time instants
-			ull tm = minTime;
-			foreach_const(vector<Event*>, events, eventsIter)
-			{
-				double asum = 0.0;
+	ull timestamp = minTime + onlineNumTimes;
 
-				ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
-				set<ull> timestamps = set<ull>();
-				observedEvent->GetTimestamps(timestamps);
+	// LPPM probabilities: once per observed event (each pseudonym must have exactly one event, at the next timestamp)
+	vector<bool> seen = vector<bool>(Nusers, false);
+	foreach_const(vector<ObservedEvent*>, events, iter)
+	{
+		const ObservedEvent* observedEvent = *iter;
+		VERIFY(observedEvent != NULL);
 
-				VERIFY(timestamps.size() == 1);
+		set<ull> timestamps = set<ull>();
+		observedEvent->GetTimestamps(timestamps);
 
-				ull timestamp = *(timestamps.begin());
+		ull pseudonym = observedEvent->GetPseudonym();
+		vector<ull>::const_iterator nymIter = lower_bound(onlinePseudonyms.begin(), onlinePseudonyms.end(), pseudonym);
 
-				VERIFY(tm == timestamp && (timestamp >= minTime && timestamp <= maxTime));
+		if(timestamps.size() != 1 || *(timestamps.begin()) != timestamp || nymIter == onlinePseudonyms.end() || *nymIter != pseudonym)
+		{
+			SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+			return false;
+		}
 
-				ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
-				ull prevtp = tp; // ensure prevtp is always consistent with its usage
-				if(timestamp > minTime) { prevtp = Parameters::GetInstance()->LookupTimePeriod(timestamp - 1); }
-				if(prevtp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD)
-				{
-					SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-					return false;
-				}
+		ull pseudonymIndex = nymIter - onlinePseudonyms.begin();
+		if(seen[pseudonymIndex] == true)
+		{
+			SET_ERROR_CODE(ERROR_CODE_DUPLICATE_ENTRIES);
+			return false;
+		}
+		seen[pseudonymIndex] = true;
 
-				// get the proper sub-chain steady-state vector according to the time period of the event
-				double* subChainSteadyStateVector = NULL;
-				VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, &subChainSteadyStateVector) == true);
+		double* lppm = &onlineEmissions.lppmProbabilities[pseudonymIndex * 2 * numLoc];
+		VERIFY(lppmPDF->PDFVector(context, pseudonym, timestamp, observedEvent, lppm) == true);
+	}
 
+	// application probabilities: once per user
+	for(ull userIndex = 0; userIndex < Nusers; userIndex++)
+	{
+		double* app = &onlineEmissions.applicationProbabilities[userIndex * 2 * numLoc];
+		VERIFY(applicationPDF->PDFVector(context, onlineProfiles[userIndex]->GetUser(), timestamp, NULL, app) == true);
+	}
 
-				for(ull loc = minLoc; loc <= maxLoc; loc++)
-				{
-					ActualEvent* actualEvent = new ActualEvent(user, timestamp, loc);
-					ExposedEvent* exposedEvent = new ExposedEvent(*actualEvent);
+	// the pairs of each user are advanced together, each worker uses its own scratch buffer
+	ull numWorkers = ThreadPool::GetNumWorkers(numThreads, Nusers);
 
-					VERIFY(actualEvent != NULL && exposedEvent != NULL);
+	ull scratchSize = (Nusers + 1) * numLoc;
+	ull scratchByteSize = numWorkers * scratchSize * sizeof(double);
+	double* scratch = (double*)Allocate(scratchByteSize);
+	VERIFY(scratch != NULL);
+	memset(scratch, 0, scratchByteSize);
 
-					double lppmProb0 = lppmPDF->PDF(context, actualEvent, observedEvent);
-					double applicationProb0 = applicationPDF->PDF(context, actualEvent, actualEvent);
+	OnlineAlphaTask task = OnlineAlphaTask(this, scratch, scratchSize);
+	bool success = ThreadPool::Execute(&task, Nusers, numThreads);
 
-					double lppmProb1 = lppmPDF->PDF(context, exposedEvent, observedEvent);
-					double applicationProb1 = applicationPDF->PDF(context, actualEvent, exposedEvent);
+	Free(scratch);
 
-					actualEvent->Release();
-					exposedEvent->Release();
+	if(success == true) { onlineNumTimes++; }
 
-					double presenceProb = subChainSteadyStateVector[loc - minLoc];
+	return success;
 
-					// compute alpha_1
-					if (timestamp == minTime)
-					{
-						double prob = 0.0;
-						prob = (double)presenceProb * ((lppmProb0 * applicationProb0 ) + (lppmProb1 * applicationProb1));
+  // Bouml preserved body end 000C2091
+}
 
-						ull index = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-						myalpha[index] = prob;
-					}
-					else // compute alpha_t
-					{
-						double sum = 0.0;
-						for(ull prevloc = minLoc; prevloc <= maxLoc; prevloc++)
-						{
-							ull index = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime - 1), (prevloc - minLoc), Nusers, numTimes, numLoc);
-							double previousAlpha = myalpha[index];
+//! 
+//! \brief Returns the current output of the online attack
+//!
+//! The assignment maximizes the likelihood of the observed events added so far, exactly as Execute() would on the observed traces truncated at the 
+//! last timestamp. The location distribution of each user is its filtered distribution at the last timestamp under its assigned pseudonym.
+//!
+//! \param[out] userToPseudonymMap 	map<ull, ull>, the assignment (user -> pseudonym).
+//! \param[out] locationDistribution 	double**, the output (Nusers x numLoc) matrix, users being in increasing order (allocated here, but freed by the caller).
+//!
+//! \return true or false, depending on whether the call is successful
+//!
+bool StrongAttackOperation::GetOnlineOutput(map<ull, ull>& userToPseudonymMap, double** locationDistribution) const 
+{
+  // Bouml preserved body begin 000C2111
+
+	if(onlineAlpha == NULL || onlineNumTimes == 0)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_METHOD_CALL);
+		return false;
+	}
+
+	if(locationDistribution == NULL)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
 
-							// get the proper sub-chain transition vector to the time period of the previous event (we're computing alpha, remember?)
-							double* subChainTransitionVector = NULL;
-							VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, prevtp, prevloc, tp, &subChainTransitionVector) == true);
+	ull Nusers = onlineProfiles.size();
+	ull numLoc = onlineEmissions.numLoc;
 
-							ull index2 = (loc - minLoc);
-							double transitionProb = subChainTransitionVector[index2];
+	// the mapping which maximizes the likelihood is the minimum cost assignment (the likelihood of an impossible pair being DBL_MIN)
+	ull costByteSize = Nusers * Nusers * sizeof(double);
+	double* costMatrix = (double*)Allocate(costByteSize);
+	VERIFY(costMatrix != NULL);
 
-							Free(subChainTransitionVector);  // free the sub-chain transition vector
+	for(ull index = 0; index < Nusers * Nusers; index++)
+	{
+		const double* pairAlpha = &onlineAlpha[index * numLoc];
 
-							sum += previousAlpha * transitionProb;
-						}
+		double asum = 0.0;
+		for(ull locIndex = 0; locIndex < numLoc; locIndex++) { asum += pairAlpha[locIndex]; }
 
-						double prob = 0.0;
-						prob = (double)sum * ((lppmProb0 * applicationProb0 ) + (lppmProb1 * applicationProb1));
+		costMatrix[index] = (asum > 0.0) ? -onlineLogLikelihoods[index] : -log(DBL_MIN);
+	}
 
-						ull index = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-						myalpha[index] = prob;
+	ull mappingByteSize = Nusers * sizeof(ll);
+	ll* mapping = (ll*)Allocate(mappingByteSize);
+	VERIFY(mapping != NULL);
+	memset(mapping, 0, mappingByteSize);
 
-						asum += prob;
+	VERIFY(Algorithms::MinimumCostAssignment(costMatrix, Nusers, mapping) == true);
+	Free(costMatrix);
 
-						// take care of small alpha
-						//VERIFY(prob == 0.0 || prob > bigNumberInverse);
-					}
-				}
+	ull distributionByteSize = Nusers * numLoc * sizeof(double);
+	double* distribution = *locationDistribution = (double*)Allocate(distributionByteSize);
+	VERIFY(distribution != NULL);
+
+	userToPseudonymMap.clear();
+	for(ull userIndex = 0; userIndex < Nusers; userIndex++)
+	{
+		userToPseudonymMap.insert(pair<ull, ull>(onlineProfiles[userIndex]->GetUser(), onlinePseudonyms[mapping[userIndex]]));
+
+		// the filtered alpha slice is already normalized
+		memcpy(&distribution[userIndex * numLoc], &onlineAlpha[GET_INDEX_3D(userIndex, mapping[userIndex], 0, Nusers, numLoc)], numLoc * sizeof(double));
+	}
+
+	Free(mapping);
 
-				Free(subChainSteadyStateVector); // free the sub-chain steady-state vector
+	return true;
+
+  // Bouml preserved body end 000C2111
+}
+
+bool StrongAttackOperation::ComputePrunedAssignment(const TraceSet* traces, const EmissionTable* emissions, double* likelihood, bool* zeroLikelihoods, ll* assignment, ull* numCandidatesPerUser) const 
+{
+  // Bouml preserved body begin 000C1C11
+
+	if(traces == NULL || emissions == NULL || likelihood == NULL || zeroLikelihoods == NULL || assignment == NULL || numCandidatesPerUser == NULL || numCandidates == 0)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
+
+	ull Nusers = emissions->numUsers;
+	VERIFY(Nusers == emissions->numPseudonyms);
+
+	// pre-filter: the likelihood of the weak adversary
+	double* scores = NULL;
+	VERIFY(ComputeSteadyStateLikelihood(traces, emissions, &scores) == true);
+	VERIFY(scores != NULL);
+
+	// pseudonyms of each user, and users of each pseudonym, by decreasing score (ties broken by index)
+	vector<vector<ull> > nymsOfUser = vector<vector<ull> >(Nusers);
+	vector<vector<ull> > usersOfNym = vector<vector<ull> >(Nusers);
+	for(ull index = 0; index < Nusers; index++)
+	{
+		vector<pair<double, ull> > rowScores = vector<pair<double, ull> >();
+		vector<pair<double, ull> > columnScores = vector<pair<double, ull> >();
+		for(ull other = 0; other < Nusers; other++)
+		{
+			rowScores.push_back(pair<double, ull>(-scores[GET_INDEX(index, other, Nusers)], other));
+			columnScores.push_back(pair<double, ull>(-scores[GET_INDEX(other, index, Nusers)], other));
+		}
+
+		sort(rowScores.begin(), rowScores.end());
+		sort(columnScores.begin(), columnScores.end());
+
+		for(ull rank = 0; rank < Nusers; rank++)
+		{
+			nymsOfUser[index].push_back(rowScores[rank].second);
+			usersOfNym[index].push_back(columnScores[rank].second);
+		}
+	}
 
-				// Re-normalize the alpha's s necessary to avoid underflow, keeping track of how many re-normalizations for each alpha
-/**/
-				if (timestamp == minTime)
+	for(ull index = 0; index < Nusers * Nusers; index++) { likelihood[index] = -DBL_MAX; zeroLikelihoods[index] = true; }
+
+	vector<bool> isCandidate = vector<bool>(Nusers * Nusers, false);
+	ull numCandidatePairs = 0;
+
+	ull k = MIN(numCandidates, Nusers);
+	while(true)
+	{
+		// the new candidate pairs: the k best pseudonyms of each user and the k best users of each pseudonym
+		vector<pair<ull, ull> > newPairs = vector<pair<ull, ull> >();
+		for(ull index = 0; index < Nusers; index++)
+		{
+			for(ull rank = 0; rank < k; rank++)
+			{
+				ull pairIndices[2] = { GET_INDEX(index, nymsOfUser[index][rank], Nusers), GET_INDEX(usersOfNym[index][rank], index, Nusers) };
+				for(ull i = 0; i < 2; i++)
 				{
-					arnrm[GET_INDEX_3D(userIndex, pseudonymIndex, 0, Nusers, numTimes)] = 0;
+					if(isCandidate[pairIndices[i]] == true) { continue; }
+
+					isCandidate[pairIndices[i]] = true;
+					newPairs.push_back(pair<ull, ull>(pairIndices[i] / Nusers, pairIndices[i] % Nusers));
 				}
-				else
+			}
+		}
+
+		// forward pass of the new candidate pairs only
+		if(newPairs.empty() == false)
+		{
+			vector<double> newLikelihoods = vector<double>(newPairs.size(), 0.0);
+			bool* newZeroLikelihoods = (bool*)Allocate(newPairs.size() * sizeof(bool));
+			VERIFY(newZeroLikelihoods != NULL);
+			memset(newZeroLikelihoods, 0, newPairs.size() * sizeof(bool));
+
+			VERIFY(ComputeAlphaBeta(traces, emissions, newPairs, NULL, NULL, &newLikelihoods[0], newZeroLikelihoods) == true);
+
+			for(ull pairIndex = 0; pairIndex < newPairs.size(); pairIndex++)
+			{
+				ull index = GET_INDEX(newPairs[pairIndex].first, newPairs[pairIndex].second, Nusers);
+				likelihood[index] = newLikelihoods[pairIndex];
+				zeroLikelihoods[index] = newZeroLikelihoods[pairIndex];
+			}
+
+			Free(newZeroLikelihoods);
+
+			numCandidatePairs += newPairs.size();
+		}
+
+		// assignment among the candidate pairs
+		vector<ull> rowStart = vector<ull>(1, 0);
+		vector<ull> columns = vector<ull>();
+		vector<double> costs = vector<double>();
+		for(ull userIndex = 0; userIndex < Nusers; userIndex++)
+		{
+			for(ull nymIndex = 0; nymIndex < Nusers; nymIndex++)
+			{
+				ull index = GET_INDEX(userIndex, nymIndex, Nusers);
+				if(isCandidate[index] == false) { continue; }
+
+				columns.push_back(nymIndex);
+				costs.push_back(-likelihood[index]);
+			}
+			rowStart.push_back(columns.size());
+		}
+
+		SparseCostMatrix costMatrix;
+		costMatrix.numItems = Nusers;
+		costMatrix.rowStart = &rowStart[0];
+		costMatrix.columns = &columns[0];
+		costMatrix.costs = &costs[0];
+
+		if(Algorithms::MinimumCostAssignment(&costMatrix, assignment) == true) { break; }
+
+		VERIFY(k < Nusers); // all the pairs are candidates: there is always a complete assignment
+
+		k = MIN(2 * k, Nusers);
+
+		LOG_MESSAGE(Log::infoLevel, "No complete assignment among the candidate pairs: " << k << " candidates per user!");
+	}
+
+	*numCandidatesPerUser = k;
+
+	// report the pruning ratio, and the largest pre-filter margin of a pruned pair over the assigned pair of its user
+	double maxMargin = -DBL_MAX;
+	for(ull userIndex = 0; userIndex < Nusers; userIndex++)
+	{
+		double assignedScore = scores[GET_INDEX(userIndex, assignment[userIndex], Nusers)];
+		for(ull nymIndex = 0; nymIndex < Nusers; nymIndex++)
+		{
+			ull index = GET_INDEX(userIndex, nymIndex, Nusers);
+			if(isCandidate[index] == false) { maxMargin = MAX(maxMargin, scores[index] - assignedScore); }
+		}
+	}
+
+	if(LOG_ENABLED(Log::infoLevel))
+	{
+		stringstream info("");
+		info << "Pruning: " << (Nusers * Nusers - numCandidatePairs) << " of " << (Nusers * Nusers) << " pairs pruned (ratio " << (double)(Nusers * Nusers - numCandidatePairs) / (double)(Nusers * Nusers) << ")";
+		if(numCandidatePairs < Nusers * Nusers) { info << ", largest pre-filter log-likelihood margin of a pruned pair over the assigned pair: " << maxMargin; }
+		Log::GetInstance()->Append(info.str());
+	}
+
+	Free(scores);
+
+	return true;
+
+  // Bouml preserved body end 000C1C11
+}
+
+bool StrongAttackOperation::ComputeAlphaBeta(const TraceSet* traces, const EmissionTable* emissions, const vector<pair<ull, ull> >& pairs, double** alpha, double** beta, double* logLikelihoods, bool* zeroLikelihoods) const 
+{
+  // Bouml preserved body begin 0001F582
+
+	if(traces == NULL || emissions == NULL || (alpha == NULL && beta == NULL && logLikelihoods == NULL))
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
+
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+	ull numTimes = maxTime - minTime + 1;
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	ull numPairs = pairs.size();
+
+	//allocate memory for Alpha and Beta
+	ull byteSizeAB = (numPairs * numTimes * numLoc) * sizeof(double);
+
+	double* myalpha = NULL;
+	if(alpha != NULL)
+	{
+		myalpha = *alpha = (double*)Allocate(byteSizeAB);
+		VERIFY(myalpha != NULL);
+		memset(myalpha, 0, byteSizeAB);
+	}
+
+	double* mybeta = NULL;
+	if(beta != NULL)
+	{
+		mybeta = *beta = (double*)Allocate(byteSizeAB);
+		VERIFY(mybeta != NULL);
+		memset(mybeta, 0, byteSizeAB);
+	}
+
+	vector<const UserProfile*> userProfiles = vector<const UserProfile*>();
+	vector<const Trace*> observedTraces = vector<const Trace*>();
+	VERIFY(GetProfilesAndObservedTraces(traces, userProfiles, observedTraces) == true);
+
+	bool success = true;
+
+	// forward pass: the pairs of each user are computed together, each worker uses its own scratch buffer
+	if(alpha != NULL || logLikelihoods != NULL)
+	{
+		vector<vector<ull> > batches = vector<vector<ull> >();
+		{
+			map<ull, ull> userBatches = map<ull, ull>(); // user index -> batch index
+			for(ull pairIndex = 0; pairIndex < numPairs; pairIndex++)
+			{
+				ull userIndex = pairs[pairIndex].first;
+
+				map<ull, ull>::iterator iter = userBatches.find(userIndex);
+				if(iter == userBatches.end())
 				{
-					arnrm[GET_INDEX_3D(userIndex, pseudonymIndex, (timestamp - minTime), Nusers, numTimes)] = arnrm[GET_INDEX_3D(userIndex, pseudonymIndex, (timestamp - minTime - 1), Nusers, numTimes)];
+					iter = userBatches.insert(pair<ull, ull>(userIndex, batches.size())).first;
+					batches.push_back(vector<ull>());
 				}
 
-				if (asum < bigNumberInverse)
-				{
-					++arnrm[GET_INDEX_3D(userIndex, pseudonymIndex, timestamp - minTime, Nusers, numTimes)];
+				batches[iter->second].push_back(pairIndex);
+			}
+		}
 
-					for (ull loc = minLoc; loc <= maxLoc; loc++)
-					{
-						ull index = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-						myalpha[index] *= bigNumber;
-					}
-				}
-/**/
-				tm++;
-				// Done with the re-normalization of alpha
+		ull maxBatchSize = 0;
+		foreach_const(vector<vector<ull> >, batches, iter) { maxBatchSize = MAX(maxBatchSize, iter->size()); }
+
+		ull numBatches = batches.size();
+		ull numWorkers = ThreadPool::GetNumWorkers(numThreads, numBatches);
+
+		// two (batch size x numLoc) alpha slices and the sub-chain steady-state vector per worker
+		ull scratchSize = (2 * maxBatchSize + 1) * numLoc;
+		ull scratchByteSize = numWorkers * scratchSize * sizeof(double);
+		double* scratch = (double*)Allocate(scratchByteSize);
+		VERIFY(scratch != NULL);
+		memset(scratch, 0, scratchByteSize);
+
+		AlphaTask task = AlphaTask(this, userProfiles, observedTraces, pairs, batches, emissions, myalpha, logLikelihoods, zeroLikelihoods, scratch, scratchSize);
+		success = ThreadPool::Execute(&task, numBatches, numThreads);
+
+		Free(scratch);
+	}
+
+	// backward pass: each pair is computed independently, each worker uses its own scratch buffer
+	if(success == true && beta != NULL)
+	{
+		ull numWorkers = ThreadPool::GetNumWorkers(numThreads, numPairs);
+
+		ull scratchByteSize = numWorkers * numLoc * sizeof(double);
+		double* scratch = (double*)Allocate(scratchByteSize);
+		VERIFY(scratch != NULL);
+		memset(scratch, 0, scratchByteSize);
+
+		BetaTask task = BetaTask(this, userProfiles, observedTraces, pairs, emissions, mybeta, scratch);
+		success = ThreadPool::Execute(&task, numPairs, numThreads);
+
+		Free(scratch);
+	}
+
+	return success;
+
+  // Bouml preserved body end 0001F582
+}
+
+bool StrongAttackOperation::ComputeLikelihood(const TraceSet* traces, const EmissionTable* emissions, double* likelihood, bool* zeroLikelihoods) const 
+{
+  // Bouml preserved body begin 000C1691
+
+	if(traces == NULL || emissions == NULL || likelihood == NULL || zeroLikelihoods == NULL)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
+
+	// all the pairs, in the order of the likelihood matrix
+	vector<pair<ull, ull> > allPairs = vector<pair<ull, ull> >();
+	for(ull userIndex = 0; userIndex < emissions->numUsers; userIndex++)
+	{
+		for(ull nymIndex = 0; nymIndex < emissions->numPseudonyms; nymIndex++) { allPairs.push_back(pair<ull, ull>(userIndex, nymIndex)); }
+	}
+
+	// only the forward pass is run, alpha being discarded
+	return ComputeAlphaBeta(traces, emissions, allPairs, NULL, NULL, likelihood, zeroLikelihoods);
+
+  // Bouml preserved body end 000C1691
+}
+
+bool StrongAttackOperation::GetProfilesAndObservedTraces(const TraceSet* traces, vector<const UserProfile*>& userProfiles, vector<const Trace*>& observedTraces) const 
+{
+  // Bouml preserved body begin 000C1711
+
+	// get the user profiles
+	map<ull, UserProfile*> profiles = map<ull, UserProfile*>();
+	VERIFY(context->GetProfiles(profiles) == true);
+
+	// get the mapping (pseudonym -> observed trace)
+	map<ull, Trace*> mappingNymObserved = map<ull, Trace*>();
+	traces->GetMapping(mappingNymObserved);
+
+	VERIFY(profiles.size() == mappingNymObserved.size());
+
+	// index the users and the observed traces (in the order of the emission table)
+	pair_foreach_const(map<ull, UserProfile*>, profiles, usersIter) { userProfiles.push_back(usersIter->second); }
+
+	pair_foreach_const(map<ull, Trace*>, mappingNymObserved, pseudonymsIter) { observedTraces.push_back(pseudonymsIter->second); }
+
+	return true;
+
+  // Bouml preserved body end 000C1711
+}
+
+//each alpha slice is scaled to sum to one: the log-likelihood of a pair is the sum of the logs of the per-step scale factors (the sums of the slices before scaling), or log(DBL_MIN) if the trace is impossible
+bool StrongAttackOperation::ComputeAlphaOfUser(const UserProfile* profile, const vector<const Trace*>& observedTraces, const vector<pair<ull, ull> >& pairs, const vector<ull>& batch, const EmissionTable* emissions, double* alpha, double* logLikelihoods, bool* zeroLikelihoods, double* scratch) const 
+{
+  // Bouml preserved body begin 000C1191
+
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+	ull numTimes = maxTime - minTime + 1;
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	ull batchSize = batch.size();
+	VERIFY(batchSize != 0);
+
+	ull userIndex = pairs[batch[0]].first;
+
+	double* steadyStateVector = NULL;
+	profile->GetSteadyStateVector(&steadyStateVector);
+
+	VERIFY(steadyStateVector != NULL);
+
+	// the emission table has been computed from the observed traces: only check that they are complete
+	foreach_const(vector<ull>, batch, iter)
+	{
+		VERIFY(pairs[*iter].first == userIndex);
+
+		vector<Event*> events = vector<Event*>();
+		observedTraces[pairs[*iter].second]->GetEvents(events);
+
+		VERIFY(numTimes == events.size());
+	}
+
+	// the alpha slices of all the pairs are stacked into (batchSize x numLoc) matrices, so that each time step is a single matrix product
+	double* previousAlpha = scratch;
+	double* currentAlpha = &scratch[batchSize * numLoc];
+	double* subChainSteadyStateVector = &scratch[2 * batchSize * numLoc];
+
+	// each slice is scaled to sum to one, the log-likelihood being the sum of the logs of the scaling coefficients
+	vector<double> logLikelihood = vector<double>(batchSize, 0.0);
+	vector<bool> zeroLikelihood = vector<bool>(batchSize, false);
+
+	// for all time instants
+	for(ull timestamp = minTime; timestamp <= maxTime; timestamp++)
+	{
+		ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
+		ull prevtp = tp; // ensure prevtp is always consistent with its usage
+		if(timestamp > minTime) { prevtp = Parameters::GetInstance()->LookupTimePeriod(timestamp - 1); }
+		if(prevtp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD)
+		{
+			SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+			return false;
+		}
+
+		ull timeIndex = timestamp - minTime;
+
+		if (timestamp == minTime) // compute alpha_1
+		{
+			// get the proper sub-chain steady-state vector according to the time period of the event
+			VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, subChainSteadyStateVector) == true);
+
+			for(ull batchIndex = 0; batchIndex < batchSize; batchIndex++)
+			{
+				memcpy(&currentAlpha[batchIndex * numLoc], subChainSteadyStateVector, numLoc * sizeof(double));
 			}
+		}
+		else // compute alpha_t = (alpha_t-1 * transition matrix)
+		{
+			// the sub-chain transition matrix from the time period of the previous event (we're computing alpha, remember?)
+			VERIFY(PropagateAlpha(profile, prevtp, tp, batchSize, previousAlpha, currentAlpha) == true);
+		}
 
-			//keeping track of how many re-normalizations for alpha of user u and pseudonym u'
-/**/
-			mylrnrm[GET_INDEX(userIndex, pseudonymIndex, Nusers)] = arnrm[GET_INDEX_3D(userIndex, pseudonymIndex, maxTime - minTime, Nusers, numTimes)];
-/**/
+		for(ull batchIndex = 0; batchIndex < batchSize; batchIndex++)
+		{
+			ull pairIndex = batch[batchIndex];
+			ull pseudonymIndex = pairs[pairIndex].second;
 
+			double* rowAlpha = &currentAlpha[batchIndex * numLoc];
 
-			ObservedEvent* prevObservedEvent = NULL;
+			// times the emission probabilities
+			double asum = 0.0;
+			for(ull locIndex = 0; locIndex < numLoc; locIndex++)
+			{
+				rowAlpha[locIndex] *= emissions->GetProbability(userIndex, pseudonymIndex, timeIndex, locIndex);
+				asum += rowAlpha[locIndex];
+			}
 
+			// scale the slice (an impossible observed trace leaves all the following slices to zero)
+			if(asum > 0.0)
+			{
+				double scale = 1.0 / asum;
+				for(ull locIndex = 0; locIndex < numLoc; locIndex++) { rowAlpha[locIndex] *= scale; }
 
-			// compute beta
+				logLikelihood[batchIndex] += log(asum);
+			}
+			else { zeroLikelihood[batchIndex] = true; }
 
-			// for all time instants
-			tm = maxTime;
-			foreach_const_reverse(vector<Event*>, events, eventsIter)
+			if(alpha != NULL)
 			{
-				double bsum = 0.0;
+				ull index = GET_INDEX_3D(pairIndex, timeIndex, 0, numTimes, numLoc);
+				memcpy(&alpha[index], rowAlpha, numLoc * sizeof(double));
+			}
+		}
+
+		double* temp = previousAlpha;
+		previousAlpha = currentAlpha;
+		currentAlpha = temp;
+	}
 
-				ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
-				set<ull> timestamps = set<ull>();
-				observedEvent->GetTimestamps(timestamps);
+	if(logLikelihoods != NULL)
+	{
+		for(ull batchIndex = 0; batchIndex < batchSize; batchIndex++)
+		{
+			logLikelihoods[batch[batchIndex]] = (zeroLikelihood[batchIndex] == true) ? log(DBL_MIN) : logLikelihood[batchIndex];
+		}
+	}
+
+	if(zeroLikelihoods != NULL)
+	{
+		for(ull batchIndex = 0; batchIndex < batchSize; batchIndex++) { zeroLikelihoods[batch[batchIndex]] = zeroLikelihood[batchIndex]; }
+	}
+
+	return true;
+
+  // Bouml preserved body end 000C1191
+}
+
+bool StrongAttackOperation::PropagateAlpha(const UserProfile* profile, ull prevtp, ull tp, ull numRows, const double* previousAlpha, double* currentAlpha) const 
+{
+  // Bouml preserved body begin 000C1F91
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
 
-				VERIFY(timestamps.empty() == false);
+	const SparseTransitionMatrix* sparseMatrix = NULL;
+	VERIFY(profile->GetSparseSubChainTransitionMatrix(prevtp, tp, &sparseMatrix) == true);
 
-				ull timestamp = *(timestamps.begin());
+	if(sparseMatrix->density < SPARSE_TRANSITION_DENSITY) // only the non-zero transitions from each previous location
+	{
+		memset(currentAlpha, 0, numRows * numLoc * sizeof(double));
 
-				VERIFY(tm == timestamp && (timestamp >= minTime && timestamp <= maxTime));
+		for(ull rowIndex = 0; rowIndex < numRows; rowIndex++)
+		{
+			const double* rowPrevious = &previousAlpha[rowIndex * numLoc];
+			double* rowCurrent = &currentAlpha[rowIndex * numLoc];
+
+			for(ull prevLocIndex = 0; prevLocIndex < numLoc; prevLocIndex++)
+			{
+				double previous = rowPrevious[prevLocIndex];
+				if(previous == 0.0) { continue; }
 
-				ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
-				ull nexttp = tp; // ensure nexttp is always consistent with its usage
-				if(timestamp < maxTime) { nexttp = Parameters::GetInstance()->LookupTimePeriod(timestamp + 1); }
-				if(nexttp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD)
+				for(ull position = sparseMatrix->rowStart[prevLocIndex]; position < sparseMatrix->rowStart[prevLocIndex + 1]; position++)
 				{
-					SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-					return false;
+					rowCurrent[sparseMatrix->rowColumns[position]] += previous * sparseMatrix->rowValues[position];
 				}
+			}
+		}
+	}
+	else
+	{
+		const double* subChainTransitionMatrix = NULL;
+		VERIFY(profile->GetSubChainTransitionMatrix(prevtp, tp, &subChainTransitionMatrix) == true);
 
-				for(ull loc = minLoc; loc <= maxLoc; loc++)
-				{
-					// compute beta_T
-					if (timestamp == maxTime)
-					{
-						ull index = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-						mybeta[index] = 1.0;
-					}
-					else // compute beta_t
-					{
-						double sum = 0.0;
+		Algorithms::MultiplyMatrices(previousAlpha, subChainTransitionMatrix, numRows, numLoc, numLoc, currentAlpha);
+	}
 
-						for(ull nextloc = minLoc; nextloc <= maxLoc; nextloc++)
-						{
-							ActualEvent* actualEvent = new ActualEvent(user, timestamp + 1, nextloc);
-							ExposedEvent* exposedEvent = new ExposedEvent(*actualEvent);
+	return true;
 
-							VERIFY(actualEvent != NULL && exposedEvent != NULL);
+  // Bouml preserved body end 000C1F91
+}
 
-							double lppmProb0 = lppmPDF->PDF(context, actualEvent, prevObservedEvent);
-							double applicationProb0 = applicationPDF->PDF(context, actualEvent, actualEvent);
+bool StrongAttackOperation::AdvanceOnlineAlphaOfUser(ull userIndex, double* scratch) 
+{
+  // Bouml preserved body begin 000C2191
 
-							double lppmProb1 = lppmPDF->PDF(context, exposedEvent, prevObservedEvent);
-							double applicationProb1 = applicationPDF->PDF(context, actualEvent, exposedEvent);
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
 
-							actualEvent->Release();
-							exposedEvent->Release();
+	ull Nusers = onlineProfiles.size();
+	ull numLoc = onlineEmissions.numLoc;
 
-							ull index2 = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime + 1), (nextloc - minLoc), Nusers, numTimes, numLoc);
-							double nextBeta = mybeta[index2];
+	ull timestamp = minTime + onlineNumTimes;
 
-							// get the proper sub-chain transition vector to the time period of the next event (we're computing beta, remember?)
-							double* subChainTransitionVector = NULL;
-							VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, tp, loc, nexttp, &subChainTransitionVector) == true);
+	ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
+	ull prevtp = tp; // ensure prevtp is always consistent with its usage
+	if(timestamp > minTime) { prevtp = Parameters::GetInstance()->LookupTimePeriod(timestamp - 1); }
+	if(prevtp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+		return false;
+	}
 
-							ull index3 = (nextloc - minLoc);
-							double transitionProb = subChainTransitionVector[index3];
+	const UserProfile* profile = onlineProfiles[userIndex];
 
-							Free(subChainTransitionVector);  // free the sub-chain transition vector
+	// the alpha slices of the pairs of the user form a (Nusers x numLoc) matrix, as in ComputeAlphaOfUser()
+	double* userAlpha = &onlineAlpha[GET_INDEX_3D(userIndex, 0, 0, Nusers, numLoc)];
+	double* currentAlpha = scratch;
 
-							sum += (double)nextBeta * transitionProb * ((lppmProb0 * applicationProb0 ) + (lppmProb1 * applicationProb1));
-						}
+	if(onlineNumTimes == 0) // alpha_1
+	{
+		double* steadyStateVector = NULL;
+		profile->GetSteadyStateVector(&steadyStateVector);
+		VERIFY(steadyStateVector != NULL);
 
-						ull index = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-						mybeta[index] = sum;
+		double* subChainSteadyStateVector = &scratch[Nusers * numLoc];
+		VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, subChainSteadyStateVector) == true);
 
-						bsum += sum;
+		for(ull nymIndex = 0; nymIndex < Nusers; nymIndex++)
+		{
+			memcpy(&currentAlpha[nymIndex * numLoc], subChainSteadyStateVector, numLoc * sizeof(double));
+		}
+	}
+	else { VERIFY(PropagateAlpha(profile, prevtp, tp, Nusers, userAlpha, currentAlpha) == true); }
 
-						// take care of small beta
-						//VERIFY(sum == 0.0 || sum > bigNumberInverse);
-					}
-				}
+	for(ull nymIndex = 0; nymIndex < Nusers; nymIndex++)
+	{
+		double* rowAlpha = &currentAlpha[nymIndex * numLoc];
+
+		// times the emission probabilities
+		double asum = 0.0;
+		for(ull locIndex = 0; locIndex < numLoc; locIndex++)
+		{
+			rowAlpha[locIndex] *= onlineEmissions.GetProbability(userIndex, nymIndex, 0, locIndex);
+			asum += rowAlpha[locIndex];
+		}
+
+		// scale the slice (an impossible observed trace leaves all the following slices to zero)
+		if(asum > 0.0)
+		{
+			double scale = 1.0 / asum;
+			for(ull locIndex = 0; locIndex < numLoc; locIndex++) { rowAlpha[locIndex] *= scale; }
+
+			onlineLogLikelihoods[GET_INDEX(userIndex, nymIndex, Nusers)] += log(asum);
+		}
+	}
+
+	memcpy(userAlpha, currentAlpha, Nusers * numLoc * sizeof(double));
+
+	return true;
+
+  // Bouml preserved body end 000C2191
+}
+
+void StrongAttackOperation::FreeOnlineAttack() 
+{
+  // Bouml preserved body begin 000C2211
+
+	if(onlineAlpha != NULL) { Free(onlineAlpha); onlineAlpha = NULL; }
+	if(onlineLogLikelihoods != NULL) { Free(onlineLogLikelihoods); onlineLogLikelihoods = NULL; }
+	FreeEmissionTable(&onlineEmissions);
+
+	onlineProfiles.clear();
+	onlinePseudonyms.clear();
+	onlineNumTimes = 0;
+
+  // Bouml preserved body end 000C2211
+}
+
+bool StrongAttackOperation::ComputeBetaOfPair(const UserProfile* profile, const Trace* observedTrace, ull userIndex, ull pseudonymIndex, const EmissionTable* emissions, double* mybeta, double* weightedNextBeta) const 
+{
+  // Bouml preserved body begin 000C1811
+
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+	ull numTimes = maxTime - minTime + 1;
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	vector<Event*> events = vector<Event*>();
+	observedTrace->GetEvents(events);
+
+	VERIFY(numTimes == events.size());
+
+	// compute beta: each time slice is scaled to sum to one (the scaling coefficients cancel out in the location distribution)
+
+	// for all time instants
+	ull tm = maxTime;
+	foreach_const_reverse(vector<Event*>, events, eventsIter)
+	{
+		ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
+		set<ull> timestamps = set<ull>();
+		observedEvent->GetTimestamps(timestamps);
+
+		VERIFY(timestamps.empty() == false);
 
-				prevObservedEvent = observedEvent;
+		ull timestamp = *(timestamps.begin());
 
-				// Re-normalize the alpha's s necessary to avoid underflow
-/**/
-				if (bsum < bigNumberInverse)
+		VERIFY(tm == timestamp && (timestamp >= minTime && timestamp <= maxTime));
+
+		ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
+		ull nexttp = tp; // ensure nexttp is always consistent with its usage
+		if(timestamp < maxTime) { nexttp = Parameters::GetInstance()->LookupTimePeriod(timestamp + 1); }
+		if(nexttp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD)
+		{
+			SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+			return false;
+		}
+
+		ull timeIndex = timestamp - minTime;
+		double* currentBeta = &mybeta[timeIndex * numLoc];
+
+		if (timestamp == maxTime) // compute beta_T
+		{
+			for(ull locIndex = 0; locIndex < numLoc; locIndex++) { currentBeta[locIndex] = 1.0; }
+		}
+		else // compute beta_t = transition matrix * (beta_t+1 .* emission probabilities at t+1)
+		{
+			// get the proper sub-chain transition matrix to the time period of the next event (we're computing beta, remember?)
+			const SparseTransitionMatrix* sparseMatrix = NULL;
+			VERIFY(profile->GetSparseSubChainTransitionMatrix(tp, nexttp, &sparseMatrix) == true);
+
+			const double* nextBeta = &mybeta[(timeIndex + 1) * numLoc];
+			for(ull nextLocIndex = 0; nextLocIndex < numLoc; nextLocIndex++)
+			{
+				weightedNextBeta[nextLocIndex] = nextBeta[nextLocIndex] * emissions->GetProbability(userIndex, pseudonymIndex, (timeIndex + 1), nextLocIndex);
+			}
+
+			if(sparseMatrix->density < SPARSE_TRANSITION_DENSITY) // only the non-zero transitions to each next location
+			{
+				for(ull locIndex = 0; locIndex < numLoc; locIndex++)
 				{
-					for (ull loc = minLoc; loc <= maxLoc; loc++)
+					double sum = 0.0;
+					for(ull position = sparseMatrix->rowStart[locIndex]; position < sparseMatrix->rowStart[locIndex + 1]; position++)
 					{
-						ull index = GET_INDEX_4D(userIndex, pseudonymIndex, (timestamp - minTime), (loc - minLoc), Nusers, numTimes, numLoc);
-						mybeta[index] *= bigNumber;
+						sum += sparseMatrix->rowValues[position] * weightedNextBeta[sparseMatrix->rowColumns[position]];
 					}
+
+					currentBeta[locIndex] = sum;
 				}
-/**/
-				// Done with the re-normalization of beta
-				tm--;
 			}
+			else // the transition matrix is read row by row
+			{
+				const double* subChainTransitionMatrix = NULL;
+				VERIFY(profile->GetSubChainTransitionMatrix(tp, nexttp, &subChainTransitionMatrix) == true);
 
-			stringstream info("");
-			info << "Alpha-Beta: user : pseudonym " << userIndex << " " << pseudonymIndex;
-			Log::GetInstance()->Append(info.str());
+				for(ull locIndex = 0; locIndex < numLoc; locIndex++)
+				{
+					const double* transitionRow = &subChainTransitionMatrix[locIndex * numLoc];
+
+					double sum = 0.0;
+					for(ull nextLocIndex = 0; nextLocIndex < numLoc; nextLocIndex++) { sum += transitionRow[nextLocIndex] * weightedNextBeta[nextLocIndex]; }
+
+					currentBeta[locIndex] = sum;
+				}
+			}
+		}
+
+		double bsum = 0.0;
+		for(ull locIndex = 0; locIndex < numLoc; locIndex++) { bsum += currentBeta[locIndex]; }
 
-			pseudonymIndex++;
+		if(bsum > 0.0)
+		{
+			double scale = 1.0 / bsum;
+			for(ull locIndex = 0; locIndex < numLoc; locIndex++) { currentBeta[locIndex] *= scale; }
 		}
 
-		userIndex++;
+		tm--;
 	}
 
-/**/
-	Free(arnrm);
-/**/
+	LOG_MESSAGE(Log::debugLevel, "Alpha-Beta: user : pseudonym " << userIndex << " " << pseudonymIndex);
 
 	return true;
 
-  // Bouml preserved body end 0001F582
+  // Bouml preserved body end 000C1811
 }
 
-bool StrongAttackOperation::ComputeMostLikelyTrace(const TraceSet* traces, const map<ull, ull>& userToPseudonymMap, ull* mostLikelyTrace) 
+
+void StrongAttackOperation::ComputeLocationDistribution(const double* pairAlpha, const double* pairBeta, ull userIndex, bool logProducts, double* distribution) const 
+{
+  // Bouml preserved body begin 000C1991
+
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	// the products are only dumped at the debug level
+	logProducts = (logProducts == true && LOG_ENABLED(Log::debugLevel));
+
+	for (ull tm = minTime; tm <= maxTime; tm++)
+	{
+		double sum = 0.0;
+
+		for (ull loc = minLoc; loc <= maxLoc; loc++)
+		{
+			ull index = GET_INDEX((tm - minTime), (loc - minLoc), numLoc);
+
+			double product = 0.0;
+			product = pairAlpha[index] * pairBeta[index];
+
+			distribution[index] = product;
+
+			sum += product;
+
+			if(logProducts == true)
+			{
+				LOG_MESSAGE(Log::debugLevel, "alpha beta " << userIndex << " " << tm << " " << loc << " | " << pairAlpha[index] << " * " << pairBeta[index] << " = " << product);
+				LOG_MESSAGE(Log::debugLevel, "       sum " << userIndex << " " << tm << " " << loc << " | " << sum);
+			}
+		}
+
+		for (ull loc = minLoc; loc <= maxLoc; loc++)
+		{
+			ull index = GET_INDEX((tm - minTime), (loc - minLoc), numLoc);
+
+			double tmp = distribution[index];
+			VERIFY(sum != 0.0 && (tmp/sum) != nan("n-char-sequence"));
+			distribution[index] /= (double)sum;
+		}
+	}
+
+  // Bouml preserved body end 000C1991
+}
+
+bool StrongAttackOperation::ComputeMostLikelyTrace(const TraceSet* traces, const EmissionTable* emissions, const map<ull, ull>& userToPseudonymMap, ull* mostLikelyTrace) 
 {
   // Bouml preserved body begin 0007C991
 
-	if(traces == NULL || userToPseudonymMap.empty() == true || mostLikelyTrace == NULL)
+	if(traces == NULL || emissions == NULL || userToPseudonymMap.empty() == true || mostLikelyTrace == NULL)
 	{
 		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
 		return false;
@@ -756,40 +1655,21 @@ bool StrongAttackOperation::ComputeMostLikelyTrace(const TraceSet* traces, const
 
 	ull Nusers = profiles.size();
 
-	ull deltaByteSize = Nusers * numTimes * numLoc * sizeof(double);
-	double* delta = (double*)Allocate(deltaByteSize);
-
-	VERIFY(delta != NULL);
-	memset(delta, 0, deltaByteSize);
-
-
-	ull predecessorByteSize = Nusers * numTimes * numLoc * sizeof(ull);
-	ull* predecessor = (ull*)Allocate(predecessorByteSize);
-
-	VERIFY(predecessor != NULL);
-	memset(predecessor, 0, predecessorByteSize);
-
-
 	// get the mapping (pseudonym -> observed trace)
 	map<ull, Trace*> mappingNymObserved = map<ull, Trace*>();
 	traces->GetMapping(mappingNymObserved);
 
 	VERIFY(Nusers == mappingNymObserved.size());
 
-	// for all users
-	ull userIndex = 0;
+	// index the users (in the order of the emission table), and find their observed trace
+	vector<const UserProfile*> userProfiles = vector<const UserProfile*>();
+	vector<const Trace*> observedTraces = vector<const Trace*>();
+	vector<ull> pseudonymIndices = vector<ull>();
+
+	map<ull, Trace*>::const_iterator firstMappingIter = mappingNymObserved.begin();
 	pair_foreach_const(map<ull, UserProfile*>, profiles, usersIter)
 	{
 		ull user = usersIter->first;
-		UserProfile* profile = usersIter->second;
-
-		double* transitionMatrix = NULL;
-		profile->GetTransitionMatrix(&transitionMatrix);
-
-		double* steadyStateVector = NULL;
-		profile->GetSteadyStateVector(&steadyStateVector);
-
-		VERIFY(transitionMatrix != NULL && steadyStateVector != NULL);
 
 		map<ull, ull>::const_iterator iter = userToPseudonymMap.find(user);
 		VERIFY(iter != userToPseudonymMap.end());
@@ -799,179 +1679,219 @@ bool StrongAttackOperation::ComputeMostLikelyTrace(const TraceSet* traces, const
 		map<ull, Trace*>::const_iterator mappingIter = mappingNymObserved.find(pseudonym);
 		VERIFY(mappingIter != mappingNymObserved.end());
 
-		Trace* observedTrace = mappingIter->second;
+		userProfiles.push_back(usersIter->second);
+		observedTraces.push_back(mappingIter->second);
+		pseudonymIndices.push_back(distance(firstMappingIter, mappingIter));
+	}
 
-		vector<Event*> events = vector<Event*>();
-		observedTrace->GetEvents(events);
+	// each user is decoded independently, each worker uses its own scratch buffer: two slices of delta, the sub-chain steady-state vector,
+	// the log of the sub-chain transition matrix, and the (numTimes x numLoc) predecessors of the user
+	ull numWorkers = ThreadPool::GetNumWorkers(numThreads, Nusers);
 
-		VERIFY(numTimes == events.size());
+	ull scratchSize = (3 + numLoc) * numLoc;
+	ull scratchByteSize = numWorkers * scratchSize * sizeof(double);
+	double* scratch = (double*)Allocate(scratchByteSize);
+	VERIFY(scratch != NULL);
+	memset(scratch, 0, scratchByteSize);
 
-		ull mostLikelyLastLoc = minLoc;
-		double mostLikelyLastLocValue = log(SQRT_DBL_MIN); // initially a very large (negative) value
+	ull predecessorSize = (numLoc <= VITERBI_SHORT_PREDECESSOR_MAX_LOC) ? sizeof(ushort) : sizeof(uint32);
+	ull predecessorsByteSize = numTimes * numLoc * predecessorSize;
+	unsigned char* predecessors = (unsigned char*)Allocate(numWorkers * predecessorsByteSize);
+	VERIFY(predecessors != NULL);
+	memset(predecessors, 0, numWorkers * predecessorsByteSize);
 
-		// for all time instants
-		ull tm = minTime;
-		foreach_const(vector<Event*>, events, eventsIter)
-		{
-			ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
-			set<ull> timestamps = set<ull>();
-			observedEvent->GetTimestamps(timestamps);
+	MostLikelyTraceTask task = MostLikelyTraceTask(this, userProfiles, observedTraces, pseudonymIndices, emissions, mostLikelyTrace, scratch, scratchSize, predecessors, predecessorsByteSize);
+	bool success = ThreadPool::Execute(&task, Nusers, numThreads);
 
-			VERIFY(timestamps.size() == 1);
-			ull timestamp = *(timestamps.begin());
+	Free(scratch);
+	Free(predecessors);
 
-			VERIFY(timestamp == tm && (timestamp >= minTime && timestamp <= maxTime));
+	return success;
 
-			ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
-			ull prevtp = tp; // ensure prevtp is always consistent with its usage
-			if(timestamp > minTime) { prevtp = Parameters::GetInstance()->LookupTimePeriod(timestamp - 1); }
-			if(prevtp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD)
-			{
-				SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-				return false;
-			}
+  // Bouml preserved body end 0007C991
+}
 
-			// get the proper sub-chain steady-state vector according to the time period of the event
-			double* subChainSteadyStateVector = NULL;
-			if(timestamp == minTime) // only needed for timestamp == minTime
-			{ VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, &subChainSteadyStateVector) == true); }
+template<class Index> bool StrongAttackOperation::ComputeMostLikelyTraceOfUser(const UserProfile* profile, const Trace* observedTrace, ull userIndex, ull pseudonymIndex, const EmissionTable* emissions, Index* predecessor, ull* mostLikelyTrace, double* scratch) const 
+{
+  // Bouml preserved body begin 000C1211
 
-			for(ull loc = minLoc; loc <= maxLoc; loc++)
-			{
-				ull deltaIndex = GET_INDEX_3D(userIndex, (timestamp - minTime), (loc - minLoc), numTimes, numLoc);
+	ull minTime = 0; ull maxTime = 0;
+	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
+	ull numTimes = maxTime - minTime + 1;
 
-				ActualEvent* actualEvent = new ActualEvent(user, timestamp, loc);
-				ExposedEvent* exposedEvent = new ExposedEvent(*actualEvent);
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
 
-				VERIFY(actualEvent != NULL && exposedEvent != NULL);
+	double* steadyStateVector = NULL;
+	profile->GetSteadyStateVector(&steadyStateVector);
 
-				double lppmProb0 = lppmPDF->PDF(context, actualEvent, observedEvent);
-				double applicationProb0 = applicationPDF->PDF(context, actualEvent, actualEvent);
+	VERIFY(steadyStateVector != NULL);
 
-				double lppmProb1 = lppmPDF->PDF(context, exposedEvent, observedEvent);
-				double applicationProb1 = applicationPDF->PDF(context, actualEvent, exposedEvent);
+	vector<Event*> events = vector<Event*>();
+	observedTrace->GetEvents(events);
 
-				actualEvent->Release();
-				exposedEvent->Release();
+	VERIFY(numTimes == events.size());
 
-				double f = ((lppmProb0 * applicationProb0) + (lppmProb1 * applicationProb1));
-				double logf = log(f);
+	// only two slices of delta are kept, the predecessors (location indices) of all the time instants being stored in the given buffer
+	double* previousDelta = scratch;
+	double* currentDelta = &scratch[numLoc];
+	double* subChainSteadyStateVector = &scratch[2 * numLoc];
 
-				if(f <= 0.0 || logf == nan("n-char-sequence"))
-				{
-					logf = log(SQRT_DBL_MIN); // avoid log overflow/underflow/nan
-				}
+	// log of the (dense or sparse) sub-chain transition matrix, only recomputed when the pair of time periods changes
+	double* logTransitions = &scratch[3 * numLoc];
+	const double* cachedMatrix = NULL;
+	const SparseTransitionMatrix* sparseMatrix = NULL;
 
-				if(timestamp == minTime) // initialization
-				{
-					double presenceProb = subChainSteadyStateVector[loc - minLoc];
-					double logpp = log(presenceProb);
+	double minValue = log(SQRT_DBL_MIN); // a very large (negative) value
 
-					if(presenceProb <= 0.0 || logpp == nan("n-char-sequence"))
-					{
-						logpp = log(SQRT_DBL_MIN); // avoid log overflow/underflow/nan
-					}
-
-					// delta[deltaIndex] = f * presenceProb;
-					delta[deltaIndex] = logf + log(presenceProb); // use logarithms to avoid underflow
-				}
-				else
-				{
-					ull maximizingLoc = minLoc;
-					double maximizingValue = log(SQRT_DBL_MIN); // initially a very large (negative) value
-					for(ull loc2 = minLoc; loc2 <= maxLoc; loc2++)
-					{
-						ull prevDeltaIndex = GET_INDEX_3D(userIndex, ((timestamp - 1) - minTime), (loc2 - minLoc), numTimes, numLoc);
+	// for all time instants
+	ull tm = minTime;
+	foreach_const(vector<Event*>, events, eventsIter)
+	{
+		ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
+		set<ull> timestamps = set<ull>();
+		observedEvent->GetTimestamps(timestamps);
 
-						double prevDelta = delta[prevDeltaIndex];
+		VERIFY(timestamps.size() == 1);
+		ull timestamp = *(timestamps.begin());
 
-						// get the proper sub-chain transition vector to the time period of the previous event
-						double* subChainTransitionVector = NULL;
-						VERIFY(Algorithms::GetTransitionVectorOfSubChain(transitionMatrix, prevtp, loc2, tp, &subChainTransitionVector) == true);
+		VERIFY(timestamp == tm && (timestamp >= minTime && timestamp <= maxTime));
 
-						ull currLocIdx = (loc - minLoc);
-						double transProb = subChainTransitionVector[currLocIdx];
+		ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
+		ull prevtp = tp; // ensure prevtp is always consistent with its usage
+		if(timestamp > minTime) { prevtp = Parameters::GetInstance()->LookupTimePeriod(timestamp - 1); }
+		if(prevtp == INVALID_TIME_PERIOD || tp == INVALID_TIME_PERIOD)
+		{
+			SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
+			return false;
+		}
 
-						Free(subChainTransitionVector);  // free the sub-chain transition vector
+		ull timeIndex = timestamp - minTime;
 
-						// double m = (prevDelta * transProb);
-						double m = prevDelta + log(transProb);  // use logarithms to avoid underflow
+		if(timestamp == minTime) // initialization
+		{
+			// get the proper sub-chain steady-state vector according to the time period of the event
+			VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, subChainSteadyStateVector) == true);
 
-						if(maximizingValue < m)
-						{
-							maximizingLoc = loc2;
-							maximizingValue = m;
-						}
+			// delta = f * presenceProb, using logarithms to avoid underflow
+			for(ull locIndex = 0; locIndex < numLoc; locIndex++) { currentDelta[locIndex] = log(subChainSteadyStateVector[locIndex]); }
+		}
+		else
+		{
+			// get the proper sub-chain transition matrix from the time period of the previous event
+			const SparseTransitionMatrix* subChainSparseMatrix = NULL;
+			VERIFY(profile->GetSparseSubChainTransitionMatrix(prevtp, tp, &subChainSparseMatrix) == true);
 
-						/*// debug
-						{
-							stringstream info("");
-							info << "User: " << user << " - possible loc at time " <<  timestamp << " for loc: " << loc;
-							info << " is " << loc2 << " | m: " << m << " | prevDelta: " << prevDelta << " | transProb: " << transProb;
-							Log::GetInstance()->Append(info.str());
-						}*/
-					}
+			if(subChainSparseMatrix->density < SPARSE_TRANSITION_DENSITY)
+			{
+				if(sparseMatrix != subChainSparseMatrix)
+				{
+					for(ull position = 0; position < subChainSparseMatrix->numNonZeros; position++) { logTransitions[position] = log(subChainSparseMatrix->columnValues[position]); }
+					sparseMatrix = subChainSparseMatrix; cachedMatrix = NULL;
+				}
+			}
+			else
+			{
+				const double* subChainTransitionMatrix = NULL;
+				VERIFY(profile->GetSubChainTransitionMatrix(prevtp, tp, &subChainTransitionMatrix) == true);
 
-					// delta[deltaIndex] = f * maximizingValue;
-					delta[deltaIndex] = maximizingValue + logf; // use logarithms to avoid underflow
+				if(cachedMatrix != subChainTransitionMatrix)
+				{
+					for(ull index = 0; index < numLoc * numLoc; index++) { logTransitions[index] = log(subChainTransitionMatrix[index]); }
+					cachedMatrix = subChainTransitionMatrix; sparseMatrix = NULL;
+				}
+			}
 
-					// store predecessor
-					ull predecessorIndex = GET_INDEX_3D(userIndex, (timestamp - minTime), (loc - minLoc), numTimes, numLoc);
-					predecessor[predecessorIndex] = maximizingLoc;
+			// delta_t(loc) = max over loc2 of (delta_t-1(loc2) + log(transition(loc2, loc))): the first maximizing loc2 is kept
+			Index* currentPredecessor = &predecessor[timeIndex * numLoc];
+			for(ull locIndex = 0; locIndex < numLoc; locIndex++) { currentDelta[locIndex] = minValue; currentPredecessor[locIndex] = 0; }
 
-					/* // debug
+			if(sparseMatrix != NULL) // only the non-zero transitions to each location can be maximizing
+			{
+				for(ull locIndex = 0; locIndex < numLoc; locIndex++)
+				{
+					for(ull position = sparseMatrix->columnStart[locIndex]; position < sparseMatrix->columnStart[locIndex + 1]; position++)
 					{
-						stringstream info("");
-						info << "User: " << user << " - maximizing predecessor at time " <<  timestamp << " for loc: " << loc;
-						info << " is " << maximizingLoc << " | delta: " << delta[deltaIndex] << " | f: " << f << " | maximizingValue: " << maximizingValue;
-						Log::GetInstance()->Append(info.str());
-					}*/
-				}
+						ull prevLocIndex = sparseMatrix->columnRows[position];
+						double m = previousDelta[prevLocIndex] + logTransitions[position];
 
-				if(timestamp == maxTime) // find the max
+						if(currentDelta[locIndex] < m)
+						{
+							currentDelta[locIndex] = m;
+							currentPredecessor[locIndex] = (Index)prevLocIndex;
+						}
+					}
+				}
+			}
+			else // the log-transition matrix is read row by row, each row updating all the locations (max-plus product)
+			{
+				for(ull prevLocIndex = 0; prevLocIndex < numLoc; prevLocIndex++)
 				{
-					if(mostLikelyLastLocValue < delta[deltaIndex])
+					double prevDelta = previousDelta[prevLocIndex];
+					const double* logRow = &logTransitions[prevLocIndex * numLoc];
+
+					for(ull locIndex = 0; locIndex < numLoc; locIndex++)
 					{
-						mostLikelyLastLocValue = delta[deltaIndex];
-						mostLikelyLastLoc = loc;
+						double m = prevDelta + logRow[locIndex];
+
+						bool greater = (currentDelta[locIndex] < m);
+						currentDelta[locIndex] = greater ? m : currentDelta[locIndex];
+						currentPredecessor[locIndex] = greater ? (Index)prevLocIndex : currentPredecessor[locIndex];
 					}
 				}
 			}
-			if(timestamp == minTime) // only needed for tm == minTime
-			{ Free(subChainSteadyStateVector); /* free the sub-chain steady-state vector */ }
-
-			tm++;
 		}
 
-		// reconstruct most likely trace for this user
-		VERIFY(minTime > 0);
-		ull predecessorLoc = mostLikelyLastLoc;
+		// times the emission probabilities
+		for(ull locIndex = 0; locIndex < numLoc; locIndex++)
+		{
+			double f = emissions->GetProbability(userIndex, pseudonymIndex, timeIndex, locIndex);
+			double logf = log(f);
 
-		ull index = GET_INDEX(userIndex, (maxTime - minTime), numTimes);
-		mostLikelyTrace[index] = mostLikelyLastLoc;
+			if(f <= 0.0 || logf == nan("n-char-sequence"))
+			{
+				logf = log(SQRT_DBL_MIN); // avoid log overflow/underflow/nan
+			}
 
-		VERIFY(mostLikelyLastLoc >= minLoc && mostLikelyLastLoc <= maxLoc);
+			currentDelta[locIndex] += logf;
+		}
 
-		for(ull tm = maxTime - 1; tm >= minTime; tm--)
-		{
-			ull predecessorIndex = GET_INDEX_3D(userIndex, ((tm + 1) - minTime), (predecessorLoc - minLoc), numTimes, numLoc);
-			predecessorLoc = predecessor[predecessorIndex];
+		double* temp = previousDelta;
+		previousDelta = currentDelta;
+		currentDelta = temp;
 
-			VERIFY(predecessorLoc >= minLoc && predecessorLoc <= maxLoc);
+		tm++;
+	}
 
-			index = GET_INDEX(userIndex, (tm - minTime), numTimes);
-			mostLikelyTrace[index] = predecessorLoc;
+	// find the max of the last slice (now previousDelta)
+	ull mostLikelyLastLocIndex = 0;
+	double mostLikelyLastLocValue = minValue;
+	for(ull locIndex = 0; locIndex < numLoc; locIndex++)
+	{
+		if(mostLikelyLastLocValue < previousDelta[locIndex])
+		{
+			mostLikelyLastLocValue = previousDelta[locIndex];
+			mostLikelyLastLocIndex = locIndex;
 		}
-
-		userIndex++;
 	}
 
-	Free(delta);
-	Free(predecessor);
+	// reconstruct most likely trace for this user
+	ull predecessorLocIndex = mostLikelyLastLocIndex;
+	mostLikelyTrace[GET_INDEX(userIndex, (numTimes - 1), numTimes)] = predecessorLocIndex + minLoc;
+
+	for(ull timeIndex = numTimes - 1; timeIndex > 0; timeIndex--)
+	{
+		predecessorLocIndex = predecessor[GET_INDEX(timeIndex, predecessorLocIndex, numLoc)];
+
+		VERIFY(predecessorLocIndex < numLoc);
+
+		mostLikelyTrace[GET_INDEX(userIndex, (timeIndex - 1), numTimes)] = predecessorLocIndex + minLoc;
+	}
 
 	return true;
 
-  // Bouml preserved body end 0007C991
+  // Bouml preserved body end 000C1211
 }
 
 
@@ -0,0 +1,215 @@
+/* -------------------------------------------------------------------------------------
+ * Copyright 2012 EPFL-I&C-LCA
+ *
+ * Designed and Developed by: Vincent Bindschaedler and Reza Shokri
+ *
+ * Authors: Reza Shokri, George Theodorakopoulos, Vincent Bindschaedler, George Danezis, 
+ *          Jean-Pierre Hubaux, Jean-Yves Le Boudec
+ * 
+ * Contact: reza.shokri@epfl.ch
+ *
+ * Redistribution and use in source and binary forms, with or without modification, 
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this 
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the authors/developers may not be used to endorse or promote 
+ *    products derived from this software without specific prior written permission.
+ * 4. All advertising materials and/or any publications mentioning features or use of 
+ *    this software must acknowledge it by citing the followings:
+ *    [a] Location-Privacy Meter: A Tool to Quantify Location Privacy. 
+ *        Available at http://lca.epfl.ch/projects/quantifyingprivacy/
+ *    [b] Reza Shokri, George Theodorakopoulos, Jean-Yves Le Boudec, and Jean-Pierre 
+ *        Hubaux. Quantifying Location Privacy. In IEEE Symposium on Security and 
+ *        Privacy (S&P), Oakland, CA, USA, May 22-25, 2011.
+ *    [c] Reza Shokri, George Theodorakopoulos, George Danezis, Jean-Pierre Hubaux, 
+ *        and Jean-Yves Le Boudec. Quantifying Location Privacy: The Case of Sporadic
+ *        Location Exposure. In The 11th Privacy Enhancing Technologies Symposium 
+ *        (PETS), Waterloo, Canada, July 27-29, 2011.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; 
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * -------------------------------------------------------------------------------------
+ */
+//!
+//! \file
+//!
+#include "../include/ThreadPool.h"
+
+#include <unistd.h>
+
+namespace lpm {
+
+// state shared by the workers of one ThreadPool::Execute() call
+struct ThreadPoolWork 
+{
+    ParallelTask* task;
+
+    ull numTasks;
+
+    volatile ull nextTask;
+
+    volatile ull failures;
+
+};
+
+// state of one worker
+struct ThreadPoolWorker 
+{
+    ThreadPoolWork* work;
+
+    ull workerIdx;
+
+};
+
+static void* RunThreadPoolWorker(void* arg)
+{
+	ThreadPoolWorker* worker = (ThreadPoolWorker*)arg;
+	ThreadPoolWork* work = worker->work;
+
+	while(true)
+	{
+		if(work->failures != 0) { break; } // stop as soon as a task failed
+
+		ull taskIdx = __sync_fetch_and_add(&work->nextTask, 1); // claim the next task
+		if(taskIdx >= work->numTasks) { break; }
+
+		if(work->task->Run(taskIdx, worker->workerIdx) == false)
+		{
+			__sync_fetch_and_add(&work->failures, 1);
+		}
+	}
+
+	return NULL;
+}
+
+ParallelTask::~ParallelTask() 
+{
+  // Bouml preserved body begin 000C0011
+  // Bouml preserved body end 000C0011
+}
+
+//! 
+//! \brief Returns the number of processors available
+//!
+//! \return ull, the number of online processors (at least 1)
+//!
+ull ThreadPool::GetNumProcessors() 
+{
+  // Bouml preserved body begin 000C0091
+
+	long num = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (num < 1) ? 1 : (ull)num;
+
+  // Bouml preserved body end 000C0091
+}
+
+//! 
+//! \brief Returns the number of worker threads which would be used to run \a numTasks tasks
+//!
+//! \param[in] numThreads 	ull, the requested number of threads (THREADS_ALL_PROCESSORS for one thread per processor).
+//! \param[in] numTasks 	ull, the number of tasks.
+//!
+//! \return ull, the number of worker threads
+//!
+ull ThreadPool::GetNumWorkers(ull numThreads, ull numTasks) 
+{
+  // Bouml preserved body begin 000C0111
+
+	if(numThreads == THREADS_ALL_PROCESSORS) { numThreads = GetNumProcessors(); }
+
+	numThreads = MIN(numThreads, numTasks);
+
+	return (numThreads == 0) ? 1 : numThreads;
+
+  // Bouml preserved body end 000C0111
+}
+
+//! 
+//! \brief Runs the tasks \a 0, \a 1, ..., \a numTasks - 1 of the given \a task using \a numThreads worker threads
+//!
+//! \param[in] task 	ParallelTask*, the work to execute.
+//! \param[in] numTasks 	ull, the number of tasks.
+//! \param[in] numThreads 	ull, the number of worker threads (THREADS_ALL_PROCESSORS for one thread per processor).
+//!
+//! \note If a single worker is used, the tasks are run in order by the calling thread.
+//!
+//! \return true if all tasks were run successfully, false otherwise
+//!
+bool ThreadPool::Execute(ParallelTask* task, ull numTasks, ull numThreads) 
+{
+  // Bouml preserved body begin 000C0191
+
+	if(task == NULL)
+	{
+		SET_ERROR_CODE(ERROR_CODE_INVALID_ARGUMENTS);
+		return false;
+	}
+
+	if(numTasks == 0) { return true; }
+
+	ull numWorkers = GetNumWorkers(numThreads, numTasks);
+
+	if(numWorkers == 1) // no need for threads
+	{
+		for(ull taskIdx = 0; taskIdx < numTasks; taskIdx++)
+		{
+			if(task->Run(taskIdx, 0) == false) { return false; }
+		}
+
+		return true;
+	}
+
+	// make sure the singletons exist before the workers start
+	Memory::GetInstance(); Log::GetInstance(); Errors::GetInstance(); RNG::GetInstance(); Parameters::GetInstance();
+
+	ThreadPoolWork work;
+	work.task = task;
+	work.numTasks = numTasks;
+	work.nextTask = 0;
+	work.failures = 0;
+
+	vector<ThreadPoolWorker> workers = vector<ThreadPoolWorker>(numWorkers);
+	vector<pthread_t> threads = vector<pthread_t>(numWorkers);
+
+	ull numStarted = 0;
+	for(ull workerIdx = 0; workerIdx < numWorkers; workerIdx++)
+	{
+		workers[workerIdx].work = &work;
+		workers[workerIdx].workerIdx = workerIdx;
+
+		if(pthread_create(&threads[workerIdx], NULL, RunThreadPoolWorker, &workers[workerIdx]) != 0) { break; }
+
+		numStarted++;
+	}
+
+	if(numStarted == 0) // could not start any thread: run everything from the calling thread instead
+	{
+		stringstream ss("");
+		ss << "ThreadPool: failed to start worker threads, running " << numTasks << " tasks sequentially!";
+		Log::GetInstance()->Append(ss.str(), Log::warningLevel);
+
+		workers[0].workerIdx = 0;
+		RunThreadPoolWorker(&workers[0]);
+	}
+
+	for(ull workerIdx = 0; workerIdx < numStarted; workerIdx++) { pthread_join(threads[workerIdx], NULL); }
+
+	return (work.failures == 0);
+
+  // Bouml preserved body end 000C0191
+}
+
+
+} // namespace lpm
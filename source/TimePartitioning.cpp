@@ -326,7 +326,7 @@ bool TPNode::Partition(vector<TimePeriod>& periods)
 
 	bool success = partition->Partition(periods);
 
-	if(success == false) { Free(partition); return false; }
+	if(success == false) { delete partition; return false; }
 
 	slices.push_back(partition);
 
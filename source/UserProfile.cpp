@@ -45,6 +45,8 @@
 //! \file
 //!
 #include "../include/UserProfile.h"
+#include "../include/Algorithms.h"
+#include "../include/Parameters.h"
 
 namespace lpm {
 
@@ -55,6 +57,17 @@ UserProfile::UserProfile(ull u)
 	user = u;
 	steadystateVector = NULL;
 	transitionMatrix = NULL;
+	numSamples = 0;
+	varianceMatrix = NULL;
+	subChainTransitionMatrices = NULL;
+	subChainSparseMatrices = NULL;
+	numSubChainSparseMatrices = 0;
+	subChainMinPeriod = 0;
+	subChainNumPeriods = 0;
+	subChainNumLoc = 0;
+	subChainsBuilt = false;
+
+	pthread_mutex_init(&lock, NULL);
 
   // Bouml preserved body end 00045F11
 }
@@ -65,6 +78,9 @@ UserProfile::~UserProfile()
 
 	if(steadystateVector != NULL) { Free(steadystateVector); }
 	if(transitionMatrix != NULL) { Free(transitionMatrix); }
+	FreeSubChainTransitionMatrices();
+
+	pthread_mutex_destroy(&lock);
 
   // Bouml preserved body end 00049311
 }
@@ -87,6 +103,9 @@ bool UserProfile::SetTransitionMatrix(const double * matrix)
 
 	transitionMatrix = (double*)matrix;
 
+	// the sub-chain transition matrices are recomputed on demand
+	FreeSubChainTransitionMatrices();
+
 	return true;
 
   // Bouml preserved body end 00045F91
@@ -167,6 +186,159 @@ bool UserProfile::GetSteadyStateVector(double** vector) const
   // Bouml preserved body end 00049411
 }
 
+//! 
+//! \brief Returns the (row-normalized) transition matrix of the sub-chain from time period \a tp1 to time period \a tp2
+//!
+//! \param[in] tp1 	ull, the time period of the current state.
+//! \param[in] tp2 	ull, the time period of the next state.
+//! \param[out] matrix 	const double**, a pointer which will point to the output transition matrix (if the call is successful).
+//!
+//! \note The output matrix is a two dimensional array of doubles (of size \a numLoc x \a numLoc), whose row \a loc1 - \a minLoc is 
+//! the vector returned by \a Algorithms::GetTransitionVectorOfSubChain() for (\a tp1, \a loc1, \a tp2). 
+//! \note The matrices of all pairs of time periods are computed on the first call, and owned by the profile.
+//!
+//! \return true or false, depending on whether the call is successful.
+//!
+bool UserProfile::GetSubChainTransitionMatrix(ull tp1, ull tp2, const double** matrix) const
+{
+  // Bouml preserved body begin 000C0E11
+
+	if(matrix == NULL || transitionMatrix == NULL) { return false; }
+
+	if(BuildSubChainTransitionMatrices() == false) { return false; }
+
+	// (the parameters cached with the matrices)
+	ull minPeriod = subChainMinPeriod; ull numPeriods = subChainNumPeriods; ull numLoc = subChainNumLoc;
+
+	if(tp1 < minPeriod || tp1 >= minPeriod + numPeriods || tp2 < minPeriod || tp2 >= minPeriod + numPeriods) { return false; }
+
+	*matrix = &subChainTransitionMatrices[GET_INDEX_4D(tp1 - minPeriod, tp2 - minPeriod, 0, 0, numPeriods, numLoc, numLoc)];
+
+	return true;
+
+  // Bouml preserved body end 000C0E11
+}
+
+//! 
+//! \brief Returns the sparse representation of the transition matrix of the sub-chain from time period \a tp1 to time period \a tp2
+//!
+//! \param[in] tp1 	ull, the time period of the current state.
+//! \param[in] tp2 	ull, the time period of the next state.
+//! \param[out] matrix 	const SparseTransitionMatrix**, a pointer which will point to the output matrix (if the call is successful).
+//!
+//! \note The output matrix has the same entries as the one returned by \a GetSubChainTransitionMatrix(), stored by row and by column 
+//! if its density is below SPARSE_TRANSITION_DENSITY (only its density is kept otherwise). It is computed along with the dense matrices, and owned by the profile.
+//! \note The call fails if the time period \a tp2 cannot follow \a tp1 (see \a TPInfo::propTransMatrix), no sparse matrix being built for such pairs.
+//!
+//! \return true or false, depending on whether the call is successful.
+//!
+bool UserProfile::GetSparseSubChainTransitionMatrix(ull tp1, ull tp2, const SparseTransitionMatrix** matrix) const
+{
+  // Bouml preserved body begin 000C1E11
+
+	if(matrix == NULL || transitionMatrix == NULL) { return false; }
+
+	if(BuildSubChainTransitionMatrices() == false) { return false; }
+
+	// (the parameters cached with the matrices)
+	ull minPeriod = subChainMinPeriod; ull numPeriods = subChainNumPeriods;
+
+	if(tp1 < minPeriod || tp1 >= minPeriod + numPeriods || tp2 < minPeriod || tp2 >= minPeriod + numPeriods) { return false; }
+
+	const SparseTransitionMatrix* sparseMatrix = &subChainSparseMatrices[GET_INDEX(tp1 - minPeriod, tp2 - minPeriod, numPeriods)];
+	if(sparseMatrix->dimension == 0) { return false; } // tp2 cannot follow tp1
+
+	*matrix = sparseMatrix;
+
+	return true;
+
+  // Bouml preserved body end 000C1E11
+}
+
+bool UserProfile::ComputeSubChainTransitionMatrices() const
+{
+  // Bouml preserved body begin 000C1E91
+
+	if(subChainsBuilt == true) { return true; }
+
+	if(Algorithms::GetTransitionMatricesOfSubChains(transitionMatrix, &subChainTransitionMatrices) == false) { return false; }
+
+	// get time period parameters
+	ull numPeriods = 0; TPInfo tpInfo;
+	VERIFY(Parameters::GetInstance()->GetTimePeriodInfo(&numPeriods, &tpInfo) == true);
+
+	// get location parameters
+	ull minLoc = 0; ull maxLoc = 0;
+	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
+	ull numLoc = maxLoc - minLoc + 1;
+
+	// the sparse representation of each sub-chain matrix (only of the pairs of time periods which can follow each other)
+	numSubChainSparseMatrices = numPeriods * numPeriods;
+
+	ull byteSize = numSubChainSparseMatrices * sizeof(SparseTransitionMatrix);
+	subChainSparseMatrices = (SparseTransitionMatrix*)Allocate(byteSize);
+	VERIFY(subChainSparseMatrices != NULL);
+	memset(subChainSparseMatrices, 0, byteSize);
+
+	for(ull tp1Idx = 0; tp1Idx < numPeriods; tp1Idx++)
+	{
+		for(ull tp2Idx = 0; tp2Idx < numPeriods; tp2Idx++)
+		{
+			if(tpInfo.propTransMatrix != NULL && tpInfo.propTransMatrix[GET_INDEX(tp1Idx, tp2Idx, tpInfo.numPeriodsInclDummies)] == 0) { continue; } // the transition is not possible
+
+			ull index = GET_INDEX(tp1Idx, tp2Idx, numPeriods);
+			const double* subChainTransitionMatrix = &subChainTransitionMatrices[index * numLoc * numLoc];
+			VERIFY(Algorithms::GetSparseTransitionMatrix(subChainTransitionMatrix, numLoc, &subChainSparseMatrices[index]) == true);
+		}
+	}
+
+	// cache the parameters, so that the matrices are then read without querying them
+	subChainMinPeriod = tpInfo.minPeriod;
+	subChainNumPeriods = numPeriods;
+	subChainNumLoc = numLoc;
+
+	__sync_synchronize(); // the matrices and the parameters are visible before the flag
+	subChainsBuilt = true;
+
+	return true;
+
+  // Bouml preserved body end 000C1E91
+}
+
+void UserProfile::FreeSubChainTransitionMatrices() const
+{
+  // Bouml preserved body begin 000C1F11
+
+	if(subChainTransitionMatrices != NULL) { Free(subChainTransitionMatrices); subChainTransitionMatrices = NULL; }
+
+	if(subChainSparseMatrices != NULL)
+	{
+		for(ull index = 0; index < numSubChainSparseMatrices; index++) { Algorithms::FreeSparseTransitionMatrix(&subChainSparseMatrices[index]); }
+
+		Free(subChainSparseMatrices); subChainSparseMatrices = NULL;
+	}
+	numSubChainSparseMatrices = 0;
+	subChainsBuilt = false;
+
+  // Bouml preserved body end 000C1F11
+}
+
+bool UserProfile::BuildSubChainTransitionMatrices() const
+{
+  // Bouml preserved body begin 000C3211
+
+	// once built, the matrices are only read (the profile may be shared by several threads)
+	if(subChainsBuilt == true) { __sync_synchronize(); return true; }
+
+	pthread_mutex_lock(&lock);
+	bool success = ComputeSubChainTransitionMatrices();
+	pthread_mutex_unlock(&lock);
+
+	return success;
+
+  // Bouml preserved body end 000C3211
+}
+
 bool UserProfile::GetAccuracyInfo(ull* samples, double** variance) 
 {
   // Bouml preserved body begin 000C0391
@@ -125,85 +125,49 @@ bool WeakAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 
 	ull Nusers = profiles.size();
 
+	// emission probabilities of the observed events
+	EmissionTable emissions;
+	VERIFY(ComputeEmissionTable(input, &emissions) == true);
+
 	// de-anonymization
 	double* likelihoodMatrix = NULL;
-	VERIFY(ComputeLikelihood(input, &likelihoodMatrix) == true);
+	VERIFY(ComputeLikelihood(input, &emissions, &likelihoodMatrix) == true);
 	VERIFY(likelihoodMatrix != NULL);
 
-	// log the likelihood matrix
-	Log::GetInstance()->Append("Likelihood Matrix (weak adv):");
-	for(ull i = 0; i < Nusers; i++)
+	// log the likelihood matrix (debug only)
+	if(LOG_ENABLED(Log::debugLevel))
 	{
-		stringstream info(""); info.precision(16);
-
-		for(ull j = 0; j < Nusers; j++)
+		Log::GetInstance()->Append("Likelihood Matrix (weak adv):", Log::debugLevel);
+		for(ull i = 0; i < Nusers; i++)
 		{
-			info << " " << likelihoodMatrix[GET_INDEX(i, j, Nusers)];
-		}
+			stringstream info(""); info.precision(16);
+
+			for(ull j = 0; j < Nusers; j++)
+			{
+				info << " " << likelihoodMatrix[GET_INDEX(i, j, Nusers)];
+			}
 
-		Log::GetInstance()->Append(info.str());
+			Log::GetInstance()->Append(info.str(), Log::debugLevel);
+		}
 	}
 
 	VERIFY((ull)((ll)Nusers) == Nusers); // check overflow
 
-	// allocate weight and mapping
-	ull byteSizeMatrix = (Nusers * Nusers) * sizeof(ll);
+	// allocate mapping
 	ull byteSizeVector = Nusers * sizeof(ll);
 
-	ll* weight = (ll*)Allocate(byteSizeMatrix);
 	ll* mapping = (ll*)Allocate(byteSizeVector);
-	memset(weight, 0, byteSizeMatrix);
+	VERIFY(mapping != NULL);
 	memset(mapping, 0, byteSizeVector);
 
-	VERIFY(weight != NULL && mapping != NULL);
-
-	// convert likelihood matrix to weight matrix
-	double maxnll = 0.0;
-	for(ull i = 0; i < Nusers; i++)
-	{
-		for(ull j = 0; j < Nusers; j++)
-		{
-			ull index = GET_INDEX(i, j, Nusers);
-
-			double nll = -likelihoodMatrix[index];
-			if(nll > maxnll) { maxnll = nll; }
-		}
-	}
-
-	ll llhoodBigNumber = (maxnll == 0.0) ? -1 : (ll)(-(double)LONG_LONG_MAX/maxnll + 10000);
-	for(ull i = 0; i < Nusers; i++)
-	{
-		for(ull j = 0; j < Nusers; j++)
-		{
-			ull index = GET_INDEX(i, j, Nusers);
-			double llhood = likelihoodMatrix[index];
-			if(llhood > 0) { weight[index] = 0; }
-			else { weight[index] = (ll)(llhoodBigNumber * llhood); }
-		}
-	}
-
-	Free(likelihoodMatrix);
-
-	// log the weight matrix
-	Log::GetInstance()->Append("Weight Matrix (weak adv):");
-	for(ull i = 0; i < Nusers; i++)
-	{
-		stringstream info(""); info.precision(16);
+	// convert likelihood matrix to cost matrix (in place): the mapping which maximizes the likelihood is the minimum cost assignment
+	double* costMatrix = likelihoodMatrix;
+	for(ull index = 0; index < Nusers * Nusers; index++) { costMatrix[index] = -likelihoodMatrix[index]; }
 
-		for(ull j = 0; j < Nusers; j++)
-		{
-			info << " " << weight[GET_INDEX(i, j, Nusers)];
-		}
+	//de-anonymization
+	VERIFY(Algorithms::MinimumCostAssignment(costMatrix, Nusers, mapping) == true);
 
-		Log::GetInstance()->Append(info.str());
-	}
-
-	// prev code: VERIFY(Algorithms::MaximumWeightAssignment(Nusers, weight, mapping) == 0); // this method was called maximum weight assignment but it was computing minimum cost assignement!
-
-	ll* costMatrix = weight;
-	Algorithms::MinimumCostAssignment(costMatrix, Nusers, mapping); // Note: the weight matrix is indeed a cost matrix, the mapping which maximizes the likelihood is the minimum cost assignment!
-
-	Free(weight); weight = costMatrix = NULL;
+	Free(likelihoodMatrix); likelihoodMatrix = costMatrix = NULL;
 
 	// get mapping (pseudonym -> observed trace)
 	map<ull, Trace*> traceMapping = map<ull, Trace*>();
@@ -243,9 +207,7 @@ bool WeakAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 
 	pair_foreach_const(map<ull, ull>, userToPseudonymMapping, iter)
 	{
-		stringstream info("");
-		info << "Assignment: user -> pseudonym " << iter->first << " " << iter->second;
-		Log::GetInstance()->Append(info.str());
+		LOG_MESSAGE(Log::infoLevel, "Assignment: user -> pseudonym " << iter->first << " " << iter->second);
 	}
 
 	output->SetAnonymizationMap(userToPseudonymMapping); // set the mapping
@@ -260,10 +222,12 @@ bool WeakAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
 	VERIFY(locationDistribution != NULL);
 	memset(locationDistribution, 0, outputByteSize);
 
-	VERIFY(ComputeLocationDistribution(input, &userToPseudonymMapping, locationDistribution) == true);
+	VERIFY(ComputeLocationDistribution(input, &emissions, &userToPseudonymMapping, locationDistribution) == true);
 
 	userToPseudonymMapping.clear();
 
+	FreeEmissionTable(&emissions);
+
 	output->SetProbabilityDistribution(locationDistribution);
 
 	return true;
@@ -271,153 +235,24 @@ bool WeakAttackOperation::Execute(const TraceSet* input, AttackOutput* output)
   // Bouml preserved body end 0004D011
 }
 
-bool WeakAttackOperation::ComputeLikelihood(const TraceSet* trace, double** matrix) const 
+bool WeakAttackOperation::ComputeLikelihood(const TraceSet* trace, const EmissionTable* emissions, double** matrix) const 
 {
   // Bouml preserved body begin 00052111
 
-	const double bigNumber = 1e20;
-	const double bigNumberInverse = 1.0 / bigNumber;
-
-	// get user profiles
-	map<ull, UserProfile*> profiles = map<ull, UserProfile*>();
-	VERIFY(context->GetProfiles(profiles) == true);
-
-	ull Nusers = profiles.size();
-
-	// get mapping (pseudonym -> observed trace)
-	map<ull, Trace*> mapping = map<ull, Trace*>();
-	trace->GetMapping(mapping);
-
-	VERIFY(Nusers == mapping.size());
-
-	ull minTime = 0; ull maxTime = 0;
-	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
-	ull numTimes = maxTime - minTime + 1;
-
-	ull minLoc = 0; ull maxLoc = 0;
-	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
-
-	ull byteSize = (Nusers * Nusers) * sizeof(double);
-	double* likelihood = *matrix = (double*)Allocate(byteSize);
-	VERIFY(likelihood != NULL);
-	memset(likelihood, 0, byteSize);
-
-	ull userIndex = 0;
-	pair_foreach_const(map<ull, UserProfile*>, profiles, usersIter)
-	{
-		ull user = usersIter->first;
-		UserProfile* profile = usersIter->second;
-
-		double* steadyStateVector = NULL;
-		VERIFY(profile->GetSteadyStateVector(&steadyStateVector) == true);
-		VERIFY(steadyStateVector != NULL);
-
-		ull pseudonymIndex = 0;
-		pair_foreach_const(map<ull, Trace*>, mapping, pseudonymsIter)
-		{
-			// ull pseudonym = pseudonymsIter->first;
-			Trace* observedTrace = pseudonymsIter->second;
-
-			vector<Event*> events = vector<Event*>();
-			observedTrace->GetEvents(events);
-
-			VERIFY(numTimes == events.size());
-
-			double logsum = 0.0;
-
-			ull tm = minTime;
-			foreach_const(vector<Event*>, events, eventsIter)
-			{
-				ObservedEvent* observedEvent = dynamic_cast<ObservedEvent*>(*eventsIter);
-				set<ull> timestamps = set<ull>();
-				observedEvent->GetTimestamps(timestamps);
-
-				VERIFY(timestamps.size() == 1);
-
-				ull timestamp = *(timestamps.begin());
-
-				VERIFY(tm == timestamp && (timestamp >= minTime && timestamp <= maxTime));
-
-				ull tp = Parameters::GetInstance()->LookupTimePeriod(timestamp);
-				if(tp == INVALID_TIME_PERIOD)
-				{
-					SET_ERROR_CODE(ERROR_CODE_INCONSISTENT_TIME_PARTITIONING_USAGE);
-					return false;
-				}
-
-				// get the proper sub-chain steady-state vector according to the time period of the event
-				double* subChainSteadyStateVector = NULL;
-				VERIFY(Algorithms::GetSteadyStateVectorOfSubChain(steadyStateVector, tp, &subChainSteadyStateVector) == true);
-
-
-				double sum = 0.0;
-				for(ull loc = minLoc; loc <= maxLoc; loc++)
-				{
-					ActualEvent* actualEvent = new ActualEvent(user, timestamp, loc);
-					ExposedEvent* exposedEvent = new ExposedEvent(*actualEvent);
-
-					VERIFY(actualEvent != NULL && exposedEvent != NULL);
-
-					double lppmProb0 = lppmPDF->PDF(context, actualEvent, observedEvent);
-					double applicationProb0 = applicationPDF->PDF(context, actualEvent, actualEvent);
-
-					double lppmProb1 = lppmPDF->PDF(context, exposedEvent, observedEvent);
-					double applicationProb1 = applicationPDF->PDF(context, actualEvent, exposedEvent);
-
-					double presenceProb = subChainSteadyStateVector[loc - minLoc];
-
-					sum += ((lppmProb0 * applicationProb0) + (lppmProb1 * applicationProb1)) * presenceProb;
-
-					/*
-					stringstream info("");
-					info << "prob: " << user << ", " << pseudonym << ", "<< timestamp << ", " << loc << ", ";
-					info << lppmProb0 << ", " << applicationProb0 << ", " << lppmProb1 << ", " << applicationProb1 << ", ";
-					info << presenceProb << " = " << sum;
-					Log::GetInstance()->Append(info.str());
-					*/
-
-					actualEvent->Release();
-					exposedEvent->Release();
-				}
-
-				Free(subChainSteadyStateVector); // free the sub-chain steady-state vector
-
-				// take care of small sum
-				VERIFY(sum == 0.0 || sum > bigNumberInverse);
-
-				if(sum == 0.0) { sum = DBL_MIN; }
-
-				logsum += log(sum);
-
-				/*
-				stringstream info(""); info.precision(16);
-				info << "logsum: " << userIndex << ", " << pseudonymIndex << " = "<< sum << ", " << tmp << ", " << logsum;
-				Log::GetInstance()->Append(info.str());
-				*/
-
-				tm++;
-			}
-
-			likelihood[GET_INDEX(userIndex, pseudonymIndex, Nusers)] = logsum;
-
-			pseudonymIndex++;
-		}
-		userIndex++;
-	}
-
-	return true;
+	// the likelihood only depends on the steady-state vectors of the users
+	return ComputeSteadyStateLikelihood(trace, emissions, matrix);
 
   // Bouml preserved body end 00052111
 }
 
-bool WeakAttackOperation::ComputeLocationDistribution(const TraceSet* trace, const map<ull, ull>* mapping, double* locationDistribution) const 
+bool WeakAttackOperation::ComputeLocationDistribution(const TraceSet* trace, const EmissionTable* emissions, const map<ull, ull>* mapping, double* locationDistribution) const 
 {
   // Bouml preserved body begin 00053B11
 
 	const double bigNumber = 1e20;
 	const double bigNumberInverse = 1.0 / bigNumber;
 
-	VERIFY(trace != NULL && mapping != NULL && locationDistribution != NULL);
+	VERIFY(trace != NULL && emissions != NULL && mapping != NULL && locationDistribution != NULL);
 
 	ull minTime = 0; ull maxTime = 0;
 	VERIFY(Parameters::GetInstance()->GetTimestampsRange(&minTime, &maxTime) == true);
@@ -427,10 +262,7 @@ bool WeakAttackOperation::ComputeLocationDistribution(const TraceSet* trace, con
 	VERIFY(Parameters::GetInstance()->GetLocationstampsRange(&minLoc, &maxLoc) == true);
 	ull numLoc = maxLoc - minLoc + 1;
 
-	stringstream info2("");
-	info2 << "minTime: " << minTime << " maxTime: " << maxTime << " minLoc: " << minLoc << " maxLoc: " << maxLoc;
-
-	Log::GetInstance()->Append(info2.str());
+	LOG_MESSAGE(Log::infoLevel, "minTime: " << minTime << " maxTime: " << maxTime << " minLoc: " << minLoc << " maxLoc: " << maxLoc);
 
 	// get profiles
 	map<ull, UserProfile*> profiles = map<ull, UserProfile*>();
@@ -460,6 +292,9 @@ bool WeakAttackOperation::ComputeLocationDistribution(const TraceSet* trace, con
 		VERIFY(traceIter != observedTraces.end());
 
 		Trace* observedTrace = traceIter->second;
+		map<ull, Trace*>::const_iterator firstTraceIter = observedTraces.begin();
+		ull pseudonymIndex = distance(firstTraceIter, traceIter);
+
 		vector<Event*> events = vector<Event*>();
 		observedTrace->GetEvents(events);
 
@@ -494,31 +329,13 @@ bool WeakAttackOperation::ComputeLocationDistribution(const TraceSet* trace, con
 			{
 				double prob = 0.0;
 
-				ActualEvent* actualEvent = new ActualEvent(user, timestamp, loc);
-				ExposedEvent* exposedEvent = new ExposedEvent(*actualEvent);
-
-				VERIFY(actualEvent != NULL && exposedEvent != NULL);
-
-				double lppmProb0 = lppmPDF->PDF(context, actualEvent, observedEvent);
-				double applicationProb0 = applicationPDF->PDF(context, actualEvent, actualEvent);
-
-				double lppmProb1 = lppmPDF->PDF(context, exposedEvent, observedEvent);
-				double applicationProb1 = applicationPDF->PDF(context, actualEvent, exposedEvent);
+				double emissionProb = emissions->GetProbability(userIndex, pseudonymIndex, (timestamp - minTime), (loc - minLoc));
 
 				double presenceProb = subChainSteadyStateVector[loc - minLoc];
 
-				prob = ((lppmProb0 * applicationProb0) + (lppmProb1 * applicationProb1)) * presenceProb;
+				prob = emissionProb * presenceProb;
 
-				/*
-				stringstream info("");
-				info << "prob: " << user << ", " << timestamp << ", " << loc << ", ";
-				info << lppmProb0 << ", " << applicationProb0 << ", " << lppmProb1 << ", " << applicationProb1 << ", ";
-				info << presenceProb << " = " << prob;
-				Log::GetInstance()->Append(info.str());
-				*/
-
-				actualEvent->Release();
-				exposedEvent->Release();
+				LOG_MESSAGE(Log::debugLevel, "prob: " << user << ", " << timestamp << ", " << loc << ", " << emissionProb << ", " << presenceProb << " = " << prob);
 
 				// take care of small prob
 				VERIFY(prob == 0.0 || prob > bigNumberInverse);
@@ -526,14 +343,7 @@ bool WeakAttackOperation::ComputeLocationDistribution(const TraceSet* trace, con
 				ull index = GET_INDEX_3D(userIndex, (timestamp - minTime), (loc - minLoc), numTimes, numLoc);
 				locationDistribution[index] = (double)prob;
 
-				/*
-				stringstream info("");
-				info << "Calculated the location distribution at index " << index << " user: " << user;
-				info << " userIndex: " << userIndex << " time: " << timestamp;
-				info << " loc: " << loc << " memory addr: " << hex << (ull)&locationDistribution[index];
-
-				Log::GetInstance()->Append(info.str());
-				*/
+				LOG_MESSAGE(Log::debugLevel, "Calculated the location distribution at index " << index << " user: " << user << " userIndex: " << userIndex << " time: " << timestamp << " loc: " << loc);
 
 				sum += prob;
 			}